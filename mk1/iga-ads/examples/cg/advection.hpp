@@ -6,6 +6,9 @@
 
 #include <galois/Timer.h>
 
+#include "../common/coupled_assembly.hpp"
+#include "../common/mixed_form_operator.hpp"
+#include "../common/mumps_factorization.hpp"
 #include "../erikkson/erikkson_base.hpp"
 #include "../erikkson/solution.hpp"
 #include "ads/executor/galois.hpp"
@@ -74,11 +77,19 @@ private:
     advection_config cfg;
     Problem problem;
 
-    mumps::solver solver;
+    // Matrix-free interior part of B, used by the iterative solver
+    mixed_form_operator B_form;
+
+    // Factorization of the matrix assembled in factorize_problem, reused for
+    // all the outer iterations as long as lhs_key does not change. The solver
+    // keeps its own copy of the matrix.
+    mumps::factorization solver;
 
     output_manager<2> output;
 
     galois::StatTimer integration_timer{"integration"};
+    galois::StatTimer analysis_timer{"analysis"};
+    galois::StatTimer factorization_timer{"factorization"};
     galois::StatTimer solver_timer{"solver"};
     galois::StatTimer total_timer{"total"};
 
@@ -113,6 +124,7 @@ public:
     , peclet{peclet}
     , cfg{cfg}
     , problem{problem}
+    , B_form{Ux, Uy, Vx, Vy, executor, [this](point_type x) { return form_coeffs(x); }}
     , output{Ux.B, Uy.B, 500}
     , dirichlet{cfg.weak_bc ? boundary::none : boundary::full} {
         int p = Vx.basis.degree;
@@ -363,42 +375,41 @@ private:
         }
 
         // B, B^T
-        for (auto i : dofs(Vx, Vy)) {
-            for (auto j : dofs(Ux, Uy)) {
-                if (is_fixed(i, Vx, Vy) || is_fixed(j, Ux, Uy))
+        auto value = [&](index_type i, index_type j) {
+            if (is_fixed(i, Vx, Vy) || is_fixed(j, Ux, Uy))
+                return 0.0;
+
+            double val = 0;
+            for (auto e : elements_supporting_dof(i, Vx, Vy)) {
+                if (!supported_in(j, e, Ux, Uy))
                     continue;
 
-                double val = 0;
-                for (auto e : elements_supporting_dof(i, Vx, Vy)) {
-                    if (!supported_in(j, e, Ux, Uy))
-                        continue;
-
-                    double J = jacobian(e, x, y);
-                    for (auto q : quad_points(Vx, Vy)) {
-                        double w = weight(q);
-                        auto x = point(e, q);
-                        value_type ww = eval_basis(e, q, i, Vx, Vy);
-                        value_type uu = eval_basis(e, q, j, Ux, Uy);
-                        val += B(uu, ww, x) * w * J;
-                    }
+                double J = jacobian(e, x, y);
+                for (auto q : quad_points(Vx, Vy)) {
+                    double w = weight(q);
+                    auto x = point(e, q);
+                    value_type ww = eval_basis(e, q, i, Vx, Vy);
+                    value_type uu = eval_basis(e, q, j, Ux, Uy);
+                    val += B(uu, ww, x) * w * J;
                 }
+            }
 
-                auto form = [&](auto u, auto w, auto x, auto n) { return this->bdB(u, w, x, n); };
-                for_sides(~dirichlet, [&](auto side) {
-                    if (touches(i, side, Vx, Vy) && touches(j, side, Ux, Uy)) {
-                        val += integrate_boundary(side, j, i, Ux, Uy, Vx, Vy, form);
-                    }
-                });
-
-                if (val != 0) {
-                    int ii = linear_index(i, Vx, Vy) + 1;
-                    int jj = linear_index(j, Ux, Uy) + 1;
-
-                    problem.add(ii, N + jj, val);
-                    problem.add(N + jj, ii, val);
+            auto form = [&](auto u, auto w, auto x, auto n) { return this->bdB(u, w, x, n); };
+            for_sides(~dirichlet, [&](auto side) {
+                if (touches(i, side, Vx, Vy) && touches(j, side, Ux, Uy)) {
+                    val += integrate_boundary(side, j, i, Ux, Uy, Vx, Vy, form);
                 }
-            }
-        }
+            });
+            return val;
+        };
+        auto emit = [&](index_type i, index_type j, double val) {
+            int ii = linear_index(i, Vx, Vy) + 1;
+            int jj = linear_index(j, Ux, Uy) + 1;
+
+            problem.add(ii, N + jj, val);
+            problem.add(N + jj, ii, val);
+        };
+        assemble_coupled_block(Vx, Vy, Ux, Uy, executor, value, emit);
 
         // Dirichlet BC - upper left
         for_boundary_dofs(Vx, Vy, [&](index_type dof) {
@@ -534,18 +545,50 @@ private:
             dirichlet_bc(dr, side, Vx, Vy, 0);
         });
 
-        mumps::problem problem{full_rhs};
-        assemble_problem(problem, Vx, Vy);
         integration_timer.stop();
 
+        auto const key = lhs_key();
+        if (!solver.factorized(key)) {
+            factorize_problem(key);
+        }
+
         solver_timer.start();
-        solver.solve(problem);
+        solver.solve(key, full_rhs.data());
         solver_timer.stop();
 
         update_solution(du);
         return du;
     }
 
+    // Identifies the matrix by what it is assembled from - the trial and test
+    // spaces and the parameters of the formulation. Coefficients of the problem
+    // are fixed at construction and are not part of the key.
+    std::uint64_t lhs_key() const {
+        auto h = mumps::matrix_key(eta, gamma, epsilon, cfg.weak_bc);
+        for (const dimension* d : {&Ux, &Uy, &Vx, &Vy}) {
+            auto const& knot = d->B.knot;
+            h = mumps::fingerprint(knot.data(), knot.size(), h);
+            h = mumps::fingerprint(&d->B.degree, 1, h);
+        }
+        return h;
+    }
+
+    void factorize_problem(std::uint64_t key) {
+        integration_timer.start();
+        int size = Vx.dofs() * Vy.dofs() + Ux.dofs() * Uy.dofs();
+        mumps::problem problem(full_rhs.data(), size);
+        assemble_problem(problem, Vx, Vy);
+        integration_timer.stop();
+
+        analysis_timer.start();
+        solver.analyze(problem);
+        analysis_timer.stop();
+
+        factorization_timer.start();
+        solver.factorize(problem, key);
+        factorization_timer.stop();
+    }
+
     vector_view substep_CG(const vector_type& dc) {
         vector_type u_prev = u;
 
@@ -681,6 +724,12 @@ private:
         if (cfg.print_times) {
             std::cout << "integration: " << static_cast<double>(integration_timer.get()) << " ms"
                       << std::endl;
+            if (!cfg.use_cg) {
+                std::cout << "analysis:    " << static_cast<double>(analysis_timer.get()) << " ms"
+                          << std::endl;
+                std::cout << "factorize:   " << static_cast<double>(factorization_timer.get())
+                          << " ms" << std::endl;
+            }
             std::cout << "solver:      " << static_cast<double>(solver_timer.get()) << " ms"
                       << std::endl;
             std::cout << "total:       " << static_cast<double>(total_timer.get()) << " ms"
@@ -846,26 +895,8 @@ private:
     template <typename U, typename Res>
     void apply_B(const U& u, Res& result) {
         zero(result);
-        executor.for_each(elements(Vx, Vy), [&](index_type e) {
-            auto rhs = vector_type{{Vx.basis.dofs_per_element(), Vy.basis.dofs_per_element()}};
-
-            double J = jacobian(e);
-            for (auto q : quad_points(Vx, Vy)) {
-                double W = weight(q);
-                double WJ = W * J;
-                auto x = point(e, q);
-                value_type uu = eval(u, e, q, Ux, Uy);
-
-                for (auto a : dofs_on_element(e, Vx, Vy)) {
-                    auto aa = dof_global_to_local(e, a, Vx, Vy);
-                    value_type v = eval_basis(e, q, a, Vx, Vy);
-                    // Bu
-                    double val = B(uu, v, x);
-                    rhs(aa[0], aa[1]) += val * WJ;
-                }
-            }
-            executor.synchronized([&]() { update_global_rhs(result, rhs, e, Vx, Vy); });
-        });
+        // Bu
+        B_form.apply(u, result);
 
         // Boundary terms of Bu
         for (auto i : dofs(Vx, Vy)) {
@@ -884,27 +915,8 @@ private:
     template <typename U, typename Res>
     void apply_Bt(const U& r, Res& result) {
         zero(result);
-        executor.for_each(elements(Vx, Vy), [&](index_type e) {
-            auto rhs = vector_type{{Ux.basis.dofs_per_element(), Uy.basis.dofs_per_element()}};
-
-            double J = jacobian(e);
-            for (auto q : quad_points(Vx, Vy)) {
-                double W = weight(q);
-                double WJ = W * J;
-                auto x = point(e, q);
-                value_type rr = eval(r, e, q, Vx, Vy);
-
-                for (auto a : dofs_on_element(e, Ux, Uy)) {
-                    auto aa = dof_global_to_local(e, a, Ux, Uy);
-                    value_type w = eval_basis(e, q, a, Ux, Uy);
-
-                    // B' r
-                    double val = B(w, rr, x);
-                    rhs(aa[0], aa[1]) += val * WJ;
-                }
-            }
-            executor.synchronized([&]() { update_global_rhs(result, rhs, e, Ux, Uy); });
-        });
+        // B' r
+        B_form.apply_transpose(r, result);
 
         // Boundary terms of B'r
         for (auto i : dofs(Ux, Uy)) {
@@ -997,6 +1009,13 @@ private:
     }
 
     // Forms
+    // Coefficients of B in the form used by mixed_form_operator
+    form_coefficients form_coeffs(point_type x) const {
+        auto diff = diffusion(x);
+        auto b = beta(x);
+        return {diff, diff, b[0], b[1], 0};
+    }
+
     double B(value_type u, value_type v, point_type x) const {
         auto diff = diffusion(x);
         return diff * grad_dot(u, v) + dot(beta(x), u) * v.val;
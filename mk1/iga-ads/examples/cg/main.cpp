@@ -3,31 +3,12 @@
 
 #include <lyra/lyra.hpp>
 
+#include "../common/mesh_points.hpp"
 #include "ads/util.hpp"
 #include "advection.hpp"
 #include "problems.hpp"
 #include "shishkin.hpp"
 
-ads::bspline::basis basis_from_points(const std::vector<double>& points, int p,
-                                      int repeated_nodes) {
-    auto elems = ads::narrow_cast<int>(points.size()) - 1;
-    int r = repeated_nodes + 1;
-    int size = (elems - 1) * r + 2 * (p + 1);
-    auto knot = ads::bspline::knot_vector(size);
-
-    for (int i = 0; i <= p; ++i) {
-        knot[i] = points[0];
-        knot[size - i - 1] = points[elems];
-    }
-
-    for (int i = 1; i < elems; ++i) {
-        for (int j = 0; j < r; ++j) {
-            knot[p + 1 + (i - 1) * r + j] = points[i];
-        }
-    }
-    return {std::move(knot), p};
-}
-
 std::vector<double> make_points(int n) {
     std::vector<double> points{};
 
@@ -181,12 +162,12 @@ int main(int argc, char* argv[]) {
 
     auto points_x = make_points(nx);
 
-    auto trial_basis_x = basis_from_points(points_x, p_trial, rep_trial);
+    auto trial_basis_x = ads::basis_from_points(points_x, p_trial, rep_trial);
     auto dtrial_x = ads::dimension{trial_basis_x, quad, 1, 1};
     // auto dtrial_x = make_dim(p_trial, nx, rep_trial, adapt_x);
     auto dtrial_y = make_dim(p_trial, ny, rep_trial, adapt_y);
 
-    auto test_basis_x = basis_from_points(points_x, p_test, rep_test);
+    auto test_basis_x = ads::basis_from_points(points_x, p_test, rep_test);
     auto dtest_x = ads::dimension{test_basis_x, quad, 1, 1};
     // auto dtest_x = make_dim(p_test, nx, rep_test, adapt_x);
     auto dtest_y = make_dim(p_test, ny, rep_test, adapt_y);
@@ -13,6 +13,8 @@ inline double shishkin_const(int n, double eps) {
     return std::log(n) / std::log(2) * eps;
 }
 
+// Uniform or, if adapt is set, Shishkin mesh with a layer of width d at b,
+// see common/mesh_points.hpp for other layer-adapted meshes
 ads::bspline::basis create_basis(double a, double b, int p, int elements, int repeated_nodes,
                                  bool adapt, double d);
 
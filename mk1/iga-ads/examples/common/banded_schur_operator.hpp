@@ -0,0 +1,325 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_BANDED_SCHUR_OPERATOR_HPP
+#define COMMON_BANDED_SCHUR_OPERATOR_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "ads/lin/band_matrix.hpp"
+#include "ads/lin/band_solve.hpp"
+#include "ads/simulation.hpp"
+#include "coupled_assembly.hpp"
+
+namespace ads {
+
+// Rectangular 1D matrix coupling the test space V (rows) with the trial space
+// U (columns), storing only entries of pairs of functions with intersecting
+// supports. The spaces may have different degrees and continuity, so the
+// nonzero columns of a row do not lie within a fixed distance from the
+// diagonal; instead, each row keeps its own range.
+class row_band_matrix {
+private:
+    int rows_ = 0;
+    int cols_ = 0;
+    int width_ = 0;
+    std::vector<int> first_;
+    std::vector<int> last_;
+    std::vector<double> data_;
+
+public:
+    row_band_matrix() = default;
+
+    row_band_matrix(const dimension& V, const dimension& U)
+    : rows_{V.dofs()}
+    , cols_{U.dofs()}
+    , first_(rows_)
+    , last_(rows_) {
+        for (int i = 0; i < rows_; ++i) {
+            auto range = overlapping_range(i, V.B, U.B);
+            first_[i] = range.first;
+            last_[i] = range.second;
+            width_ = std::max(width_, range.second - range.first + 1);
+        }
+        data_.resize(static_cast<std::size_t>(rows_) * width_);
+    }
+
+    int rows() const { return rows_; }
+
+    int cols() const { return cols_; }
+
+    // Maximal number of nonzero columns in a row
+    int width() const { return width_; }
+
+    int first(int i) const { return first_[i]; }
+
+    int last(int i) const { return last_[i]; }
+
+    double& operator()(int i, int j) { return data_[index(i, j)]; }
+
+    double operator()(int i, int j) const { return data_[index(i, j)]; }
+
+    void zero() { std::fill(begin(data_), end(data_), 0); }
+
+    // y = B x
+    void multiply(const double* x, double* y) const {
+        for (int i = 0; i < rows_; ++i) {
+            double val = 0;
+            for (int j = first_[i]; j <= last_[i]; ++j) {
+                val += (*this)(i, j) * x[j];
+            }
+            y[i] = val;
+        }
+    }
+
+    // y = B' x
+    void multiply_transpose(const double* x, double* y) const {
+        std::fill(y, y + cols_, 0);
+        for (int i = 0; i < rows_; ++i) {
+            for (int j = first_[i]; j <= last_[i]; ++j) {
+                y[j] += (*this)(i, j) * x[i];
+            }
+        }
+    }
+
+private:
+    std::size_t index(int i, int j) const {
+        assert(j >= first_[i] && j <= last_[i] && "Entry outside the supports overlap");
+        return static_cast<std::size_t>(i) * width_ + j - first_[i];
+    }
+};
+
+// Applies B or B' (transpose = "T") to count lines stored one after another,
+// like multiply for dense matrices
+template <typename In, typename Out>
+void multiply(const row_band_matrix& B, const In& x, Out& y, int count,
+              const char* transpose = "N") {
+    bool const t = std::strcmp(transpose, "T") == 0;
+    int const n = t ? B.rows() : B.cols();
+    int const m = t ? B.cols() : B.rows();
+    for (int l = 0; l < count; ++l) {
+        const double* in = x.data() + static_cast<std::size_t>(l) * n;
+        double* out = y.data() + static_cast<std::size_t>(l) * m;
+        if (t) {
+            B.multiply_transpose(in, out);
+        } else {
+            B.multiply(in, out);
+        }
+    }
+}
+
+// 1D operator K = B' A^-1 B of residual minimization and DPG methods, with B
+// coupling the test and trial spaces and A the Gram matrix of the test space.
+//
+// K is dense, but it is never formed. Its action costs O(n p), as it only
+// requires multiplying by B and B' and a band solve with A. Systems K x = b
+// are solved through the equivalent augmented system
+//
+//   [ A  -B ] [ y ]   [ 0 ]
+//   [ B'  0 ] [ x ] = [ b ],
+//
+// which is banded once test and trial dofs are interleaved in the order of
+// their supports, with bandwidth depending only on the degrees. It is
+// factorized once with the band LU, in O(n p^2), and each solve is then exact
+// and costs O(n p). Rows of fixed (Dirichlet) dofs of K are replaced by rows
+// of the identity. Like dim_data, it can be passed to ads_solve.
+//
+// Work buffers are allocated once, in the constructor, and shared by apply and
+// solve, so a single operator must not be used from several threads at once.
+class banded_schur_operator {
+private:
+    // Number of lines solved with a single call to the band solver
+    static constexpr int batch = 16;
+
+    row_band_matrix B_;
+    lin::band_matrix A_;
+    mutable lin::solver_ctx A_ctx_;
+    lin::band_matrix S_;
+    mutable lin::solver_ctx S_ctx_;
+    std::vector<int> test_pos_;   // position of test dofs in the augmented system
+    std::vector<int> trial_pos_;  // position of trial dofs in the augmented system
+    std::vector<char> fixed_;
+
+    mutable std::vector<double> line_;   // test space line of apply
+    mutable std::vector<double> lines_;  // batch of augmented system lines of solve
+
+public:
+    banded_schur_operator(const dimension& V, const dimension& U)
+    : B_{V, U}
+    , A_ctx_{A_}
+    , S_ctx_{S_}
+    , test_pos_(V.dofs())
+    , trial_pos_(U.dofs())
+    , fixed_(U.dofs())
+    , line_(V.dofs())
+    , lines_(static_cast<std::size_t>(V.dofs() + U.dofs()) * batch) {
+        interleave(V, U);
+    }
+
+    int size() const { return B_.cols(); }
+
+    // Sets B and A, given as a non-factorized band matrix, and the list of
+    // fixed dofs, and factorizes the augmented system
+    void factorize(const row_band_matrix& B, const lin::band_matrix& A,
+                   const std::vector<int>& fixed = {}) {
+        assert(B.rows() == B_.rows() && B.cols() == B_.cols());
+        B_ = B;
+
+        std::fill(begin(fixed_), end(fixed_), 0);
+        for (int k : fixed) {
+            assert(k >= 0 && k < size());
+            fixed_[k] = 1;
+        }
+
+        int kl = 0;
+        int ku = 0;
+        for_each_entry(A, [&](int i, int j, double) {
+            kl = std::max(kl, i - j);
+            ku = std::max(ku, j - i);
+        });
+        S_ = lin::band_matrix{kl, ku, B_.rows() + B_.cols()};
+        S_ctx_ = lin::solver_ctx{S_};
+        for_each_entry(A, [&](int i, int j, double val) { S_(i, j) = val; });
+        lin::factorize(S_, S_ctx_);
+
+        A_ = A;
+        A_ctx_ = lin::solver_ctx{A_};
+        lin::factorize(A_, A_ctx_);
+    }
+
+    // y = K x for a single line
+    void apply(const double* x, double* y) const {
+        B_.multiply(x, line_.data());
+        lin::solve_with_factorized(A_, line_.data(), A_ctx_, 1);
+        B_.multiply_transpose(line_.data(), y);
+
+        for (int i = 0; i < size(); ++i) {
+            if (fixed_[i]) {
+                y[i] = x[i];
+            }
+        }
+    }
+
+    template <typename In, typename Out>
+    void apply(const In& x, Out& y) const {
+        int const n = size();
+        int const count = static_cast<int>(x.size()) / n;
+        for (int l = 0; l < count; ++l) {
+            apply(x.data() + static_cast<std::size_t>(l) * n,
+                  y.data() + static_cast<std::size_t>(l) * n);
+        }
+    }
+
+    // Solves count lines of length size() stored one after another in data,
+    // overwriting them with the solutions
+    void solve(double* data, int count) const {
+        int const n = size();
+        auto const N = static_cast<std::size_t>(B_.rows() + n);
+
+        for (int first = 0; first < count; first += batch) {
+            int const lines = std::min(batch, count - first);
+            double* const block = data + static_cast<std::size_t>(first) * n;
+
+            std::fill(begin(lines_), end(lines_), 0);
+            for (int l = 0; l < lines; ++l) {
+                for (int j = 0; j < n; ++j) {
+                    lines_[l * N + trial_pos_[j]] = block[l * n + j];
+                }
+            }
+            lin::solve_with_factorized(S_, lines_.data(), S_ctx_, lines);
+            for (int l = 0; l < lines; ++l) {
+                for (int j = 0; j < n; ++j) {
+                    block[l * n + j] = lines_[l * N + trial_pos_[j]];
+                }
+            }
+        }
+    }
+
+    template <typename Rhs>
+    void operator()(Rhs& rhs) const {
+        solve(rhs.data(), static_cast<int>(rhs.size()) / size());
+    }
+
+private:
+    // Orders test and trial dofs by the centers of their supports
+    void interleave(const dimension& V, const dimension& U) {
+        struct dof {
+            double center;
+            int space;
+            int index;
+        };
+        auto center = [](const bspline::basis& b, int i) {
+            return (b.knot[i] + b.knot[i + b.degree + 1]) / 2;
+        };
+
+        auto dofs = std::vector<dof>{};
+        for (int i = 0; i < V.dofs(); ++i) {
+            dofs.push_back({center(V.B, i), 0, i});
+        }
+        for (int j = 0; j < U.dofs(); ++j) {
+            dofs.push_back({center(U.B, j), 1, j});
+        }
+        std::stable_sort(begin(dofs), end(dofs), [](const dof& a, const dof& b) {
+            return a.center < b.center || (a.center == b.center && a.space < b.space);
+        });
+
+        for (int k = 0; k < static_cast<int>(dofs.size()); ++k) {
+            auto& pos = dofs[k].space == 0 ? test_pos_ : trial_pos_;
+            pos[dofs[k].index] = k;
+        }
+    }
+
+    // Calls f(row, col, val) for each entry of the augmented system
+    template <typename F>
+    void for_each_entry(const lin::band_matrix& A, F&& f) const {
+        int const m = B_.rows();
+        for (int i = 0; i < m; ++i) {
+            for (int j = std::max(0, i - A.kl); j <= std::min(m - 1, i + A.ku); ++j) {
+                f(test_pos_[i], test_pos_[j], A(i, j));
+            }
+            for (int j = B_.first(i); j <= B_.last(i); ++j) {
+                f(test_pos_[i], trial_pos_[j], -B_(i, j));
+                if (!fixed_[j]) {
+                    f(trial_pos_[j], test_pos_[i], B_(i, j));
+                }
+            }
+        }
+        for (int j = 0; j < size(); ++j) {
+            if (fixed_[j]) {
+                f(trial_pos_[j], trial_pos_[j], 1.0);
+            }
+        }
+    }
+};
+
+// y = K x, with K either a banded_schur_operator or a non-factorized band
+// matrix, e.g. to compute boundary values of the right-hand side
+template <typename In, typename Out>
+void apply(const banded_schur_operator& K, const In& x, Out& y) {
+    K.apply(x, y);
+}
+
+template <typename In, typename Out>
+void apply(const lin::band_matrix& K, const In& x, Out& y) {
+    int const n = K.rows;
+    int const count = static_cast<int>(x.size()) / n;
+    for (int l = 0; l < count; ++l) {
+        const double* in = x.data() + static_cast<std::size_t>(l) * n;
+        double* out = y.data() + static_cast<std::size_t>(l) * n;
+        for (int i = 0; i < n; ++i) {
+            double val = 0;
+            for (int j = std::max(0, i - K.kl); j <= std::min(n - 1, i + K.ku); ++j) {
+                val += K(i, j) * in[j];
+            }
+            out[i] = val;
+        }
+    }
+}
+
+}  // namespace ads
+
+#endif  // COMMON_BANDED_SCHUR_OPERATOR_HPP
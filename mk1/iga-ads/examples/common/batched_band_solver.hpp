@@ -0,0 +1,233 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_BATCHED_BAND_SOLVER_HPP
+#define COMMON_BATCHED_BAND_SOLVER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "ads/lin/band_matrix.hpp"
+
+namespace ads {
+
+// Banded solver processing several right-hand sides at once.
+//
+// Substitution along a single line is inherently sequential, so instead of
+// solving the lines one by one, width lines are interleaved and each step of
+// the substitution is applied to all of them, which the compiler turns into
+// SIMD instructions. Remaining lines are padded to a full batch.
+//
+// The matrix is factorized without pivoting, which is stable only for some
+// matrices - symmetric positive definite (mass matrices, M + dt K with SPD K)
+// or diagonally dominant ones, see stable_without_pivoting. Operators with
+// dominating advection are neither; for those use direction_solver, which
+// falls back to the pivoted LAPACK factorization. The matrix passed to the
+// constructor must not be factorized.
+//
+// Factorization is computed in double precision. With T = float the factors
+// are then rounded and substitution is performed in single precision, on
+// twice as many lines per batch; right-hand sides are always double.
+template <typename T>
+class basic_batched_band_solver {
+public:
+    static constexpr int width = 64 / sizeof(T);
+
+private:
+    struct alignas(64) lanes {
+        T v[width];
+    };
+
+    int n_ = 0;
+    int kl_ = 0;
+    int ku_ = 0;
+    std::vector<T> rows_;
+    std::vector<T> inv_diag_;
+
+public:
+    basic_batched_band_solver() = default;
+
+    explicit basic_batched_band_solver(const lin::band_matrix& M)
+    : n_{M.rows}
+    , kl_{M.kl}
+    , ku_{M.ku} {
+        auto rows = std::vector<double>(static_cast<std::size_t>(n_) * row_width());
+        auto inv_diag = std::vector<double>(n_);
+        for (int i = 0; i < n_; ++i) {
+            for (int k = first_col(i); k <= last_col(i); ++k) {
+                rows[index(i, k)] = M(i, k);
+            }
+        }
+        factorize(rows, inv_diag);
+
+        rows_.assign(begin(rows), end(rows));
+        inv_diag_.assign(begin(inv_diag), end(inv_diag));
+    }
+
+    int size() const { return n_; }
+
+    // Whether M is symmetric, which for the matrices assembled in ADS means
+    // positive definite, or diagonally dominant by rows or by columns.
+    //
+    // Rows of dofs fixed with fix_dof are rows of the identity. Eliminating
+    // them does not change the rest of the matrix, so the symmetry is checked
+    // only on the remaining rows and columns. This way Gram matrices and
+    // M + dt K with Dirichlet conditions, not dominant for p > 2, still count
+    // as stable.
+    static bool stable_without_pivoting(const lin::band_matrix& M) {
+        int const n = M.rows;
+        auto const first = [&](int i) { return std::max(0, i - M.kl); };
+        auto const last = [&](int i) { return std::min(n - 1, i + M.ku); };
+
+        double max_entry = 0;
+        auto fixed = std::vector<char>(n);
+        for (int i = 0; i < n; ++i) {
+            bool identity = M(i, i) == 1;
+            for (int k = first(i); k <= last(i); ++k) {
+                max_entry = std::max(max_entry, std::abs(M(i, k)));
+                identity = identity && (k == i || M(i, k) == 0);
+            }
+            fixed[i] = identity;
+        }
+
+        bool symmetric = true;
+        bool rows_dominant = true;
+        bool cols_dominant = true;
+        for (int i = 0; i < n; ++i) {
+            double row_sum = 0;
+            double col_sum = 0;
+            for (int k = first(i); k <= last(i); ++k) {
+                if (k == i) {
+                    continue;
+                }
+                row_sum += std::abs(M(i, k));
+                bool const checked = !fixed[i] && !fixed[k];
+                if (checked && symmetric) {
+                    bool const in_band = i - k <= M.ku && k - i <= M.kl;
+                    double const mirror = in_band ? M(k, i) : 0.0;
+                    symmetric = std::abs(M(i, k) - mirror) <= 1e-12 * max_entry;
+                }
+            }
+            for (int k = std::max(0, i - M.ku); k <= std::min(n - 1, i + M.kl); ++k) {
+                if (k != i) {
+                    col_sum += std::abs(M(k, i));
+                }
+            }
+            double const diag = std::abs(M(i, i));
+            rows_dominant = rows_dominant && diag >= row_sum;
+            cols_dominant = cols_dominant && diag >= col_sum;
+        }
+        return symmetric || rows_dominant || cols_dominant;
+    }
+
+    // Solves count lines of length size() stored one after another in data,
+    // overwriting them with the solutions. Calls may run concurrently, so the
+    // interleaved lines are kept in a buffer of the calling thread, allocated
+    // on its first call.
+    void solve(double* data, int count) const {
+        thread_local auto buf = std::vector<lanes>{};
+        buf.resize(n_);
+
+        for (int first = 0; first < count; first += width) {
+            int const m = std::min(width, count - first);
+            double* block = data + static_cast<std::size_t>(first) * n_;
+
+            gather(block, m, buf);
+            substitute(buf);
+            scatter(buf, m, block);
+        }
+    }
+
+private:
+    int row_width() const { return kl_ + ku_ + 1; }
+
+    int first_col(int i) const { return std::max(0, i - kl_); }
+
+    int last_col(int i) const { return std::min(n_ - 1, i + ku_); }
+
+    std::size_t index(int i, int k) const {
+        return static_cast<std::size_t>(i) * row_width() + k - i + kl_;
+    }
+
+    T at(int i, int k) const { return rows_[index(i, k)]; }
+
+    // In-place LU decomposition, L with unit diagonal. Without pivoting there
+    // is no fill-in outside the band.
+    void factorize(std::vector<double>& rows, std::vector<double>& inv_diag) const {
+        for (int j = 0; j < n_; ++j) {
+            double const pivot = rows[index(j, j)];
+            if (pivot == 0 || !std::isfinite(pivot)) {
+                throw std::runtime_error{
+                    fmt::format("Batched band solver: invalid pivot {} in row {}", pivot, j)};
+            }
+            inv_diag[j] = 1 / pivot;
+
+            for (int i = j + 1; i <= std::min(n_ - 1, j + kl_); ++i) {
+                double const l = rows[index(i, j)] * inv_diag[j];
+                rows[index(i, j)] = l;
+                for (int k = j + 1; k <= last_col(j); ++k) {
+                    rows[index(i, k)] -= l * rows[index(j, k)];
+                }
+            }
+        }
+    }
+
+    void gather(const double* block, int m, std::vector<lanes>& buf) const {
+        for (int i = 0; i < n_; ++i) {
+            std::fill(std::begin(buf[i].v), std::end(buf[i].v), T{0});
+        }
+        for (int l = 0; l < m; ++l) {
+            const double* line = block + static_cast<std::size_t>(l) * n_;
+            for (int i = 0; i < n_; ++i) {
+                buf[i].v[l] = static_cast<T>(line[i]);
+            }
+        }
+    }
+
+    void scatter(const std::vector<lanes>& buf, int m, double* block) const {
+        for (int l = 0; l < m; ++l) {
+            double* line = block + static_cast<std::size_t>(l) * n_;
+            for (int i = 0; i < n_; ++i) {
+                line[i] = buf[i].v[l];
+            }
+        }
+    }
+
+    void substitute(std::vector<lanes>& buf) const {
+        for (int i = 0; i < n_; ++i) {
+            auto& xi = buf[i].v;
+            for (int k = first_col(i); k < i; ++k) {
+                T const a = at(i, k);
+                const auto& xk = buf[k].v;
+                for (int l = 0; l < width; ++l) {
+                    xi[l] -= a * xk[l];
+                }
+            }
+        }
+        for (int i = n_ - 1; i >= 0; --i) {
+            auto& xi = buf[i].v;
+            for (int k = i + 1; k <= last_col(i); ++k) {
+                T const a = at(i, k);
+                const auto& xk = buf[k].v;
+                for (int l = 0; l < width; ++l) {
+                    xi[l] -= a * xk[l];
+                }
+            }
+            T const d = inv_diag_[i];
+            for (int l = 0; l < width; ++l) {
+                xi[l] *= d;
+            }
+        }
+    }
+};
+
+using batched_band_solver = basic_batched_band_solver<double>;
+
+}  // namespace ads
+
+#endif  // COMMON_BATCHED_BAND_SOLVER_HPP
@@ -0,0 +1,175 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_BOUNDARY_TRACE_HPP
+#define COMMON_BOUNDARY_TRACE_HPP
+
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "ads/bspline/bspline.hpp"
+#include "ads/bspline/eval.hpp"
+#include "ads/lin/dense_matrix.hpp"
+#include "ads/simulation.hpp"
+#include "mesh_points.hpp"
+
+namespace ads {
+
+// Value and normal derivative of a 1D basis function at the end of the
+// interval, i.e. of the normal factor of a 2D basis function on the boundary
+struct trace_value {
+    double val;
+    double dn;
+};
+
+// Restriction of a pair of 2D tensor product spaces - test space V and trial
+// space U - to one side of the rectangle, used to assemble boundary forms.
+//
+// On a side normal to axis k, a basis function is the product of the 1D
+// function along the side (tangential factor) and the trace of the 1D function
+// in the direction k (normal factor). Only p + 1 normal factors do not vanish
+// on the side, so a boundary form that is a product of a tangential integral
+// and of an expression in normal traces has O(n p^3) nonzero entries, where n
+// is the number of dofs along the side. Tangential integrals are 1D matrices
+// computed once, instead of integrating each pair of 2D basis functions.
+//
+// Both spaces need to be defined on the same mesh.
+class boundary_trace {
+public:
+    using point_type = std::array<double, 2>;
+    using index_type = std::array<int, 2>;
+
+private:
+    struct normal_trace {
+        int first = 0;
+        std::vector<trace_value> values;
+    };
+
+    boundary side_;
+    int normal_axis_;
+    double coord_;
+    double sign_;
+    const dimension* Vt_;
+    const dimension* Ut_;
+    normal_trace test_;
+    normal_trace trial_;
+
+public:
+    boundary_trace(boundary side, const dimension& Vx, const dimension& Vy, const dimension& Ux,
+                   const dimension& Uy)
+    : side_{side}
+    , normal_axis_{side == boundary::left || side == boundary::right ? 0 : 1}
+    , sign_{side == boundary::left || side == boundary::bottom ? -1.0 : 1.0} {
+        const auto& Vn = normal_axis_ == 0 ? Vx : Vy;
+        const auto& Un = normal_axis_ == 0 ? Ux : Uy;
+        Vt_ = normal_axis_ == 0 ? &Vy : &Vx;
+        Ut_ = normal_axis_ == 0 ? &Uy : &Ux;
+
+        if (!same_quadrature(*Vt_, *Ut_)) {
+            throw std::invalid_argument{fmt::format(
+                "Boundary trace: test and trial meshes differ ({} and {} elements)",
+                Vt_->elements, Ut_->elements)};
+        }
+
+        coord_ = sign_ < 0 ? Vn.a : Vn.b;
+        test_ = trace(Vn);
+        trial_ = trace(Un);
+    }
+
+    boundary side() const { return side_; }
+
+    point_type normal() const {
+        auto n = point_type{0, 0};
+        n[normal_axis_] = sign_;
+        return n;
+    }
+
+    // 1D matrix of integrals of weight(x) v_i u_j along the side, rows
+    // corresponding to test functions
+    template <typename Weight>
+    lin::dense_matrix mass(Weight&& weight) const {
+        const auto& V = Vt_->basis;
+        const auto& U = Ut_->basis;
+        auto M = lin::dense_matrix{Vt_->dofs(), Ut_->dofs()};
+
+        for (int e = 0; e < Vt_->elements; ++e) {
+            double J = V.J[e];
+            for (int q = 0; q < V.quad_order; ++q) {
+                double w = V.w[q] * J * weight(point(V.x[e][q]));
+                for (int a = 0; a + V.first_dof(e) <= V.last_dof(e); ++a) {
+                    double va = V.b[e][q][0][a];
+                    for (int b = 0; b + U.first_dof(e) <= U.last_dof(e); ++b) {
+                        M(V.first_dof(e) + a, U.first_dof(e) + b) += w * va * U.b[e][q][0][b];
+                    }
+                }
+            }
+        }
+        return M;
+    }
+
+    lin::dense_matrix mass() const {
+        return mass([](point_type) { return 1.0; });
+    }
+
+    // Calls add(i, j, T(it, jt) form(v, u)) for each pair of test and trial
+    // functions nonzero on the side, where it, jt are the tangential and v, u
+    // the normal factors of i, j, and T is a matrix computed by mass
+    template <typename Form, typename Add>
+    void assemble(const lin::dense_matrix& T, Form&& form, Add&& add) const {
+        const auto& V = Vt_->basis;
+        const auto& U = Ut_->basis;
+
+        for (int it = 0; it < Vt_->dofs(); ++it) {
+            auto range = V.element_ranges[it];
+            int first = U.first_dof(range.first);
+            int last = U.last_dof(range.second);
+
+            for (int jt = first; jt <= last; ++jt) {
+                double t = T(it, jt);
+                if (t == 0) {
+                    continue;
+                }
+                for (int a = 0; a < static_cast<int>(test_.values.size()); ++a) {
+                    for (int b = 0; b < static_cast<int>(trial_.values.size()); ++b) {
+                        double val = t * form(test_.values[a], trial_.values[b]);
+                        if (val != 0) {
+                            add(dof(it, test_.first + a), dof(jt, trial_.first + b), val);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    point_type point(double t) const {
+        auto x = point_type{t, t};
+        x[normal_axis_] = coord_;
+        return x;
+    }
+
+    index_type dof(int tangential, int normal) const {
+        return normal_axis_ == 0 ? index_type{normal, tangential} : index_type{tangential, normal};
+    }
+
+    normal_trace trace(const dimension& d) const {
+        int p = d.p;
+        int span = bspline::find_span(coord_, d.B);
+        bspline::eval_ders_ctx ctx{p, 1};
+        double** vals = ctx.basis_vals();
+        bspline::eval_basis_with_derivatives(span, coord_, d.B, vals, 1, ctx);
+
+        auto t = normal_trace{span - p, {}};
+        for (int a = 0; a <= p; ++a) {
+            t.values.push_back({vals[0][a], sign_ * vals[1][a]});
+        }
+        return t;
+    }
+};
+
+}  // namespace ads
+
+#endif  // COMMON_BOUNDARY_TRACE_HPP
@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_COUPLED_ASSEMBLY_HPP
+#define COMMON_COUPLED_ASSEMBLY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <boost/range/counting_range.hpp>
+
+#include "ads/bspline/bspline.hpp"
+#include "ads/executor/galois.hpp"
+#include "ads/simulation.hpp"
+
+namespace ads {
+
+// Range [first, last] of functions of basis U with supports intersecting the
+// support of i-th function of basis V. The bases need not share the mesh.
+inline std::pair<int, int> overlapping_range(int i, const bspline::basis& V,
+                                             const bspline::basis& U) {
+    double const a = V.knot[i];
+    double const b = V.knot[i + V.degree + 1];
+    const auto& knot = U.knot;
+    int const n = static_cast<int>(knot.size()) - U.degree - 1;
+
+    auto const after_a = std::upper_bound(begin(knot), end(knot), a) - begin(knot);
+    auto const before_b = std::lower_bound(begin(knot), end(knot), b) - begin(knot);
+    int first = static_cast<int>(after_a) - U.degree - 1;
+    int last = static_cast<int>(before_b) - 1;
+    return {std::max(first, 0), std::min(last, n - 1)};
+}
+
+// Assembles a block of a coupled system with rows corresponding to functions
+// of the test space V = Vx x Vy and columns to functions of the trial space
+// U = Ux x Uy, such as B in residual minimization methods.
+//
+// Only pairs of functions with intersecting supports are visited, O(p^2) per
+// row instead of all the dofs of U. Rows are computed in parallel, so
+// value(i, j) must be safe to call concurrently. Nonzero entries are then
+// passed to emit(i, j, val) sequentially, in a fixed order, so that emit can
+// add them to a MUMPS problem.
+template <typename Value, typename Emit>
+void assemble_coupled_block(const dimension& Vx, const dimension& Vy, const dimension& Ux,
+                            const dimension& Uy, galois_executor& executor, Value&& value,
+                            Emit&& emit) {
+    using index_type = std::array<int, 2>;
+    struct entry {
+        index_type j;
+        double val;
+    };
+
+    int const nx = Vx.dofs();
+    int const ny = Vy.dofs();
+    auto rows = std::vector<std::vector<entry>>(static_cast<std::size_t>(nx) * ny);
+
+    executor.for_each(boost::counting_range(0, nx * ny), [&](int row) {
+        auto const i = index_type{row / ny, row % ny};
+        auto const rx = overlapping_range(i[0], Vx.B, Ux.B);
+        auto const ry = overlapping_range(i[1], Vy.B, Uy.B);
+        auto& entries = rows[row];
+
+        for (int jx = rx.first; jx <= rx.second; ++jx) {
+            for (int jy = ry.first; jy <= ry.second; ++jy) {
+                auto const j = index_type{jx, jy};
+                double const val = value(i, j);
+                if (val != 0) {
+                    entries.push_back({j, val});
+                }
+            }
+        }
+    });
+
+    for (int row = 0; row < nx * ny; ++row) {
+        auto const i = index_type{row / ny, row % ny};
+        for (const auto& e : rows[row]) {
+            emit(i, e.j, e.val);
+        }
+    }
+}
+
+}  // namespace ads
+
+#endif  // COMMON_COUPLED_ASSEMBLY_HPP
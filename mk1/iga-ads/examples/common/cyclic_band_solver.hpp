@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_CYCLIC_BAND_SOLVER_HPP
+#define COMMON_CYCLIC_BAND_SOLVER_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "ads/lin/band_matrix.hpp"
+#include "ads/lin/band_solve.hpp"
+
+namespace ads {
+
+// Square matrix with nonzero entries at cyclic distance at most p from the
+// diagonal, as arising from periodic B-spline bases. Indices of both rows and
+// columns are taken modulo n, so assembly can use wrapped dof indices directly.
+class cyclic_band_matrix {
+private:
+    int n_;
+    int p_;
+    std::vector<double> data_;
+
+public:
+    cyclic_band_matrix(int n, int p)
+    : n_{n}
+    , p_{p}
+    , data_(static_cast<std::size_t>(n) * (2 * p + 1)) {
+        if (n <= 2 * p) {
+            throw std::invalid_argument{
+                fmt::format("Cyclic band matrix of size {} too small for bandwidth {}", n, p)};
+        }
+    }
+
+    int size() const { return n_; }
+
+    int bandwidth() const { return p_; }
+
+    double& operator()(int i, int j) { return data_[index(i, j)]; }
+
+    double operator()(int i, int j) const { return data_[index(i, j)]; }
+
+private:
+    std::size_t index(int i, int j) const {
+        i = wrap(i);
+        int d = wrap(j) - i;
+        if (d > n_ / 2) {
+            d -= n_;
+        } else if (d < -n_ / 2) {
+            d += n_;
+        }
+        assert(std::abs(d) <= p_ && "Entry outside the cyclic band");
+        return static_cast<std::size_t>(i) * (2 * p_ + 1) + d + p_;
+    }
+
+    int wrap(int i) const { return (i % n_ + n_) % n_; }
+};
+
+// Direct solver for cyclic banded systems in O(n p) time per right-hand side.
+//
+// The matrix is split as A = B + U V', where B is its banded part and the
+// p x p corner blocks are written as a rank 2p update. B is factorized with
+// the band LU, and the correction follows from the Sherman-Morrison-Woodbury
+// formula, A^-1 b = y - Z (I + V' Z)^-1 V' y, with y = B^-1 b and Z = B^-1 U
+// computed once. Like dim_data, it can be passed to ads_solve.
+class cyclic_band_solver {
+private:
+    int n_;
+    int p_;
+    lin::band_matrix B_;
+    lin::solver_ctx ctx_;
+    std::vector<double> Z_;    // n x 2p, column-major
+    std::vector<double> H_;    // 2p x 2p LU factors of I + V' Z, column-major
+    std::vector<int> pivots_;  // row interchanges of H_
+
+public:
+    explicit cyclic_band_solver(const cyclic_band_matrix& A)
+    : n_{A.size()}
+    , p_{A.bandwidth()}
+    , B_{p_, p_, n_}
+    , ctx_{B_}
+    , Z_(static_cast<std::size_t>(n_) * 2 * p_)
+    , H_(static_cast<std::size_t>(4) * p_ * p_)
+    , pivots_(2 * p_) {
+        for (int i = 0; i < n_; ++i) {
+            for (int j = std::max(0, i - p_); j <= std::min(n_ - 1, i + p_); ++j) {
+                B_(i, j) = A(i, j);
+            }
+        }
+        // Column k < p of U holds column n - p + k of the upper right corner,
+        // column p + k the column k of the lower left one
+        for (int k = 0; k < p_; ++k) {
+            for (int i = 0; i < k + 1; ++i) {
+                Z_[z_index(i, k)] = A(i, n_ - p_ + k);
+            }
+            for (int i = n_ - p_ + k; i < n_; ++i) {
+                Z_[z_index(i, p_ + k)] = A(i, k);
+            }
+        }
+        lin::factorize(B_, ctx_);
+        lin::solve_with_factorized(B_, Z_.data(), ctx_, 2 * p_);
+
+        int const m = 2 * p_;
+        for (int k = 0; k < m; ++k) {
+            for (int r = 0; r < m; ++r) {
+                H_[r + k * m] = (r == k ? 1 : 0) + Z_[z_index(corner_row(r), k)];
+            }
+        }
+        factorize_capacitance();
+    }
+
+    int size() const { return n_; }
+
+    // Solves count lines of length size() stored one after another in data.
+    // Each call uses its own copy of the solver context, so that calls can run
+    // concurrently.
+    void solve(double* data, int count) const {
+        auto ctx = ctx_;
+        lin::solve_with_factorized(B_, data, ctx, count);
+
+        int const m = 2 * p_;
+        auto s = std::vector<double>(m);
+        for (int l = 0; l < count; ++l) {
+            double* y = data + static_cast<std::size_t>(l) * n_;
+            for (int r = 0; r < m; ++r) {
+                s[r] = y[corner_row(r)];
+            }
+            solve_capacitance(s.data());
+            for (int k = 0; k < m; ++k) {
+                const double* z = Z_.data() + static_cast<std::size_t>(k) * n_;
+                for (int i = 0; i < n_; ++i) {
+                    y[i] -= z[i] * s[k];
+                }
+            }
+        }
+    }
+
+    template <typename Rhs>
+    void operator()(Rhs& rhs) const {
+        solve(rhs.data(), static_cast<int>(rhs.size()) / n_);
+    }
+
+private:
+    std::size_t z_index(int i, int k) const { return i + static_cast<std::size_t>(k) * n_; }
+
+    // Row of the vector picked by the r-th row of V'
+    int corner_row(int r) const { return r < p_ ? n_ - p_ + r : r - p_; }
+
+    // LU decomposition with partial pivoting of the small dense matrix H_
+    void factorize_capacitance() {
+        int const m = 2 * p_;
+        for (int j = 0; j < m; ++j) {
+            int piv = j;
+            for (int i = j + 1; i < m; ++i) {
+                if (std::abs(H_[i + j * m]) > std::abs(H_[piv + j * m])) {
+                    piv = i;
+                }
+            }
+            pivots_[j] = piv;
+            if (H_[piv + j * m] == 0) {
+                throw std::runtime_error{"Cyclic band solver: singular matrix"};
+            }
+            if (piv != j) {
+                for (int k = 0; k < m; ++k) {
+                    std::swap(H_[j + k * m], H_[piv + k * m]);
+                }
+            }
+            for (int i = j + 1; i < m; ++i) {
+                H_[i + j * m] /= H_[j + j * m];
+                for (int k = j + 1; k < m; ++k) {
+                    H_[i + k * m] -= H_[i + j * m] * H_[j + k * m];
+                }
+            }
+        }
+    }
+
+    void solve_capacitance(double* s) const {
+        int const m = 2 * p_;
+        for (int j = 0; j < m; ++j) {
+            std::swap(s[j], s[pivots_[j]]);
+        }
+        for (int i = 0; i < m; ++i) {
+            for (int k = 0; k < i; ++k) {
+                s[i] -= H_[i + k * m] * s[k];
+            }
+        }
+        for (int i = m - 1; i >= 0; --i) {
+            for (int k = i + 1; k < m; ++k) {
+                s[i] -= H_[i + k * m] * s[k];
+            }
+            s[i] /= H_[i + i * m];
+        }
+    }
+};
+
+}  // namespace ads
+
+#endif  // COMMON_CYCLIC_BAND_SOLVER_HPP
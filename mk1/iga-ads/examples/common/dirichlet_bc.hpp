@@ -0,0 +1,266 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_DIRICHLET_BC_HPP
+#define COMMON_DIRICHLET_BC_HPP
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "ads/lin/tensor.hpp"
+#include "ads/simulation.hpp"
+
+namespace ads {
+
+// Dirichlet boundary data prepared for ADS solvers with fixed boundary rows.
+//
+// Boundary values are projected onto the boundary faces, edges and corners
+// once, and stored as a list of (dof, value) pairs that is scattered into the
+// right-hand side before each solve. Each boundary dof is stored once. For
+// time-dependent data the projections are recomputed only when apply is
+// called with a different time.
+template <std::size_t Dim>
+class dirichlet_bc;
+
+template <>
+class dirichlet_bc<2> {
+public:
+    using function_type = std::function<double(double, double, double)>;
+
+private:
+    using index_type = std::array<int, 2>;
+
+    const dimension& x;
+    const dimension& y;
+    function_type f;
+    bool time_dependent;
+
+    std::vector<index_type> indices;
+    std::vector<double> values;
+    double time = 0;
+
+public:
+    // Homogeneous boundary conditions
+    dirichlet_bc(const dimension& x, const dimension& y)
+    : dirichlet_bc{x, y, {}, false} { }
+
+    // f(x, y, t)
+    dirichlet_bc(const dimension& x, const dimension& y, function_type f, bool time_dependent)
+    : x{x}
+    , y{y}
+    , f{std::move(f)}
+    , time_dependent{time_dependent} {
+        project(0);
+    }
+
+    template <typename Tensor>
+    void apply(Tensor& v, double t = 0) {
+        if (time_dependent && t != time) {
+            project(t);
+        }
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            const auto& a = indices[i];
+            v(a[0], a[1]) = values[i];
+        }
+    }
+
+private:
+    double value(double px, double py) const { return f ? f(px, py, time) : 0.0; }
+
+    void add(index_type dof, double val) {
+        indices.push_back(dof);
+        values.push_back(val);
+    }
+
+    template <typename Fun>
+    lin::tensor<double, 1> edge(const dimension& dim, Fun&& fun) const {
+        lin::tensor<double, 1> u{{dim.dofs()}};
+        if (f) {
+            compute_projection(u, dim.basis, fun);
+        }
+        return u;
+    }
+
+    void project(double t) {
+        time = t;
+        indices.clear();
+        values.clear();
+
+        int nx = x.dofs();
+        int ny = y.dofs();
+
+        for (auto [j, py] : {std::pair{0, y.a}, std::pair{ny - 1, y.b}}) {
+            auto u = edge(x, [&, py = py](double px) { return value(px, py); });
+            for (int i = 1; i < nx - 1; ++i) {
+                add({i, j}, u(i));
+            }
+        }
+        for (auto [i, px] : {std::pair{0, x.a}, std::pair{nx - 1, x.b}}) {
+            auto u = edge(y, [&, px = px](double py) { return value(px, py); });
+            for (int j = 1; j < ny - 1; ++j) {
+                add({i, j}, u(j));
+            }
+        }
+        for (auto [i, px] : {std::pair{0, x.a}, std::pair{nx - 1, x.b}}) {
+            for (auto [j, py] : {std::pair{0, y.a}, std::pair{ny - 1, y.b}}) {
+                add({i, j}, value(px, py));
+            }
+        }
+    }
+};
+
+template <>
+class dirichlet_bc<3> {
+public:
+    using function_type = std::function<double(double, double, double, double)>;
+
+private:
+    using index_type = std::array<int, 3>;
+
+    const dimension& x;
+    const dimension& y;
+    const dimension& z;
+    function_type f;
+    bool time_dependent;
+
+    std::vector<index_type> indices;
+    std::vector<double> values;
+    double time = 0;
+
+public:
+    // Homogeneous boundary conditions
+    dirichlet_bc(const dimension& x, const dimension& y, const dimension& z)
+    : dirichlet_bc{x, y, z, {}, false} { }
+
+    // f(x, y, z, t)
+    dirichlet_bc(const dimension& x, const dimension& y, const dimension& z, function_type f,
+                 bool time_dependent)
+    : x{x}
+    , y{y}
+    , z{z}
+    , f{std::move(f)}
+    , time_dependent{time_dependent} {
+        project(0);
+    }
+
+    template <typename Tensor>
+    void apply(Tensor& v, double t = 0) {
+        if (time_dependent && t != time) {
+            project(t);
+        }
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            const auto& a = indices[i];
+            v(a[0], a[1], a[2]) = values[i];
+        }
+    }
+
+private:
+    double value(double px, double py, double pz) const {
+        return f ? f(px, py, pz, time) : 0.0;
+    }
+
+    void add(index_type dof, double val) {
+        indices.push_back(dof);
+        values.push_back(val);
+    }
+
+    template <typename Fun>
+    lin::tensor<double, 1> edge(const dimension& dim, Fun&& fun) const {
+        lin::tensor<double, 1> u{{dim.dofs()}};
+        if (f) {
+            compute_projection(u, dim.basis, fun);
+        }
+        return u;
+    }
+
+    template <typename Fun>
+    lin::tensor<double, 2> face(const dimension& d1, const dimension& d2, Fun&& fun) const {
+        lin::tensor<double, 2> u{{d1.dofs(), d2.dofs()}};
+        if (f) {
+            compute_projection(u, d1.basis, d2.basis, fun);
+        }
+        return u;
+    }
+
+    void project(double t) {
+        time = t;
+        indices.clear();
+        values.clear();
+
+        int nx = x.dofs();
+        int ny = y.dofs();
+        int nz = z.dofs();
+
+        auto xs = {std::pair{0, x.a}, std::pair{nx - 1, x.b}};
+        auto ys = {std::pair{0, y.a}, std::pair{ny - 1, y.b}};
+        auto zs = {std::pair{0, z.a}, std::pair{nz - 1, z.b}};
+
+        // face interiors
+        for (auto [k, pz] : zs) {
+            auto u = face(x, y, [&, pz = pz](double px, double py) { return value(px, py, pz); });
+            for (int i = 1; i < nx - 1; ++i) {
+                for (int j = 1; j < ny - 1; ++j) {
+                    add({i, j, k}, u(i, j));
+                }
+            }
+        }
+        for (auto [i, px] : xs) {
+            auto u = face(y, z, [&, px = px](double py, double pz) { return value(px, py, pz); });
+            for (int j = 1; j < ny - 1; ++j) {
+                for (int k = 1; k < nz - 1; ++k) {
+                    add({i, j, k}, u(j, k));
+                }
+            }
+        }
+        for (auto [j, py] : ys) {
+            auto u = face(x, z, [&, py = py](double px, double pz) { return value(px, py, pz); });
+            for (int i = 1; i < nx - 1; ++i) {
+                for (int k = 1; k < nz - 1; ++k) {
+                    add({i, j, k}, u(i, k));
+                }
+            }
+        }
+
+        // edge interiors
+        for (auto [j, py] : ys) {
+            for (auto [k, pz] : zs) {
+                auto u = edge(x, [&, py = py, pz = pz](double px) { return value(px, py, pz); });
+                for (int i = 1; i < nx - 1; ++i) {
+                    add({i, j, k}, u(i));
+                }
+            }
+        }
+        for (auto [i, px] : xs) {
+            for (auto [k, pz] : zs) {
+                auto u = edge(y, [&, px = px, pz = pz](double py) { return value(px, py, pz); });
+                for (int j = 1; j < ny - 1; ++j) {
+                    add({i, j, k}, u(j));
+                }
+            }
+        }
+        for (auto [i, px] : xs) {
+            for (auto [j, py] : ys) {
+                auto u = edge(z, [&, px = px, py = py](double pz) { return value(px, py, pz); });
+                for (int k = 1; k < nz - 1; ++k) {
+                    add({i, j, k}, u(k));
+                }
+            }
+        }
+
+        // corners
+        for (auto [i, px] : xs) {
+            for (auto [j, py] : ys) {
+                for (auto [k, pz] : zs) {
+                    add({i, j, k}, value(px, py, pz));
+                }
+            }
+        }
+    }
+};
+
+}  // namespace ads
+
+#endif  // COMMON_DIRICHLET_BC_HPP
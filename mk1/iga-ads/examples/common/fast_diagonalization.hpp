@@ -0,0 +1,179 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_FAST_DIAGONALIZATION_HPP
+#define COMMON_FAST_DIAGONALIZATION_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/range/counting_range.hpp>
+#include <fmt/core.h>
+
+#include "parallel_ads.hpp"
+#include "ads/executor/galois.hpp"
+#include "ads/lin/band_matrix.hpp"
+
+extern "C" {
+void dsygv_(int* itype, const char* jobz, const char* uplo, int* n, double* a, int* lda, double* b,
+            int* ldb, double* w, double* work, int* lwork, int* info);
+}
+
+namespace ads {
+
+// Generalized eigendecomposition K v = λ M v of a pair of symmetric 1D
+// matrices, M positive definite. The eigenvectors V are M-orthonormal, so that
+// V' M V = I and V' K V = diag(λ). Matrices passed to the constructor must not
+// be factorized.
+//
+// The decomposition may be restricted to the submatrices of dofs [first, last],
+// e.g. to exclude dofs with homogeneous Dirichlet conditions, which keeps the
+// matrices symmetric. Lines still have all the dofs; the remaining ones are set
+// to zero by both transforms.
+class fdm_direction {
+private:
+    int n_ = 0;
+    int first_ = 0;
+    int m_ = 0;              // number of dofs in [first, last]
+    std::vector<double> V_;  // column-major, eigenvectors in columns
+    std::vector<double> lambda_;
+
+public:
+    fdm_direction() = default;
+
+    fdm_direction(const lin::band_matrix& M, const lin::band_matrix& K)
+    : fdm_direction{M, K, 0, M.rows - 1} { }
+
+    fdm_direction(const lin::band_matrix& M, const lin::band_matrix& K, int first, int last)
+    : n_{M.rows}
+    , first_{first}
+    , m_{last - first + 1}
+    , V_(static_cast<std::size_t>(m_) * m_)
+    , lambda_(n_) {
+        auto B = std::vector<double>(static_cast<std::size_t>(m_) * m_);
+        for (int j = first; j <= last; ++j) {
+            for (int i = std::max(first, j - M.ku); i <= std::min(last, j + M.kl); ++i) {
+                B[local(i, j)] = M(i, j);
+            }
+            for (int i = std::max(first, j - K.ku); i <= std::min(last, j + K.kl); ++i) {
+                V_[local(i, j)] = K(i, j);
+            }
+        }
+
+        int itype = 1;
+        int n = m_;
+        int lwork = std::max(1, 3 * m_ - 1) + 64 * m_;
+        int info = 0;
+        auto work = std::vector<double>(lwork);
+        dsygv_(&itype, "V", "U", &n, V_.data(), &n, B.data(), &n, lambda_.data() + first,
+               work.data(), &lwork, &info);
+        if (info != 0) {
+            throw std::runtime_error{
+                fmt::format("Generalized eigenproblem failed: info = {}", info)};
+        }
+    }
+
+    int size() const { return n_; }
+
+    double eigenvalue(int i) const { return lambda_[i]; }
+
+    // Replaces count lines x starting at data with V' x
+    void to_eigenbasis(double* data, int count) const {
+        auto x = std::vector<double>(m_);
+        for (int l = 0; l < count; ++l) {
+            double* line = data + static_cast<std::size_t>(l) * n_;
+            double* dofs = line + first_;
+            std::copy(dofs, dofs + m_, begin(x));
+            for (int k = 0; k < m_; ++k) {
+                const double* v = column(k);
+                double sum = 0;
+                for (int i = 0; i < m_; ++i) {
+                    sum += v[i] * x[i];
+                }
+                dofs[k] = sum;
+            }
+            clear_fixed(line);
+        }
+    }
+
+    // Replaces count lines y starting at data with V y
+    void from_eigenbasis(double* data, int count) const {
+        auto y = std::vector<double>(m_);
+        for (int l = 0; l < count; ++l) {
+            double* line = data + static_cast<std::size_t>(l) * n_;
+            double* dofs = line + first_;
+            std::copy(dofs, dofs + m_, begin(y));
+            std::fill(dofs, dofs + m_, 0.0);
+            for (int k = 0; k < m_; ++k) {
+                const double* v = column(k);
+                double const a = y[k];
+                for (int i = 0; i < m_; ++i) {
+                    dofs[i] += a * v[i];
+                }
+            }
+            clear_fixed(line);
+        }
+    }
+
+private:
+    std::size_t local(int i, int j) const {
+        return (i - first_) + static_cast<std::size_t>(j - first_) * m_;
+    }
+
+    const double* column(int k) const { return V_.data() + static_cast<std::size_t>(k) * m_; }
+
+    void clear_fixed(double* line) const {
+        std::fill(line, line + first_, 0.0);
+        std::fill(line + first_ + m_, line + n_, 0.0);
+    }
+};
+
+// Exact solver for the sum of Kronecker products
+//
+//   A = M1 ⊗ ... ⊗ Md + sum_i M1 ⊗ ... ⊗ Ki ⊗ ... ⊗ Md
+//
+// i.e. the system of an implicit step with a separable operator, any time step
+// factors being included in Ki. With V = V1 ⊗ ... ⊗ Vd the matrix V' A V is
+// diagonal with entries 1 + λ1 + ... + λd, so the solution is obtained by
+// transforming the right-hand side to the eigenbasis, scaling it and
+// transforming it back, without splitting error and at O(N n) cost. Dofs
+// excluded from the decomposition of any direction are zero in the solution.
+template <typename Rhs, typename... Dirs>
+void fdm_solve(Rhs& rhs, Rhs& buffer, galois_executor& executor, const Dirs&... dirs) {
+    constexpr auto N = sizeof...(Dirs);
+    auto const ds = std::array<const fdm_direction*, N>{&dirs...};
+    auto const shape = tensor_shape<N>(rhs);
+
+    auto const forward = [&](std::size_t dir, double* lines, int count) {
+        ds[dir]->to_eigenbasis(lines, count);
+    };
+    auto const backward = [&](std::size_t dir, double* lines, int count) {
+        ds[dir]->from_eigenbasis(lines, count);
+    };
+
+    parallel_sweep(rhs.data(), buffer.data(), shape, executor, forward);
+
+    // Lines along the first direction, in parallel
+    int const n = shape[0];
+    int const lines = static_cast<int>(rhs.size()) / n;
+    executor.for_each(boost::counting_range(0, lines), [&](int line) {
+        double sum = 1;
+        for (std::size_t d = 1, rest = line; d < N; ++d) {
+            sum += ds[d]->eigenvalue(static_cast<int>(rest % shape[d]));
+            rest /= shape[d];
+        }
+        double* x = rhs.data() + static_cast<std::size_t>(line) * n;
+        for (int i = 0; i < n; ++i) {
+            x[i] /= sum + ds[0]->eigenvalue(i);
+        }
+    });
+
+    parallel_sweep(rhs.data(), buffer.data(), shape, executor, backward);
+}
+
+}  // namespace ads
+
+#endif  // COMMON_FAST_DIAGONALIZATION_HPP
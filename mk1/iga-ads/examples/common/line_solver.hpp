@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_LINE_SOLVER_HPP
+#define COMMON_LINE_SOLVER_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+#include <boost/range/counting_range.hpp>
+
+#include "ads/executor/galois.hpp"
+#include "ads/lin/band_matrix.hpp"
+#include "ads/lin/band_solve.hpp"
+#include "ads/lin/tensor.hpp"
+
+namespace ads {
+
+// Direction solver for ads_solve with a different banded operator on each
+// line, e.g. for variable coefficients. Lines are indexed by the two
+// transverse dofs (i, j) and stored one after another in the right-hand side,
+// i varying fastest. The lines are independent, so both factorization and
+// solution are performed in parallel.
+class line_solver {
+private:
+    using matrix = lin::band_matrix;
+    using context = lin::solver_ctx;
+
+    struct entry {
+        matrix mat;
+        context ctx;
+
+        entry()
+        : ctx{mat} { }
+
+        explicit entry(matrix mat)
+        : mat{std::move(mat)}
+        , ctx{this->mat} { }
+    };
+
+    using entry_table = lin::tensor<entry, 2>;
+
+    entry_table entries_;
+    galois_executor* executor_;
+
+public:
+    line_solver(int n, int m, galois_executor& executor)
+    : entries_{{n, m}}
+    , executor_{&executor} { }
+
+    int lines() const { return entries_.size(0) * entries_.size(1); }
+
+    auto set_matrix(int i, int j, matrix mat) -> void {
+        assert(i < entries_.size(0));
+        assert(j < entries_.size(1));
+
+        auto e = entry{std::move(mat)};
+        lin::factorize(e.mat, e.ctx);
+
+        entries_(i, j) = std::move(e);
+    }
+
+    // Builds and factorizes matrices of all the lines in parallel, make_matrix(i, j)
+    // being called concurrently for different lines
+    template <typename MatrixFun>
+    auto factorize_all(MatrixFun&& make_matrix) -> void {
+        for_each_line([&](int i, int j) { set_matrix(i, j, make_matrix(i, j)); });
+    }
+
+    template <typename Rhs>
+    auto operator()(Rhs& rhs) -> void {
+        auto* data = rhs.data();
+        auto const rhs_size = rhs.size(0);
+        auto const n = entries_.size(0);
+
+        for_each_line([&](int i, int j) {
+            auto& entry = entries_(i, j);
+            auto const offset = static_cast<std::ptrdiff_t>(j * n + i) * rhs_size;
+            solve_with_factorized(entry.mat, data + offset, entry.ctx, 1);
+        });
+    }
+
+private:
+    template <typename Fun>
+    auto for_each_line(Fun&& fun) -> void {
+        auto const n = entries_.size(0);
+        executor_->for_each(boost::counting_range(0, lines()), [&](int line) {
+            fun(line % n, line / n);
+        });
+    }
+};
+
+}  // namespace ads
+
+#endif  // COMMON_LINE_SOLVER_HPP
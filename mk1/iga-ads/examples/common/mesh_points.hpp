@@ -0,0 +1,309 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_MESH_POINTS_HPP
+#define COMMON_MESH_POINTS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "ads/bspline/bspline.hpp"
+#include "ads/simulation/dimension.hpp"
+#include "ads/util.hpp"
+
+namespace ads {
+
+// 1D meshes are described by the increasing sequence of their points, i.e.
+// element boundaries including both ends of the interval
+
+inline std::vector<double> uniform_points(double a, double b, int elements) {
+    auto points = std::vector<double>(elements + 1);
+    for (int i = 0; i <= elements; ++i) {
+        points[i] = lerp(i, elements, a, b);
+    }
+    return points;
+}
+
+// Points of the mesh of basis B
+inline std::vector<double> mesh_points(const bspline::basis& B) {
+    auto points = std::vector<double>{};
+    for (double t : B.knot) {
+        if (points.empty() || t > points.back()) {
+            points.push_back(t);
+        }
+    }
+    return points;
+}
+
+// Whether the elements of U and V, after subdivision, coincide, so that values
+// computed at the quadrature points of one of them can be used with the basis
+// data of the other. Compared point-wise, as equal element counts do not
+// imply equal meshes.
+inline bool same_quadrature(const dimension& U, const dimension& V) {
+    const auto& bu = U.basis;
+    const auto& bv = V.basis;
+    if (U.elements != V.elements || bu.quad_order != bv.quad_order) {
+        return false;
+    }
+    double const tol = 1e-12 * std::abs(U.b - U.a);
+    for (int e = 0; e < U.elements; ++e) {
+        for (int q = 0; q < bu.quad_order; ++q) {
+            if (std::abs(bu.x[e][q] - bv.x[e][q]) > tol) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+struct mesh_region {
+    double a;
+    double b;
+};
+
+inline mesh_region around(double center, double radius) {
+    return {center - radius, center + radius};
+}
+
+// Splits each element intersecting any of the regions into factor elements of
+// equal size. In a tensor product space this refines the strips crossing the
+// regions, so only dofs along the refined directions are added.
+inline std::vector<double> refine_points(const std::vector<double>& points,
+                                         const std::vector<mesh_region>& regions, int factor) {
+    if (factor < 1) {
+        throw std::invalid_argument{fmt::format("Invalid refinement factor: {}", factor)};
+    }
+    auto refined = std::vector<double>{points.front()};
+    for (std::size_t e = 0; e + 1 < points.size(); ++e) {
+        double const a = points[e];
+        double const b = points[e + 1];
+
+        bool marked = false;
+        for (const auto& r : regions) {
+            marked = marked || (a < r.b && r.a < b);
+        }
+        int const k = marked ? factor : 1;
+        for (int i = 1; i <= k; ++i) {
+            refined.push_back(lerp(i, k, a, b));
+        }
+    }
+    return refined;
+}
+
+// B-spline basis of degree p on the given mesh, with interior points repeated
+// repeated_nodes + 1 times in the knot vector
+inline bspline::basis basis_from_points(const std::vector<double>& points, int p,
+                                        int repeated_nodes) {
+    auto elems = narrow_cast<int>(points.size()) - 1;
+    int r = repeated_nodes + 1;
+    int size = (elems - 1) * r + 2 * (p + 1);
+    auto knot = bspline::knot_vector(size);
+
+    for (int i = 0; i <= p; ++i) {
+        knot[i] = points[0];
+        knot[size - i - 1] = points[elems];
+    }
+
+    for (int i = 1; i < elems; ++i) {
+        for (int j = 0; j < r; ++j) {
+            knot[p + 1 + (i - 1) * r + j] = points[i];
+        }
+    }
+    return {std::move(knot), p};
+}
+
+enum class mesh_type { uniform, shishkin, bakhvalov, graded };
+
+enum class layer_side { left, right, both };
+
+// Layer-adapted 1D mesh. Widths are relative to the length of the interval.
+//
+// - shishkin: piecewise uniform, half of the elements in the layer of given
+//   width, see shishkin_width
+// - bakhvalov: logarithmic in the layer and uniform outside it, with width the
+//   layer scale sigma * eps, where eps is the diffusion coefficient and sigma
+//   is usually taken as p + 1
+// - graded: half of the elements in the layer of given width, with sizes
+//   growing geometrically away from the layer with the given ratio, and
+//   uniform outside it. The ratio is reduced if the smallest elements would
+//   be more than max_grading times smaller than the largest ones in the layer.
+struct mesh_config {
+    mesh_type type = mesh_type::uniform;
+    double width = 0.01;
+    double ratio = 1.2;
+    layer_side side = layer_side::right;
+};
+
+// Bound on the ratio of element sizes within the layer of the graded mesh,
+// which keeps the elements next to the layer representable
+constexpr double max_grading = 1e8;
+
+// Transition point of the Shishkin mesh with n elements for diffusion eps
+inline double shishkin_width(int n, double eps) {
+    return std::min(0.5, std::log2(n) * eps);
+}
+
+// Parses "<type>[:<width or ratio>][:<side>]", e.g. "shishkin:1e-3", "graded:1.5:both".
+// Values that are not given are taken from defaults. For compatibility with
+// the older drivers, "0" and "1" stand for the uniform and the Shishkin mesh.
+inline mesh_config parse_mesh_config(const std::string& spec, mesh_config defaults = {}) {
+    auto parts = std::vector<std::string>{};
+    std::size_t begin = 0;
+    while (true) {
+        auto const end = spec.find(':', begin);
+        parts.push_back(spec.substr(begin, end - begin));
+        if (end == std::string::npos) {
+            break;
+        }
+        begin = end + 1;
+    }
+    if (parts.size() > 3) {
+        throw std::invalid_argument{fmt::format("Invalid mesh: {}", spec)};
+    }
+
+    auto cfg = defaults;
+    const auto& type = parts[0];
+    if (type == "uniform" || type == "0") {
+        cfg.type = mesh_type::uniform;
+    } else if (type == "shishkin" || type == "1") {
+        cfg.type = mesh_type::shishkin;
+    } else if (type == "bakhvalov") {
+        cfg.type = mesh_type::bakhvalov;
+    } else if (type == "graded") {
+        cfg.type = mesh_type::graded;
+    } else {
+        throw std::invalid_argument{fmt::format("Unknown mesh type: {}", type)};
+    }
+
+    if (parts.size() > 1 && !parts[1].empty()) {
+        double const value = std::stod(parts[1]);
+        if (cfg.type == mesh_type::graded) {
+            cfg.ratio = value;
+        } else {
+            cfg.width = value;
+        }
+    }
+    if (parts.size() > 2) {
+        const auto& side = parts[2];
+        if (side == "left") {
+            cfg.side = layer_side::left;
+        } else if (side == "right") {
+            cfg.side = layer_side::right;
+        } else if (side == "both") {
+            cfg.side = layer_side::both;
+        } else {
+            throw std::invalid_argument{fmt::format("Unknown layer side: {}", side)};
+        }
+    }
+    if (cfg.width <= 0 || cfg.ratio < 1) {
+        throw std::invalid_argument{fmt::format("Invalid mesh parameters: {}", spec)};
+    }
+    return cfg;
+}
+
+namespace detail {
+
+// Mesh generating function of the mesh with the layer at 0, mapping the
+// uniform mesh of [0, 1] with n elements onto the adapted one
+inline double layer_map(mesh_type type, double width, double ratio, int n, double t) {
+    switch (type) {
+    case mesh_type::uniform:
+        return t;
+
+    case mesh_type::shishkin: {
+        double const w = std::min(width, 0.5);
+        return t < 0.5 ? 2 * t * w : w + (2 * t - 1) * (1 - w);
+    }
+
+    case mesh_type::bakhvalov: {
+        // -width ln(1 - t/q) up to tau, tangent line reaching (1, 1) after
+        double const q = 0.5;
+        if (width >= q) {
+            return t;
+        }
+        auto phi = [&](double s) { return -width * std::log(1 - s / q); };
+        auto dphi = [&](double s) { return width / (q - s); };
+
+        double lo = 0;
+        double hi = q;
+        for (int i = 0; i < 100; ++i) {
+            double const tau = (lo + hi) / 2;
+            if (dphi(tau) * (1 - tau) < 1 - phi(tau)) {
+                lo = tau;
+            } else {
+                hi = tau;
+            }
+        }
+        double const tau = lo;
+        return t <= tau ? phi(t) : phi(tau) + dphi(tau) * (t - tau);
+    }
+
+    case mesh_type::graded: {
+        double const w = std::min(width, 0.5);
+        if (t >= 0.5) {
+            return w + (2 * t - 1) * (1 - w);
+        }
+        // m elements in [0, w], points w (r^(m s) - 1) / (r^m - 1) written so
+        // that they do not overflow
+        int const m = std::max(n / 2, 1);
+        double const r = std::min(ratio, std::pow(max_grading, 1.0 / m));
+        double const s = 2 * t;
+        if (r == 1) {
+            return s * w;
+        }
+        double const rm = std::pow(r, -m);
+        return w * (std::pow(r, m * (s - 1)) - rm) / (1 - rm);
+    }
+    }
+    return t;
+}
+
+}  // namespace detail
+
+// Points of the layer-adapted mesh of [a, b] with given number of elements
+inline std::vector<double> layer_points(const mesh_config& cfg, double a, double b,
+                                        int elements) {
+    auto map = [&](double t) {
+        using detail::layer_map;
+        switch (cfg.side) {
+        case layer_side::left:
+            return layer_map(cfg.type, cfg.width, cfg.ratio, elements, t);
+        case layer_side::right:
+            return 1 - layer_map(cfg.type, cfg.width, cfg.ratio, elements, 1 - t);
+        case layer_side::both: {
+            // layer of the same width at each end of the halves
+            int const half = std::max(elements / 2, 1);
+            double const w = 2 * cfg.width;
+            if (t < 0.5) {
+                return layer_map(cfg.type, w, cfg.ratio, half, 2 * t) / 2;
+            }
+            return 1 - layer_map(cfg.type, w, cfg.ratio, half, 2 - 2 * t) / 2;
+        }
+        }
+        return t;
+    };
+
+    auto points = std::vector<double>(elements + 1);
+    points[0] = a;
+    points[elements] = b;
+    for (int i = 1; i < elements; ++i) {
+        points[i] = lerp(map(lerp(i, elements, 0.0, 1.0)), a, b);
+    }
+    for (int i = 1; i <= elements; ++i) {
+        if (points[i] <= points[i - 1]) {
+            throw std::invalid_argument{fmt::format(
+                "Layer mesh: element {} of {} too small to represent", i - 1, elements)};
+        }
+    }
+    return points;
+}
+
+}  // namespace ads
+
+#endif  // COMMON_MESH_POINTS_HPP
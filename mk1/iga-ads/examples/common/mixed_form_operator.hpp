@@ -0,0 +1,318 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_MIXED_FORM_OPERATOR_HPP
+#define COMMON_MIXED_FORM_OPERATOR_HPP
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/range/counting_range.hpp>
+#include <fmt/core.h>
+
+#include "ads/executor/galois.hpp"
+#include "ads/simulation.hpp"
+#include "mesh_points.hpp"
+
+namespace ads {
+
+// Coefficients of the bilinear form
+//
+//   b(u, v) = (ax u_x, v_x) + (ay u_y, v_y) + (bx u_x + by u_y, v) + (c u, v)
+//
+// at a single point
+struct form_coefficients {
+    double ax = 0;
+    double ay = 0;
+    double bx = 0;
+    double by = 0;
+    double c = 0;
+};
+
+// Matrix-free action of the operator B : U -> V' of a bilinear form b(u, v)
+// with u in the trial space U = Ux x Uy and v in the test space V = Vx x Vy,
+// and of its transpose.
+//
+// Coefficients are evaluated once, in the constructor or in set_coefficients,
+// and stored for each quadrature point premultiplied by the quadrature weight
+// and jacobian.
+// Functions are evaluated at quadrature points and tested with basis functions
+// using sum factorization, one direction at a time, which takes O(p q^2)
+// operations per element instead of O(p^2 q^2). Both actions can be computed
+// in a single pass over the elements.
+//
+// Both spaces need to be defined on the same mesh, with the same quadrature.
+class mixed_form_operator {
+public:
+    using point_type = std::array<double, 2>;
+
+private:
+    // Values and derivatives of a function at quadrature points of an element
+    struct point_values {
+        std::vector<double> val;
+        std::vector<double> dx;
+        std::vector<double> dy;
+    };
+
+    const dimension* Ux_;
+    const dimension* Uy_;
+    const dimension* Vx_;
+    const dimension* Vy_;
+    galois_executor* executor_;
+
+    int ex_;
+    int ey_;
+    int qx_;
+    int qy_;
+    std::vector<form_coefficients> coeffs_;
+
+public:
+    template <typename Coeffs>
+    mixed_form_operator(const dimension& Ux, const dimension& Uy, const dimension& Vx,
+                        const dimension& Vy, galois_executor& executor, Coeffs&& coeffs)
+    : Ux_{&Ux}
+    , Uy_{&Uy}
+    , Vx_{&Vx}
+    , Vy_{&Vy}
+    , executor_{&executor}
+    , ex_{Vx.elements}
+    , ey_{Vy.elements}
+    , qx_{Vx.basis.quad_order}
+    , qy_{Vy.basis.quad_order} {
+        check_mesh(Ux, Vx);
+        check_mesh(Uy, Vy);
+        set_coefficients(std::forward<Coeffs>(coeffs));
+    }
+
+    // Replaces the coefficients, e.g. when they depend on time
+    template <typename Coeffs>
+    void set_coefficients(Coeffs&& coeffs) {
+        const auto& Vx = Vx_->basis;
+        const auto& Vy = Vy_->basis;
+
+        coeffs_.resize(static_cast<std::size_t>(ex_) * ey_ * qx_ * qy_);
+        for (int ix = 0; ix < ex_; ++ix) {
+            for (int iy = 0; iy < ey_; ++iy) {
+                double J = Vx.J[ix] * Vy.J[iy];
+                for (int kx = 0; kx < qx_; ++kx) {
+                    for (int ky = 0; ky < qy_; ++ky) {
+                        auto x = point_type{Vx.x[ix][kx], Vy.x[iy][ky]};
+                        double w = Vx.w[kx] * Vy.w[ky] * J;
+                        form_coefficients c = coeffs(x);
+                        coeffs_[index(ix, iy, kx, ky)] = {w * c.ax, w * c.ay, w * c.bx, w * c.by,
+                                                          w * c.c};
+                    }
+                }
+            }
+        }
+    }
+
+    // result += alpha B u
+    template <typename In, typename Out>
+    void apply(const In& u, Out& result, double alpha = 1) const {
+        Out* none = nullptr;
+        sweep(&u, &result, static_cast<const Out*>(none), none, alpha, 0);
+    }
+
+    // result += alpha B' r
+    template <typename In, typename Out>
+    void apply_transpose(const In& r, Out& result, double alpha = 1) const {
+        Out* none = nullptr;
+        sweep(static_cast<const In*>(nullptr), none, &r, &result, 0, alpha);
+    }
+
+    // bu += alpha B u, btr += alpha_t B' r, in a single pass
+    template <typename InU, typename InV, typename OutV, typename OutU>
+    void apply(const InU& u, const InV& r, OutV& bu, OutU& btr, double alpha,
+               double alpha_t) const {
+        sweep(&u, &bu, &r, &btr, alpha, alpha_t);
+    }
+
+    // result += alpha F, where F(v) = (f, v) is the load vector of the test space
+    template <typename Fun, typename Out>
+    void load(Fun&& f, Out& result, double alpha = 1) const {
+        executor_->for_each(boost::counting_range(0, ex_ * ey_), [&](int e) {
+            int ix = e / ey_;
+            int iy = e % ey_;
+            auto g0 = std::vector<double>(qx_ * qy_);
+            auto zero = std::vector<double>(qx_ * qy_);
+            double J = Vx_->basis.J[ix] * Vy_->basis.J[iy];
+
+            for (int kx = 0; kx < qx_; ++kx) {
+                for (int ky = 0; ky < qy_; ++ky) {
+                    auto x = point_type{Vx_->basis.x[ix][kx], Vy_->basis.x[iy][ky]};
+                    double w = Vx_->basis.w[kx] * Vy_->basis.w[ky] * J;
+                    g0[kx * qy_ + ky] = alpha * w * f(x);
+                }
+            }
+            auto loc = test(*Vx_, *Vy_, ix, iy, g0, zero, zero);
+            executor_->synchronized([&] { scatter(loc, *Vx_, *Vy_, ix, iy, result); });
+        });
+    }
+
+private:
+    static void check_mesh(const dimension& U, const dimension& V) {
+        if (!same_quadrature(U, V)) {
+            throw std::invalid_argument{fmt::format(
+                "Mixed form operator: trial and test meshes differ ({} and {} elements)",
+                U.elements, V.elements)};
+        }
+    }
+
+    std::size_t index(int ix, int iy, int kx, int ky) const {
+        return ((static_cast<std::size_t>(ix) * ey_ + iy) * qx_ + kx) * qy_ + ky;
+    }
+
+    static int local_dofs(const dimension& d, int e) {
+        return d.basis.last_dof(e) - d.basis.first_dof(e) + 1;
+    }
+
+    template <typename InU, typename OutV, typename InV, typename OutU>
+    void sweep(const InU* u, OutV* bu, const InV* r, OutU* btr, double alpha,
+               double alpha_t) const {
+        executor_->for_each(boost::counting_range(0, ex_ * ey_), [&](int e) {
+            int ix = e / ey_;
+            int iy = e % ey_;
+            int const nq = qx_ * qy_;
+            auto g0 = std::vector<double>(nq);
+            auto gx = std::vector<double>(nq);
+            auto gy = std::vector<double>(nq);
+            const auto* C = &coeffs_[index(ix, iy, 0, 0)];
+
+            std::vector<double> loc_v;
+            std::vector<double> loc_u;
+
+            if (u != nullptr) {
+                auto f = evaluate(*u, *Ux_, *Uy_, ix, iy);
+                for (int k = 0; k < nq; ++k) {
+                    g0[k] = alpha * (C[k].bx * f.dx[k] + C[k].by * f.dy[k] + C[k].c * f.val[k]);
+                    gx[k] = alpha * C[k].ax * f.dx[k];
+                    gy[k] = alpha * C[k].ay * f.dy[k];
+                }
+                loc_v = test(*Vx_, *Vy_, ix, iy, g0, gx, gy);
+            }
+            if (r != nullptr) {
+                auto f = evaluate(*r, *Vx_, *Vy_, ix, iy);
+                for (int k = 0; k < nq; ++k) {
+                    g0[k] = alpha_t * C[k].c * f.val[k];
+                    gx[k] = alpha_t * (C[k].ax * f.dx[k] + C[k].bx * f.val[k]);
+                    gy[k] = alpha_t * (C[k].ay * f.dy[k] + C[k].by * f.val[k]);
+                }
+                loc_u = test(*Ux_, *Uy_, ix, iy, g0, gx, gy);
+            }
+
+            executor_->synchronized([&] {
+                if (bu != nullptr) {
+                    scatter(loc_v, *Vx_, *Vy_, ix, iy, *bu);
+                }
+                if (btr != nullptr) {
+                    scatter(loc_u, *Ux_, *Uy_, ix, iy, *btr);
+                }
+            });
+        });
+    }
+
+    // Values and gradient at quadrature points of element (ix, iy) of the
+    // function with coefficients c in the basis of (X, Y)
+    template <typename In>
+    point_values evaluate(const In& c, const dimension& X, const dimension& Y, int ix,
+                          int iy) const {
+        int const na = local_dofs(X, ix);
+        int const nb = local_dofs(Y, iy);
+        int const a0 = X.basis.first_dof(ix);
+        int const b0 = Y.basis.first_dof(iy);
+
+        // t0(a, ky) = sum_b c(a, b) Y_b(ky), t1 - with derivatives Y_b'
+        auto t0 = std::vector<double>(na * qy_);
+        auto t1 = std::vector<double>(na * qy_);
+        for (int a = 0; a < na; ++a) {
+            for (int ky = 0; ky < qy_; ++ky) {
+                const double* B0 = Y.basis.b[iy][ky][0];
+                const double* B1 = Y.basis.b[iy][ky][1];
+                double s0 = 0;
+                double s1 = 0;
+                for (int b = 0; b < nb; ++b) {
+                    double cab = c(a0 + a, b0 + b);
+                    s0 += cab * B0[b];
+                    s1 += cab * B1[b];
+                }
+                t0[a * qy_ + ky] = s0;
+                t1[a * qy_ + ky] = s1;
+            }
+        }
+
+        int const nq = qx_ * qy_;
+        auto f = point_values{std::vector<double>(nq), std::vector<double>(nq),
+                              std::vector<double>(nq)};
+        for (int kx = 0; kx < qx_; ++kx) {
+            const double* A0 = X.basis.b[ix][kx][0];
+            const double* A1 = X.basis.b[ix][kx][1];
+            for (int a = 0; a < na; ++a) {
+                for (int ky = 0; ky < qy_; ++ky) {
+                    int k = kx * qy_ + ky;
+                    f.val[k] += A0[a] * t0[a * qy_ + ky];
+                    f.dx[k] += A1[a] * t0[a * qy_ + ky];
+                    f.dy[k] += A0[a] * t1[a * qy_ + ky];
+                }
+            }
+        }
+        return f;
+    }
+
+    // Local vector of integrals of g0 v + gx v_x + gy v_y over element (ix, iy)
+    // for basis functions v of (X, Y), stored row-major
+    std::vector<double> test(const dimension& X, const dimension& Y, int ix, int iy,
+                             const std::vector<double>& g0, const std::vector<double>& gx,
+                             const std::vector<double>& gy) const {
+        int const na = local_dofs(X, ix);
+        int const nb = local_dofs(Y, iy);
+
+        // s0(kx, b) = sum_ky g0 Y_b + gy Y_b', s1(kx, b) = sum_ky gx Y_b
+        auto s0 = std::vector<double>(qx_ * nb);
+        auto s1 = std::vector<double>(qx_ * nb);
+        for (int kx = 0; kx < qx_; ++kx) {
+            for (int ky = 0; ky < qy_; ++ky) {
+                int k = kx * qy_ + ky;
+                const double* B0 = Y.basis.b[iy][ky][0];
+                const double* B1 = Y.basis.b[iy][ky][1];
+                for (int b = 0; b < nb; ++b) {
+                    s0[kx * nb + b] += g0[k] * B0[b] + gy[k] * B1[b];
+                    s1[kx * nb + b] += gx[k] * B0[b];
+                }
+            }
+        }
+
+        auto loc = std::vector<double>(na * nb);
+        for (int kx = 0; kx < qx_; ++kx) {
+            const double* A0 = X.basis.b[ix][kx][0];
+            const double* A1 = X.basis.b[ix][kx][1];
+            for (int a = 0; a < na; ++a) {
+                for (int b = 0; b < nb; ++b) {
+                    loc[a * nb + b] += A0[a] * s0[kx * nb + b] + A1[a] * s1[kx * nb + b];
+                }
+            }
+        }
+        return loc;
+    }
+
+    template <typename Out>
+    static void scatter(const std::vector<double>& loc, const dimension& X, const dimension& Y,
+                        int ix, int iy, Out& out) {
+        int const na = local_dofs(X, ix);
+        int const nb = local_dofs(Y, iy);
+        int const a0 = X.basis.first_dof(ix);
+        int const b0 = Y.basis.first_dof(iy);
+        for (int a = 0; a < na; ++a) {
+            for (int b = 0; b < nb; ++b) {
+                out(a0 + a, b0 + b) += loc[a * nb + b];
+            }
+        }
+    }
+};
+
+}  // namespace ads
+
+#endif  // COMMON_MIXED_FORM_OPERATOR_HPP
@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_MIXED_PRECISION_ADS_HPP
+#define COMMON_MIXED_PRECISION_ADS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <boost/range/counting_range.hpp>
+
+#include "batched_band_solver.hpp"
+#include "parallel_ads.hpp"
+#include "ads/executor/galois.hpp"
+#include "ads/lin/band_matrix.hpp"
+
+namespace ads {
+
+// Direction of mixed_ads_solver - single precision factorization of a banded
+// matrix, together with the matrix itself in double precision, used to compute
+// residuals. The matrix passed to the constructor must not be factorized.
+class mixed_direction {
+private:
+    int n_ = 0;
+    int kl_ = 0;
+    int ku_ = 0;
+    std::vector<double> rows_;
+    basic_batched_band_solver<float> solver_;
+
+public:
+    mixed_direction() = default;
+
+    explicit mixed_direction(const lin::band_matrix& M)
+    : n_{M.rows}
+    , kl_{M.kl}
+    , ku_{M.ku}
+    , rows_(static_cast<std::size_t>(n_) * (kl_ + ku_ + 1))
+    , solver_{M} {
+        for (int i = 0; i < n_; ++i) {
+            for (int k = first_col(i); k <= last_col(i); ++k) {
+                rows_[index(i, k)] = M(i, k);
+            }
+        }
+    }
+
+    void solve(double* data, int count) const { solver_.solve(data, count); }
+
+    // Replaces count lines starting at data with their products with the matrix.
+    // Like solve, calls may run concurrently, so the copy of the current line
+    // is kept in a buffer of the calling thread, allocated on its first call.
+    void multiply(double* data, int count) const {
+        thread_local auto line = std::vector<double>{};
+        line.resize(n_);
+        for (int l = 0; l < count; ++l) {
+            double* x = data + static_cast<std::size_t>(l) * n_;
+            std::copy(x, x + n_, begin(line));
+            for (int i = 0; i < n_; ++i) {
+                double sum = 0;
+                for (int k = first_col(i); k <= last_col(i); ++k) {
+                    sum += rows_[index(i, k)] * line[k];
+                }
+                x[i] = sum;
+            }
+        }
+    }
+
+private:
+    int first_col(int i) const { return std::max(0, i - kl_); }
+
+    int last_col(int i) const { return std::min(n_ - 1, i + ku_); }
+
+    std::size_t index(int i, int k) const {
+        return static_cast<std::size_t>(i) * (kl_ + ku_ + 1) + k - i + kl_;
+    }
+};
+
+struct refinement_report {
+    int sweeps = 0;
+    double residual = 0;  // relative, in the Euclidean norm
+};
+
+// Mixed precision variant of parallel_ads_solve. The system is solved with
+// single precision factorizations, after which the residual of the Kronecker
+// product operator is computed in double precision and the solution corrected,
+// until the relative residual drops below the tolerance or the sweep limit is
+// reached. Halving the size of the factors and of the substitution working set
+// relieves memory bandwidth, which bounds the solve for large problems.
+class mixed_ads_solver {
+private:
+    galois_executor* executor_;
+    double tolerance_;
+    int max_sweeps_;
+
+    std::vector<double> b_;
+    std::vector<double> r_;
+
+public:
+    explicit mixed_ads_solver(galois_executor& executor, double tolerance = 1e-12,
+                              int max_sweeps = 3)
+    : executor_{&executor}
+    , tolerance_{tolerance}
+    , max_sweeps_{max_sweeps} { }
+
+    template <typename Rhs, typename... Dirs>
+    refinement_report operator()(Rhs& rhs, Rhs& buffer, const Dirs&... dirs) {
+        constexpr auto N = sizeof...(Dirs);
+        auto const ds = std::array<const mixed_direction*, N>{&dirs...};
+        auto const shape = tensor_shape<N>(rhs);
+        auto const total = static_cast<std::size_t>(rhs.size());
+
+        auto const solve = [&](std::size_t dir, double* lines, int count) {
+            ds[dir]->solve(lines, count);
+        };
+        auto const multiply = [&](std::size_t dir, double* lines, int count) {
+            ds[dir]->multiply(lines, count);
+        };
+
+        double* x = rhs.data();
+        b_.assign(x, x + total);
+        r_.resize(total);
+        double const norm_b = std::sqrt(sum_squares(b_.data(), total));
+
+        parallel_sweep(x, buffer.data(), shape, *executor_, solve);
+
+        auto report = refinement_report{};
+        report.residual = residual(x, buffer.data(), shape, multiply, norm_b);
+
+        while (report.residual > tolerance_ && report.sweeps < max_sweeps_) {
+            parallel_sweep(r_.data(), buffer.data(), shape, *executor_, solve);
+            for_each_chunk(total, [&](std::size_t i) { x[i] += r_[i]; });
+
+            ++report.sweeps;
+            report.residual = residual(x, buffer.data(), shape, multiply, norm_b);
+        }
+        return report;
+    }
+
+private:
+    // Computes r = b - Ax and returns |r| / |b|
+    template <std::size_t N, typename Multiply>
+    double residual(const double* x, double* buffer, const std::array<int, N>& shape,
+                    const Multiply& multiply, double norm_b) {
+        auto const total = r_.size();
+        for_each_chunk(total, [&](std::size_t i) { r_[i] = x[i]; });
+        parallel_sweep(r_.data(), buffer, shape, *executor_, multiply);
+        for_each_chunk(total, [&](std::size_t i) { r_[i] = b_[i] - r_[i]; });
+
+        double const norm_r = std::sqrt(sum_squares(r_.data(), total));
+        return norm_b > 0 ? norm_r / norm_b : norm_r;
+    }
+
+    double sum_squares(const double* v, std::size_t total) {
+        double sum = 0;
+        for_chunks(total, [&](std::size_t first, std::size_t last) {
+            double local = 0;
+            for (auto i = first; i < last; ++i) {
+                local += v[i] * v[i];
+            }
+            executor_->synchronized([&] { sum += local; });
+        });
+        return sum;
+    }
+
+    template <typename Fun>
+    void for_each_chunk(std::size_t total, Fun&& fun) {
+        for_chunks(total, [&](std::size_t first, std::size_t last) {
+            for (auto i = first; i < last; ++i) {
+                fun(i);
+            }
+        });
+    }
+
+    template <typename Fun>
+    void for_chunks(std::size_t total, Fun&& fun) {
+        constexpr std::size_t chunk = 4096;
+        auto const chunks = static_cast<int>((total + chunk - 1) / chunk);
+        executor_->for_each(boost::counting_range(0, chunks), [&](int c) {
+            auto const first = static_cast<std::size_t>(c) * chunk;
+            fun(first, std::min(first + chunk, total));
+        });
+    }
+};
+
+}  // namespace ads
+
+#endif  // COMMON_MIXED_PRECISION_ADS_HPP
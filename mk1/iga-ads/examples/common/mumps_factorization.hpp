@@ -0,0 +1,202 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_MUMPS_FACTORIZATION_HPP
+#define COMMON_MUMPS_FACTORIZATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <dmumps_c.h>
+#include <fmt/core.h>
+
+#include "ads/solver/mumps.hpp"
+
+namespace ads::mumps {
+
+constexpr std::uint64_t fingerprint_seed = 14695981039346656037ULL;
+
+// Cheap hash of a sequence of trivially copyable values, used to detect
+// changes of the matrix between factorization and solve.
+template <typename T>
+std::uint64_t fingerprint(const T* data, std::size_t count, std::uint64_t h = fingerprint_seed) {
+    for (std::size_t i = 0; i < count; ++i) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, &data[i], sizeof(T) < sizeof(word) ? sizeof(T) : sizeof(word));
+        h = (h ^ word) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// Key identifying a matrix by the scalar parameters it is assembled from, for
+// callers that do not keep the assembled problem
+template <typename... Ts>
+std::uint64_t matrix_key(const Ts&... values) {
+    static_assert((std::is_arithmetic_v<Ts> && ...), "Only scalar values can form a key");
+    auto h = fingerprint_seed;
+    ((h = fingerprint(&values, 1, h)), ...);
+    return h;
+}
+
+// Persistent MUMPS instance holding the factorization of a single matrix.
+//
+// Unlike solver, which analyzes, factorizes and solves on each call, the
+// phases are exposed separately, so that a matrix that does not change
+// between time steps is factorized once and then used to solve with any
+// number of right-hand sides, one per call. Analysis is repeated only if the
+// sparsity pattern changes.
+//
+// The matrix is copied, so the problem it was given in need not outlive the
+// factorization. Each solve checks that the matrix is the factorized one -
+// either by comparing the fingerprint of the problem, or the key given to
+// factorize by callers that do not keep the problem.
+class factorization {
+private:
+    static constexpr int USE_COMM_WORLD = -987654;
+
+    DMUMPS_STRUC_C id{};
+    std::vector<MUMPS_INT> irn;
+    std::vector<MUMPS_INT> jcn;
+    std::vector<double> a;
+    std::uint64_t pattern_hash = 0;
+    std::uint64_t values_hash = 0;
+    std::uint64_t key_ = 0;
+    bool analyzed = false;
+    bool factorized_ = false;
+
+public:
+    factorization() {
+        id.job = -1;
+        id.par = 1;
+        id.sym = 0;
+        id.comm_fortran = USE_COMM_WORLD;
+        run("initialization");
+
+        // errors only
+        icntl(1) = 6;
+        icntl(2) = -1;
+        icntl(3) = -1;
+        icntl(4) = 1;
+    }
+
+    factorization(const factorization&) = delete;
+    factorization& operator=(const factorization&) = delete;
+    factorization(factorization&&) = delete;
+    factorization& operator=(factorization&&) = delete;
+
+    ~factorization() {
+        id.job = -2;
+        dmumps_c(&id);
+    }
+
+    void analyze(problem& p) {
+        set_matrix(p);
+        id.job = 1;
+        run("analysis");
+        pattern_hash = pattern_fingerprint(p);
+        analyzed = true;
+        factorized_ = false;
+    }
+
+    // Analysis is performed first if the sparsity pattern differs from the
+    // previously analyzed one.
+    void factorize(problem& p, std::uint64_t key = 0) {
+        if (!analyzed || pattern_fingerprint(p) != pattern_hash) {
+            analyze(p);
+        } else {
+            set_matrix(p);
+        }
+        id.job = 2;
+        run("factorization");
+        values_hash = values_fingerprint(p);
+        key_ = key;
+        factorized_ = true;
+    }
+
+    bool factorized() const { return factorized_; }
+
+    // Whether the matrix with given key is factorized
+    bool factorized(std::uint64_t key) const { return factorized_ && key_ == key; }
+
+    // Solves with the right-hand side rhs, overwriting it with the solution.
+    // The matrix is identified by the key passed to factorize.
+    void solve(std::uint64_t key, double* rhs) {
+        if (factorized_ && key_ != key) {
+            throw std::logic_error{"MUMPS: solve with a key of a different matrix"};
+        }
+        solve_factorized(rhs);
+    }
+
+    // Same, checking that the matrix of p is the one that has been factorized.
+    // This hashes all the entries of p, so callers solving repeatedly should
+    // rather use the key.
+    void solve(problem& p, double* rhs) {
+        if (factorized_ && values_fingerprint(p) != values_hash) {
+            throw std::logic_error{"MUMPS: matrix has changed since factorization"};
+        }
+        solve_factorized(rhs);
+    }
+
+    // Solves using the right-hand side of p
+    void solve(problem& p) { solve(p, p.rhs()); }
+
+    double flops_assembly() const { return id.rinfog[1]; }
+
+    double flops_elimination() const { return id.rinfog[2]; }
+
+private:
+    MUMPS_INT& icntl(int k) { return id.icntl[k - 1]; }
+
+    void set_matrix(problem& p) {
+        auto nnz = static_cast<std::size_t>(p.nonzero_entries());
+        irn.assign(p.irn(), p.irn() + nnz);
+        jcn.assign(p.jcn(), p.jcn() + nnz);
+        a.assign(p.a(), p.a() + nnz);
+
+        id.n = p.dofs();
+        id.nnz = p.nonzero_entries();
+        id.irn = irn.data();
+        id.jcn = jcn.data();
+        id.a = a.data();
+    }
+
+    void solve_factorized(double* rhs) {
+        if (!factorized_) {
+            throw std::logic_error{"MUMPS: solve called before factorization"};
+        }
+        id.rhs = rhs;
+        id.nrhs = 1;
+        id.lrhs = id.n;
+        id.job = 3;
+        run("solution");
+    }
+
+    void run(const char* phase) {
+        dmumps_c(&id);
+        if (id.infog[0] < 0) {
+            throw std::runtime_error{fmt::format("MUMPS {} failed: INFOG(1) = {}, INFOG(2) = {}",
+                                                 phase, id.infog[0], id.infog[1])};
+        }
+    }
+
+    static std::uint64_t pattern_fingerprint(problem& p) {
+        auto nnz = static_cast<std::size_t>(p.nonzero_entries());
+        auto h = fingerprint(p.irn(), nnz);
+        h = fingerprint(p.jcn(), nnz, h);
+        int n = p.dofs();
+        return fingerprint(&n, 1, h);
+    }
+
+    static std::uint64_t values_fingerprint(problem& p) {
+        auto nnz = static_cast<std::size_t>(p.nonzero_entries());
+        return fingerprint(p.a(), nnz, pattern_fingerprint(p));
+    }
+};
+
+}  // namespace ads::mumps
+
+#endif  // COMMON_MUMPS_FACTORIZATION_HPP
@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_OUTER_ITERATION_HPP
+#define COMMON_OUTER_ITERATION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace ads {
+
+struct outer_iteration_config {
+    int max_iters = 30;
+    double tolerance = 1e-7;
+    int depth = 0;  // Anderson mixing depth, 0 for the plain fixed-point iteration
+};
+
+// Fixed-point iteration x <- G(x) accelerated with Anderson mixing.
+//
+// The iterate may be split between several tensors (e.g. the solution and
+// the residual representative), which are passed in the same order to
+// record, before G is applied, and to accelerate, after it has been applied
+// in place. The next iterate is then the combination of the last depth + 1
+// values of G minimizing the linearized residual G(x) - x. Mixing is off by
+// default, so that the results do not change unless it is asked for.
+class outer_iteration {
+private:
+    outer_iteration_config config_;
+
+    std::vector<double> x_;
+    std::vector<double> x_prev_;
+    std::vector<double> f_prev_;
+    std::deque<std::vector<double>> dx_;
+    std::deque<std::vector<double>> df_;
+
+    std::vector<double> history_;
+
+public:
+    explicit outer_iteration(outer_iteration_config config = {})
+    : config_{config} { }
+
+    const outer_iteration_config& config() const { return config_; }
+
+    // Starts a new iteration, clearing the history
+    void start() {
+        x_prev_.clear();
+        f_prev_.clear();
+        dx_.clear();
+        df_.clear();
+        history_.clear();
+    }
+
+    int iterations() const { return static_cast<int>(history_.size()); }
+
+    // Norms of the corrections passed to finished, one per iteration
+    const std::vector<double>& history() const { return history_; }
+
+    template <typename... Parts>
+    void record(const Parts&... parts) {
+        x_.clear();
+        (append(x_, parts), ...);
+    }
+
+    // Records the norm of the last correction and checks the stopping criteria
+    bool finished(double norm) {
+        history_.push_back(norm);
+        return converged() || iterations() >= config_.max_iters;
+    }
+
+    bool converged() const { return !history_.empty() && history_.back() < config_.tolerance; }
+
+    template <typename... Parts>
+    void accelerate(Parts&... parts) {
+        if (config_.depth <= 0) {
+            return;
+        }
+        auto g = std::vector<double>{};
+        (append(g, parts), ...);
+
+        auto f = std::vector<double>(g.size());
+        for (std::size_t i = 0; i < f.size(); ++i) {
+            f[i] = g[i] - x_[i];
+        }
+
+        if (!f_prev_.empty()) {
+            dx_.push_back(difference(x_, x_prev_));
+            df_.push_back(difference(f, f_prev_));
+            if (static_cast<int>(df_.size()) > config_.depth) {
+                dx_.pop_front();
+                df_.pop_front();
+            }
+        }
+        x_prev_ = x_;
+        f_prev_ = f;
+
+        auto const gamma = mixing_coefficients(f);
+        for (std::size_t k = 0; k < gamma.size(); ++k) {
+            for (std::size_t i = 0; i < g.size(); ++i) {
+                g[i] -= gamma[k] * (dx_[k][i] + df_[k][i]);
+            }
+        }
+
+        auto it = cbegin(g);
+        (extract(it, parts), ...);
+    }
+
+    // Prints the number of iterations and the norms of all the corrections
+    void print_summary(std::ostream& os) const {
+        os << "  outer iterations: " << iterations();
+        if (!history_.empty()) {
+            os << ", |eta| = " << history_.back() << (converged() ? "" : " (not converged)");
+            os << ", history:";
+            for (double norm : history_) {
+                os << ' ' << norm;
+            }
+        }
+        os << std::endl;
+    }
+
+private:
+    template <typename Part>
+    static void append(std::vector<double>& v, const Part& part) {
+        v.insert(end(v), part.data(), part.data() + part.size());
+    }
+
+    template <typename Part>
+    static void extract(std::vector<double>::const_iterator& it, Part& part) {
+        auto const n = static_cast<std::ptrdiff_t>(part.size());
+        std::copy(it, it + n, part.data());
+        it += n;
+    }
+
+    static std::vector<double> difference(const std::vector<double>& a,
+                                          const std::vector<double>& b) {
+        auto d = std::vector<double>(a.size());
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            d[i] = a[i] - b[i];
+        }
+        return d;
+    }
+
+    static double dot(const std::vector<double>& a, const std::vector<double>& b) {
+        double sum = 0;
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    // Least squares solution of min |f - DF gamma| from the normal equations,
+    // regularized to cope with nearly dependent differences
+    std::vector<double> mixing_coefficients(const std::vector<double>& f) const {
+        auto const m = static_cast<int>(df_.size());
+        auto A = std::vector<double>(static_cast<std::size_t>(m) * m);
+        auto gamma = std::vector<double>(m);
+
+        double trace = 0;
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j <= i; ++j) {
+                A[i * m + j] = A[j * m + i] = dot(df_[i], df_[j]);
+            }
+            gamma[i] = dot(df_[i], f);
+            trace += A[i * m + i];
+        }
+        for (int i = 0; i < m; ++i) {
+            A[i * m + i] += 1e-12 * trace + std::numeric_limits<double>::min();
+        }
+
+        // Cholesky decomposition A = L L', L stored in the lower triangle
+        for (int j = 0; j < m; ++j) {
+            for (int k = 0; k < j; ++k) {
+                A[j * m + j] -= A[j * m + k] * A[j * m + k];
+            }
+            A[j * m + j] = std::sqrt(A[j * m + j]);
+            for (int i = j + 1; i < m; ++i) {
+                for (int k = 0; k < j; ++k) {
+                    A[i * m + j] -= A[i * m + k] * A[j * m + k];
+                }
+                A[i * m + j] /= A[j * m + j];
+            }
+        }
+        for (int i = 0; i < m; ++i) {
+            for (int k = 0; k < i; ++k) {
+                gamma[i] -= A[i * m + k] * gamma[k];
+            }
+            gamma[i] /= A[i * m + i];
+        }
+        for (int i = m - 1; i >= 0; --i) {
+            for (int k = i + 1; k < m; ++k) {
+                gamma[i] -= A[k * m + i] * gamma[k];
+            }
+            gamma[i] /= A[i * m + i];
+        }
+        return gamma;
+    }
+};
+
+}  // namespace ads
+
+#endif  // COMMON_OUTER_ITERATION_HPP
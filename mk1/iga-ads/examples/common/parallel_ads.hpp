@@ -0,0 +1,204 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_PARALLEL_ADS_HPP
+#define COMMON_PARALLEL_ADS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include <boost/range/counting_range.hpp>
+
+#include "batched_band_solver.hpp"
+#include "ads/executor/galois.hpp"
+#include "ads/lin/band_matrix.hpp"
+#include "ads/lin/band_solve.hpp"
+#include "ads/projection.hpp"
+#include "ads/simulation/dimension.hpp"
+
+namespace ads {
+
+// Factorization of the operator of a single direction. The batched solver is
+// used if LU without pivoting is stable for the matrix, otherwise - e.g. for
+// advection dominated operators - the matrix is factorized by LAPACK with
+// pivoting. The matrix passed to the constructor must not be factorized.
+class direction_solver {
+private:
+    lin::band_matrix M_;
+    lin::solver_ctx ctx_{M_};
+    batched_band_solver batched_;
+    bool pivoted_ = false;
+
+public:
+    direction_solver() = default;
+
+    explicit direction_solver(const lin::band_matrix& M) {
+        if (batched_band_solver::stable_without_pivoting(M)) {
+            batched_ = batched_band_solver{M};
+        } else {
+            M_ = M;
+            ctx_ = lin::solver_ctx{M_};
+            lin::factorize(M_, ctx_);
+            pivoted_ = true;
+        }
+    }
+
+    bool pivoted() const { return pivoted_; }
+
+    const lin::band_matrix& matrix() const { return M_; }
+
+    const lin::solver_ctx& context() const { return ctx_; }
+
+    const batched_band_solver& batched() const { return batched_; }
+};
+
+// Factorized banded operator of a single direction, either a LAPACK
+// factorization or a batched_band_solver. Dimensions and solvers convert
+// implicitly, so they can be passed directly to parallel_ads_solve.
+class band_direction {
+private:
+    const lin::band_matrix* M_ = nullptr;
+    const lin::solver_ctx* ctx_ = nullptr;
+    const batched_band_solver* batched_ = nullptr;
+
+public:
+    band_direction(const lin::band_matrix& M, const lin::solver_ctx& ctx)
+    : M_{&M}
+    , ctx_{&ctx} { }
+
+    // NOLINTNEXTLINE(google-explicit-constructor, hicpp-explicit-conversions)
+    band_direction(const batched_band_solver& solver)
+    : batched_{&solver} { }
+
+    // NOLINTNEXTLINE(google-explicit-constructor, hicpp-explicit-conversions)
+    band_direction(const direction_solver& solver)
+    : M_{solver.pivoted() ? &solver.matrix() : nullptr}
+    , ctx_{solver.pivoted() ? &solver.context() : nullptr}
+    , batched_{solver.pivoted() ? nullptr : &solver.batched()} { }
+
+    // NOLINTNEXTLINE(google-explicit-constructor, hicpp-explicit-conversions)
+    band_direction(const dimension& dim)
+    : band_direction{dim.M, dim.ctx} { }
+
+    // Solves count consecutive lines starting at data. Each call uses its own
+    // copy of the solver context, so that calls can run concurrently.
+    void solve(double* data, int count) const {
+        if (batched_) {
+            batched_->solve(data, count);
+            return;
+        }
+        auto ctx = *ctx_;
+        lin::solve_with_factorized(*M_, data, ctx, count);
+    }
+};
+
+// Solver for the mass matrix of a dimension, including the rows of dofs fixed
+// with fix_dof, which uses the batched solver. It needs to be created before
+// the matrix of the dimension is factorized, i.e. before prepare_matrices of
+// the simulation.
+inline direction_solver mass_solver(const dimension& dim) {
+    return direction_solver{dim.M};
+}
+
+// Transposes the m x n column-major matrix in into out. Tiles are processed
+// in parallel, each one small enough for both source and destination to stay
+// in cache.
+inline void parallel_transpose(const double* in, double* out, int m, int n,
+                               galois_executor& executor) {
+    constexpr int tile = 32;
+    int const tiles = (n + tile - 1) / tile;
+
+    executor.for_each(boost::counting_range(0, tiles), [&](int t) {
+        int const j0 = t * tile;
+        int const j1 = std::min(j0 + tile, n);
+        for (int i0 = 0; i0 < m; i0 += tile) {
+            int const i1 = std::min(i0 + tile, m);
+            for (int j = j0; j < j1; ++j) {
+                const double* src = in + static_cast<std::size_t>(j) * m;
+                for (int i = i0; i < i1; ++i) {
+                    out[j + static_cast<std::size_t>(i) * n] = src[i];
+                }
+            }
+        }
+    });
+}
+
+// Calls fun(lines, count) for chunks of lines of length n stored one after
+// another, in parallel. Chunks consist of whole batches of the batched
+// solvers, so that only the last one can have a tail.
+template <typename LineFun>
+void parallel_for_lines(double* data, int n, int lines, galois_executor& executor, LineFun&& fun) {
+    constexpr int width = basic_batched_band_solver<float>::width;
+    int const chunk = (std::max(1, 4096 / n) + width - 1) / width * width;
+    int const chunks = (lines + chunk - 1) / chunk;
+
+    executor.for_each(boost::counting_range(0, chunks), [&](int c) {
+        int const first = c * chunk;
+        int const count = std::min(chunk, lines - first);
+        fun(data + static_cast<std::size_t>(first) * n, count);
+    });
+}
+
+// Applies a one-dimensional operation along each direction of the tensor of
+// the given shape stored in data, calling op(dir, lines, count) on chunks of
+// lines of direction dir. Data is transposed cyclically between directions,
+// using buffer of the same size. The result is stored in data.
+template <std::size_t N, typename LineOp>
+void parallel_sweep(double* data, double* buffer, std::array<int, N> shape,
+                    galois_executor& executor, LineOp&& op) {
+    int total = 1;
+    for (int s : shape) {
+        total *= s;
+    }
+    double* const result = data;
+
+    for (std::size_t dir = 0; dir < N; ++dir) {
+        int const n = shape[0];
+        int const lines = total / n;
+        parallel_for_lines(data, n, lines, executor,
+                           [&](double* first, int count) { op(dir, first, count); });
+        parallel_transpose(data, buffer, n, lines, executor);
+
+        std::swap(data, buffer);
+        std::rotate(begin(shape), begin(shape) + 1, end(shape));
+    }
+
+    if (data != result) {
+        int const chunk = 4096;
+        int const chunks = (total + chunk - 1) / chunk;
+        executor.for_each(boost::counting_range(0, chunks), [&](int c) {
+            auto const first = static_cast<std::size_t>(c) * chunk;
+            auto const last = std::min(first + chunk, static_cast<std::size_t>(total));
+            std::copy(data + first, data + last, result + first);
+        });
+    }
+}
+
+template <std::size_t N, typename Tensor>
+std::array<int, N> tensor_shape(const Tensor& t) {
+    auto shape = std::array<int, N>{};
+    for (std::size_t i = 0; i < N; ++i) {
+        shape[i] = t.size(i);
+    }
+    return shape;
+}
+
+// Threaded counterpart of ads_solve. For each direction the transverse lines
+// are partitioned among threads of the executor, and the cyclic transposes
+// between directions use parallel_transpose. The solution is stored in rhs.
+template <typename Rhs, typename... Dims>
+void parallel_ads_solve(Rhs& rhs, Rhs& buffer, galois_executor& executor, const Dims&... dims) {
+    constexpr auto N = sizeof...(Dims);
+    auto const dirs = std::array<band_direction, N>{band_direction{dims}...};
+
+    auto const solve = [&](std::size_t dir, double* lines, int count) {
+        dirs[dir].solve(lines, count);
+    };
+    parallel_sweep(rhs.data(), buffer.data(), tensor_shape<N>(rhs), executor, solve);
+}
+
+}  // namespace ads
+
+#endif  // COMMON_PARALLEL_ADS_HPP
@@ -0,0 +1,224 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_POINT_EVAL_HPP
+#define COMMON_POINT_EVAL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "ads/bspline/bspline.hpp"
+#include "ads/bspline/eval.hpp"
+#include "ads/util/function_value.hpp"
+
+namespace ads {
+
+// Values and first derivatives of a 1D B-spline basis at a set of
+// coordinates. Coordinates are processed in sorted order, so that the knot
+// span can be found by walking forward from the previous one, and the basis
+// is evaluated only once for each distinct coordinate.
+class axis_samples {
+private:
+    int p = 0;
+    std::vector<int> first_dofs;
+    std::vector<double> vals;
+    std::vector<double> ders;
+    std::vector<int> index;
+
+public:
+    void compute(const bspline::basis& B, const std::vector<double>& coords) {
+        p = B.degree;
+        auto n = coords.size();
+
+        first_dofs.clear();
+        vals.clear();
+        ders.clear();
+        index.resize(n);
+
+        std::vector<std::size_t> order(n);
+        std::iota(begin(order), end(order), 0);
+        std::sort(begin(order), end(order),
+                  [&](std::size_t i, std::size_t j) { return coords[i] < coords[j]; });
+
+        bspline::eval_ders_ctx ctx{p, 1};
+        double** out = ctx.basis_vals();
+        int last_span = bspline::find_span(B.knot.back(), B);
+
+        int span = -1;
+        double prev = 0;
+        for (auto k : order) {
+            double x = coords[k];
+            if (span < 0 || x != prev) {
+                if (span < 0) {
+                    span = bspline::find_span(x, B);
+                } else {
+                    while (span < last_span && x >= B.knot[span + 1]) {
+                        ++span;
+                    }
+                }
+                bspline::eval_basis_with_derivatives(span, x, B, out, 1, ctx);
+                first_dofs.push_back(span - p);
+                vals.insert(end(vals), out[0], out[0] + p + 1);
+                ders.insert(end(ders), out[1], out[1] + p + 1);
+                prev = x;
+            }
+            index[k] = static_cast<int>(first_dofs.size()) - 1;
+        }
+    }
+
+    int degree() const { return p; }
+
+    // Number of distinct coordinates
+    std::size_t distinct() const { return first_dofs.size(); }
+
+    int first_dof(std::size_t point) const { return first_dofs[index[point]]; }
+
+    const double* values(std::size_t point) const { return &vals[index[point] * (p + 1)]; }
+
+    const double* derivatives(std::size_t point) const { return &ders[index[point] * (p + 1)]; }
+};
+
+// Evaluates B-spline functions given by coefficient tensors at a batch of
+// arbitrary points. Knot spans and basis values are computed once in
+// set_points and shared by all subsequent evaluations, and each evaluation
+// handles several coefficient tensors in a single pass over the points.
+template <std::size_t Dim>
+class batch_evaluator {
+    static_assert(Dim == 2 || Dim == 3, "Only 2D and 3D evaluation is supported");
+
+public:
+    using point_type = std::array<double, Dim>;
+    using value_type = std::conditional_t<Dim == 2, function_value_2d, function_value_3d>;
+
+private:
+    std::array<const bspline::basis*, Dim> bases;
+    std::array<axis_samples, Dim> axes;
+    std::size_t count = 0;
+
+public:
+    template <typename... Bases>
+    explicit batch_evaluator(const Bases&... bases)
+    : bases{&bases...} { }
+
+    void set_points(const std::vector<point_type>& points) {
+        count = points.size();
+        std::vector<double> coords(count);
+        for (std::size_t d = 0; d < Dim; ++d) {
+            for (std::size_t i = 0; i < count; ++i) {
+                coords[i] = points[i][d];
+            }
+            axes[d].compute(*bases[d], coords);
+        }
+    }
+
+    std::size_t size() const { return count; }
+
+    // Values of each of the functions at each point, result[i][k] being the
+    // value of k-th function at i-th point.
+    template <typename Tensor, typename... Tensors>
+    auto values(const Tensor& u, const Tensors&... us) const {
+        constexpr auto N = 1 + sizeof...(Tensors);
+        auto coeffs = std::array<const Tensor*, N>{&u, &us...};
+        auto result = std::vector<std::array<double, N>>(count);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            for_each_basis(i, false, [&](const auto& dof, const std::array<double, Dim + 1>& b) {
+                for (std::size_t k = 0; k < N; ++k) {
+                    result[i][k] += coefficient(*coeffs[k], dof) * b[0];
+                }
+            });
+        }
+        return result;
+    }
+
+    // Values and gradients of each of the functions at each point
+    template <typename Tensor, typename... Tensors>
+    auto values_and_gradients(const Tensor& u, const Tensors&... us) const {
+        constexpr auto N = 1 + sizeof...(Tensors);
+        auto coeffs = std::array<const Tensor*, N>{&u, &us...};
+        auto result = std::vector<std::array<value_type, N>>(count);
+
+        std::array<std::array<double, Dim + 1>, N> acc;
+        for (std::size_t i = 0; i < count; ++i) {
+            for (auto& a : acc) {
+                a.fill(0);
+            }
+            for_each_basis(i, true, [&](const auto& dof, const std::array<double, Dim + 1>& b) {
+                for (std::size_t k = 0; k < N; ++k) {
+                    double c = coefficient(*coeffs[k], dof);
+                    for (std::size_t j = 0; j <= Dim; ++j) {
+                        acc[k][j] += c * b[j];
+                    }
+                }
+            });
+            for (std::size_t k = 0; k < N; ++k) {
+                if constexpr (Dim == 2) {
+                    result[i][k] = value_type{acc[k][0], acc[k][1], acc[k][2]};
+                } else {
+                    result[i][k] = value_type{acc[k][0], acc[k][1], acc[k][2], acc[k][3]};
+                }
+            }
+        }
+        return result;
+    }
+
+private:
+    template <typename Tensor>
+    static double coefficient(const Tensor& u, const std::array<int, Dim>& dof) {
+        if constexpr (Dim == 2) {
+            return u(dof[0], dof[1]);
+        } else {
+            return u(dof[0], dof[1], dof[2]);
+        }
+    }
+
+    // Calls fun(dof, {value, d/dx, d/dy[, d/dz]}) for each basis function
+    // nonzero at i-th point
+    template <typename Fun>
+    void for_each_basis(std::size_t i, bool with_ders, Fun&& fun) const {
+        const auto& ax = axes[0];
+        const auto& ay = axes[1];
+        const double* vx = ax.values(i);
+        const double* vy = ay.values(i);
+        const double* dx = ax.derivatives(i);
+        const double* dy = ay.derivatives(i);
+        int x0 = ax.first_dof(i);
+        int y0 = ay.first_dof(i);
+
+        std::array<double, Dim + 1> b{};
+        for (int a = 0; a <= ax.degree(); ++a) {
+            for (int c = 0; c <= ay.degree(); ++c) {
+                double vxy = vx[a] * vy[c];
+                double dxy_x = with_ders ? dx[a] * vy[c] : 0;
+                double dxy_y = with_ders ? vx[a] * dy[c] : 0;
+
+                if constexpr (Dim == 2) {
+                    b = {vxy, dxy_x, dxy_y};
+                    fun(std::array<int, 2>{x0 + a, y0 + c}, b);
+                } else {
+                    const auto& az = axes[2];
+                    const double* vz = az.values(i);
+                    const double* dz = az.derivatives(i);
+                    int z0 = az.first_dof(i);
+
+                    for (int d = 0; d <= az.degree(); ++d) {
+                        if (with_ders) {
+                            b = {vxy * vz[d], dxy_x * vz[d], dxy_y * vz[d], vxy * dz[d]};
+                        } else {
+                            b[0] = vxy * vz[d];
+                        }
+                        fun(std::array<int, 3>{x0 + a, y0 + c, z0 + d}, b);
+                    }
+                }
+            }
+        }
+    }
+};
+
+}  // namespace ads
+
+#endif  // COMMON_POINT_EVAL_HPP
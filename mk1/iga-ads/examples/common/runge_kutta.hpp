@@ -0,0 +1,265 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef COMMON_RUNGE_KUTTA_HPP
+#define COMMON_RUNGE_KUTTA_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <boost/range/counting_range.hpp>
+
+namespace ads {
+
+// Explicit Runge-Kutta method given by its Butcher tableau. Row i of a holds
+// the i coefficients of stage i (a is strictly lower triangular). Methods with
+// an embedded lower order solution store its weights in b_hat.
+struct butcher_tableau {
+    std::string name;
+    int order;
+    std::vector<std::vector<double>> a;
+    std::vector<double> b;
+    std::vector<double> c;
+    std::vector<double> b_hat = {};
+
+    int stages() const { return static_cast<int>(b.size()); }
+
+    bool embedded() const { return !b_hat.empty(); }
+};
+
+inline butcher_tableau rk4_tableau() {
+    return {
+        "rk4",
+        4,
+        {{}, {0.5}, {0.0, 0.5}, {0.0, 0.0, 1.0}},
+        {1.0 / 6, 1.0 / 3, 1.0 / 3, 1.0 / 6},
+        {0.0, 0.5, 0.5, 1.0},
+    };
+}
+
+inline butcher_tableau ssp_rk3_tableau() {
+    return {
+        "ssp-rk3",
+        3,
+        {{}, {1.0}, {0.25, 0.25}},
+        {1.0 / 6, 1.0 / 6, 2.0 / 3},
+        {0.0, 1.0, 0.5},
+    };
+}
+
+inline butcher_tableau heun_euler_tableau() {
+    return {
+        "heun-euler", 2, {{}, {1.0}}, {0.5, 0.5}, {0.0, 1.0}, {1.0, 0.0},
+    };
+}
+
+inline butcher_tableau bogacki_shampine_tableau() {
+    return {
+        "bogacki-shampine",
+        3,
+        {{}, {0.5}, {0.0, 0.75}, {2.0 / 9, 1.0 / 3, 4.0 / 9}},
+        {2.0 / 9, 1.0 / 3, 4.0 / 9, 0.0},
+        {0.0, 0.5, 0.75, 1.0},
+        {7.0 / 24, 1.0 / 4, 1.0 / 3, 1.0 / 8},
+    };
+}
+
+inline butcher_tableau tableau_by_name(std::string_view name) {
+    for (auto&& t : {rk4_tableau(), ssp_rk3_tableau(), heun_euler_tableau(),
+                     bogacki_shampine_tableau()}) {
+        if (t.name == name) {
+            return t;
+        }
+    }
+    throw std::invalid_argument{"Unknown Runge-Kutta scheme: " + std::string{name}};
+}
+
+// Step size proposed by the standard controller for an embedded pair, given
+// the error estimate err of the last step measured in units of the tolerance.
+// A non-finite estimate (e.g. after an overflow in the step) shrinks the step
+// as much as a single rejection allows.
+inline double suggest_step(const butcher_tableau& tableau, double h, double err) {
+    constexpr double safety = 0.9;
+    constexpr double min_factor = 0.2;
+    constexpr double max_factor = 5.0;
+
+    if (!std::isfinite(err)) {
+        return min_factor * h;
+    }
+    if (err == 0) {
+        return max_factor * h;
+    }
+    double factor = safety * std::pow(err, -1.0 / tableau.order);
+    return h * std::clamp(factor, min_factor, max_factor);
+}
+
+// Explicit Runge-Kutta integrator for multi-field states. State needs to
+// provide fields() returning an array of pointers to its fields, all of the
+// same size. Stage derivatives are kept between steps, so no state is
+// allocated after construction.
+//
+// Stage values and the final linear combination are computed in a single
+// pass over all fields, split into blocks small enough to stay in cache.
+template <typename State>
+class explicit_rk {
+private:
+    static constexpr std::size_t block_size = 4096;
+
+    butcher_tableau tableau_;
+    std::vector<State> k_;
+    State stage_;
+
+    double atol_ = 1e-8;
+    double rtol_ = 1e-6;
+
+public:
+    explicit_rk(butcher_tableau tableau, const State& prototype)
+    : tableau_{std::move(tableau)}
+    , k_(tableau_.stages(), prototype)
+    , stage_{prototype} { }
+
+    const butcher_tableau& tableau() const { return tableau_; }
+
+    void tolerance(double atol, double rtol) {
+        atol_ = atol;
+        rtol_ = rtol;
+    }
+
+    // Advances y(t) to out = y(t + h), where rhs(s, dsdt, t) computes the time
+    // derivative of s. Returns the error estimate relative to the tolerance
+    // for embedded methods, 0 otherwise.
+    template <typename Rhs, typename Executor>
+    double step(const State& y, State& out, double t, double h, Rhs&& rhs, Executor& executor) {
+        int s = tableau_.stages();
+        std::vector<double> coeffs;
+
+        for (int i = 0; i < s; ++i) {
+            if (i == 0) {
+                rhs(y, k_[0], t);
+            } else {
+                coeffs.clear();
+                for (double a : tableau_.a[i]) {
+                    coeffs.push_back(h * a);
+                }
+                combine(y, stage_, coeffs, executor);
+                rhs(stage_, k_[i], t + tableau_.c[i] * h);
+            }
+        }
+
+        coeffs.clear();
+        for (double b : tableau_.b) {
+            coeffs.push_back(h * b);
+        }
+        if (!tableau_.embedded()) {
+            combine(y, out, coeffs, executor);
+            return 0;
+        }
+
+        std::vector<double> err_coeffs;
+        for (int j = 0; j < s; ++j) {
+            err_coeffs.push_back(h * (tableau_.b[j] - tableau_.b_hat[j]));
+        }
+        return combine_with_error(y, out, coeffs, err_coeffs, executor);
+    }
+
+private:
+    template <typename Fun, typename Executor>
+    void for_each_block(std::size_t n, Executor& executor, Fun&& fun) const {
+        auto blocks = static_cast<int>((n + block_size - 1) / block_size);
+        executor.for_each(boost::counting_range(0, blocks), [&](int block) {
+            std::size_t begin = block * block_size;
+            std::size_t end = std::min(begin + block_size, n);
+            fun(begin, end);
+        });
+    }
+
+    // out = y + sum_j coeffs[j] * k_j
+    template <typename Executor>
+    void combine(const State& y, State& out, const std::vector<double>& coeffs,
+                 Executor& executor) {
+        auto src = y.fields();
+        auto dst = out.fields();
+        std::size_t n = src[0]->size();
+
+        for_each_block(n, executor, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t f = 0; f < src.size(); ++f) {
+                const double* __restrict yf = src[f]->data();
+                double* __restrict of = dst[f]->data();
+
+                for (std::size_t i = begin; i < end; ++i) {
+                    of[i] = yf[i];
+                }
+                for (std::size_t j = 0; j < coeffs.size(); ++j) {
+                    if (coeffs[j] == 0) {
+                        continue;
+                    }
+                    const double* __restrict kf = k_[j].fields()[f]->data();
+                    double c = coeffs[j];
+                    for (std::size_t i = begin; i < end; ++i) {
+                        of[i] += c * kf[i];
+                    }
+                }
+            }
+        });
+    }
+
+    // Same as combine, additionally computing the maximum over all dofs of
+    // |sum_j err_coeffs[j] * k_j| / (atol + rtol * max(|y|, |out|)). The estimate
+    // is NaN if the step produced NaN values, which std::max would skip.
+    template <typename Executor>
+    double combine_with_error(const State& y, State& out, const std::vector<double>& coeffs,
+                              const std::vector<double>& err_coeffs, Executor& executor) {
+        auto src = y.fields();
+        auto dst = out.fields();
+        std::size_t n = src[0]->size();
+        double max_err = 0;
+        bool invalid = false;
+
+        for_each_block(n, executor, [&](std::size_t begin, std::size_t end) {
+            std::vector<double> err(end - begin);
+            double local_max = 0;
+            bool local_invalid = false;
+
+            for (std::size_t f = 0; f < src.size(); ++f) {
+                const double* __restrict yf = src[f]->data();
+                double* __restrict of = dst[f]->data();
+
+                for (std::size_t i = begin; i < end; ++i) {
+                    of[i] = yf[i];
+                    err[i - begin] = 0;
+                }
+                for (std::size_t j = 0; j < coeffs.size(); ++j) {
+                    const double* __restrict kf = k_[j].fields()[f]->data();
+                    double c = coeffs[j];
+                    double ce = err_coeffs[j];
+                    for (std::size_t i = begin; i < end; ++i) {
+                        of[i] += c * kf[i];
+                        err[i - begin] += ce * kf[i];
+                    }
+                }
+                for (std::size_t i = begin; i < end; ++i) {
+                    double scale = atol_ + rtol_ * std::max(std::abs(yf[i]), std::abs(of[i]));
+                    double e = std::abs(err[i - begin]) / scale;
+                    local_max = std::max(local_max, e);
+                    local_invalid = local_invalid || std::isnan(e) || std::isnan(of[i]);
+                }
+            }
+            executor.synchronized([&] {
+                max_err = std::max(max_err, local_max);
+                invalid = invalid || local_invalid;
+            });
+        });
+        return invalid ? std::numeric_limits<double>::quiet_NaN() : max_err;
+    }
+};
+
+}  // namespace ads
+
+#endif  // COMMON_RUNGE_KUTTA_HPP
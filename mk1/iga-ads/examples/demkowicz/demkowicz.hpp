@@ -4,6 +4,7 @@
 #ifndef DEMKOWICZ_DEMKOWICZ_HPP
 #define DEMKOWICZ_DEMKOWICZ_HPP
 
+#include "../common/banded_schur_operator.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/lin/dense_matrix.hpp"
 #include "ads/lin/dense_solve.hpp"
@@ -21,19 +22,20 @@ private:
     dimension Ux, Uy;
     dimension& Vx;
     dimension& Vy;
-    lin::dense_matrix Kx_x, Kx_y, Ky_x, Ky_y;
+    // Kx_x = Bx' Ax^-1 Bx and Ky_y = By' Ay^-1 By, applied and solved without forming them
+    banded_schur_operator Kx_x, Ky_y;
+    lin::band_matrix Kx_y, Ky_x;
 
-    lin::dense_matrix Kx_x_nf, Kx_y_nf, Ky_x_nf, Ky_y_nf;  // non-factorized copies
+    lin::band_matrix Kx_y_nf, Ky_x_nf;  // non-factorized copies
 
-    lin::solver_ctx Kxx_ctx, Kxy_ctx, Kyx_ctx, Kyy_ctx;
+    lin::solver_ctx Kxy_ctx, Kyx_ctx;
 
     lin::band_matrix Ax, Ay;
     lin::solver_ctx Ax_ctx, Ay_ctx;
     lin::band_matrix MUx, MUy;
 
     lin::band_matrix MUVx, MUVy;
-    lin::dense_matrix Bx, By;
-    lin::dense_matrix Tx, Ty;
+    row_band_matrix Bx, By;
 
     // bc
     lin::vector bc_y0, bc_y1, bc_x0, bc_x1;
@@ -64,18 +66,14 @@ public:
     , Uy{trial_y}
     , Vx{x}
     , Vy{y}
-    , Kx_x{Ux.dofs(), Ux.dofs()}
-    , Kx_y{Uy.dofs(), Uy.dofs()}
-    , Ky_x{Ux.dofs(), Ux.dofs()}
-    , Ky_y{Uy.dofs(), Uy.dofs()}
-    , Kx_x_nf{Ux.dofs(), Ux.dofs()}
-    , Kx_y_nf{Uy.dofs(), Uy.dofs()}
-    , Ky_x_nf{Ux.dofs(), Ux.dofs()}
-    , Ky_y_nf{Uy.dofs(), Uy.dofs()}
-    , Kxx_ctx{Kx_x}
+    , Kx_x{Vx, Ux}
+    , Ky_y{Vy, Uy}
+    , Kx_y{Uy.p, Uy.p, Uy.dofs()}
+    , Ky_x{Ux.p, Ux.p, Ux.dofs()}
+    , Kx_y_nf{Uy.p, Uy.p, Uy.dofs()}
+    , Ky_x_nf{Ux.p, Ux.p, Ux.dofs()}
     , Kxy_ctx{Kx_y}
     , Kyx_ctx{Ky_x}
-    , Kyy_ctx{Ky_y}
     , Ax{Vx.p, Vx.p, Vx.dofs()}
     , Ay{y.p, Vy.p, Vy.dofs()}
     , Ax_ctx{Ax}
@@ -84,10 +82,8 @@ public:
     , MUy{Uy.p, Uy.p, Uy.dofs(), Uy.dofs(), 0}
     , MUVx{Vx.p, Ux.p, Vx.dofs(), Ux.dofs()}
     , MUVy{Vy.p, Uy.p, Vy.dofs(), Uy.dofs()}
-    , Bx{Vx.dofs(), Ux.dofs()}
-    , By{Vy.dofs(), Uy.dofs()}
-    , Tx{Vx.dofs(), Ux.dofs()}
-    , Ty{Vy.dofs(), Uy.dofs()}
+    , Bx{Vx, Ux}
+    , By{Vy, Uy}
     , bc_y0{{Ux.dofs()}}
     , bc_y1{{Ux.dofs()}}
     , bc_x0{{Uy.dofs()}}
@@ -121,7 +117,7 @@ private:
         }
     }
 
-    void mass_matrix(lin::dense_matrix& M, const basis_data& bU, const basis_data& bV) {
+    void mass_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
                 for (int a = 0; a + bV.first_dof(e) <= bV.last_dof(e); ++a) {
@@ -138,7 +134,7 @@ private:
         }
     }
 
-    void diffusion_matrix(lin::dense_matrix& M, const basis_data& bU, const basis_data& bV,
+    void diffusion_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV,
                           double h, double diffusion) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
@@ -156,7 +152,7 @@ private:
         }
     }
 
-    void advection_matrix(lin::dense_matrix& M, const basis_data& bU, const basis_data& bV,
+    void advection_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV,
                           double h, double advection) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
@@ -174,7 +170,7 @@ private:
         }
     }
 
-    void fix_dof(int k, const dimension& dim, lin::dense_matrix& K) {
+    void fix_dof(int k, const dimension& dim, lin::band_matrix& K) {
         int last = dim.dofs() - 1;
         for (int i = clamp(k - dim.p, 0, last); i <= clamp(k + dim.p, 0, last); ++i) {
             K(k, i) = 0;
@@ -182,7 +178,7 @@ private:
         K(k, k) = 1;
     }
 
-    void matrix(lin::dense_matrix& B, const basis_data& bU, const basis_data& bV, double h,
+    void matrix(row_band_matrix& B, const basis_data& bU, const basis_data& bV, double h,
                 double diffusion, double advection) {
         mass_matrix(B, bU, bV);
         diffusion_matrix(B, bU, bV, h, diffusion);
@@ -198,10 +194,8 @@ private:
         Ay.zero();
         MUx.zero();
         MUy.zero();
-        Kx_x.zero();
         Kx_y.zero();
         Ky_x.zero();
-        Ky_y.zero();
 
         // mass_matrix(MUVx, Ux.basis, x.basis);
         // mass_matrix(MUVy, Uy.basis, y.basis);
@@ -214,56 +208,41 @@ private:
         gram_matrix_1d(MUx, Ux.basis);
         gram_matrix_1d(MUy, Uy.basis);
 
+        // Kx_x = Bx' Ax^-1 Bx
+        Kx_x.factorize(Bx, Ax, {0, Ux.dofs() - 1});
+
+        // Ky_y = By' Ay^-1 By
+        Ky_y.factorize(By, Ay, {0, Uy.dofs() - 1});
+
         lin::factorize(Ax, Ax_ctx);
         lin::factorize(Ay, Ay_ctx);
 
-        // TODO: fill
-        // Kx_x = Bx' Ax^-1 Bx
-        // to_dense(Bx, Tx);
-        Tx = Bx;
-        solve_with_factorized(Ax, Tx, Ax_ctx);
-        multiply(Bx, Tx, Kx_x, "T");
-
         // Kx_y = MUVy' MVy^-1 MUVy
         // to_dense(MUy, Ty);
         // solve_with_factorized(Uy.M, Ty, Uy.ctx);
         // multiply(MUy, Ty, Kx_y, "T");
-        to_dense(MUy, Kx_y);
+        Kx_y = MUy;
 
         // Ky_x = MUVx' MVx^-1 MUVx
         // to_dense(MUx, Tx);
         // solve_with_factorized(Ux.M, Tx, Ux.ctx);
         // multiply(MUx, Tx, Ky_x, "T");
-        to_dense(MUx, Ky_x);
-
-        // Ky_y = By' Ay^-1 By
-        // to_dense(By, Ty);
-        Ty = By;
-        solve_with_factorized(Ay, Ty, Ay_ctx);
-        multiply(By, Ty, Ky_y, "T");
+        Ky_x = MUx;
 
         // lin::factorize(MUx, MUx_ctx);
         // lin::factorize(MUy, MUy_ctx);
 
         fix_dof(0, Uy, Kx_y);
-        fix_dof(0, Uy, Ky_y);
         fix_dof(Uy.dofs() - 1, Uy, Kx_y);
-        fix_dof(Uy.dofs() - 1, Uy, Ky_y);
 
         fix_dof(0, Ux, Ky_x);
-        fix_dof(0, Ux, Kx_x);
         fix_dof(Ux.dofs() - 1, Ux, Ky_x);
-        fix_dof(Ux.dofs() - 1, Ux, Kx_x);
 
-        Kx_x_nf = Kx_x;
         Kx_y_nf = Kx_y;
         Ky_x_nf = Ky_x;
-        Ky_y_nf = Ky_y;
 
-        lin::factorize(Kx_x, Kxx_ctx);
         lin::factorize(Kx_y, Kxy_ctx);
         lin::factorize(Ky_x, Kyx_ctx);
-        lin::factorize(Ky_y, Kyy_ctx);
 
         // BC
         lin::band_matrix MUx_loc{Ux.p, Ux.p, Ux.dofs()};
@@ -311,37 +290,29 @@ private:
         swap(u, u_prev);
     }
 
-    void apply_bc(vector_type& u, const lin::dense_matrix& K_x, const lin::dense_matrix& K_y) {
+    template <typename KX, typename KY>
+    void apply_bc(vector_type& u, const KX& K_x, const KY& K_y) {
+        lin::vector row_x{{Ux.dofs()}};
+        lin::vector row_y{{Uy.dofs()}};
+
+        apply(K_x, bc_y0, row_x);
         for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += bc_y0(j) * K_x(i, j);
-            }
-            u(i, 0) = val;
+            u(i, 0) = row_x(i);
         }
 
+        apply(K_x, bc_y1, row_x);
         for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += bc_y1(j) * K_x(i, j);
-            }
-            u(i, Uy.dofs() - 1) = val;
+            u(i, Uy.dofs() - 1) = row_x(i);
         }
 
+        apply(K_y, bc_x0, row_y);
         for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += bc_x0(j) * K_y(i, j);
-            }
-            u(0, i) = val;
+            u(0, i) = row_y(i);
         }
 
+        apply(K_y, bc_x1, row_y);
         for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += bc_x1(j) * K_y(i, j);
-            }
-            u(Ux.dofs() - 1, i) = val;
+            u(Ux.dofs() - 1, i) = row_y(i);
         }
         u(0, 0) = 0;
         u(Ux.dofs() - 1, 0) = 0;
@@ -373,10 +344,10 @@ private:
         multiply(MUy, rhsx1_t, u_t, Ux.dofs(), "T");
         lin::cyclic_transpose(u_t, u);
 
-        apply_bc(u, Kx_x_nf, Kx_y_nf);
+        apply_bc(u, Kx_x, Kx_y_nf);
 
-        // ads_solve(u, u_buffer, dim_data{Kx_x, Kxx_ctx}, dim_data{Kx_y, Kxy_ctx});
-        lin::solve_with_factorized(Kx_x, u, Kxx_ctx);
+        // ads_solve(u, u_buffer, Kx_x, dim_data{Kx_y, Kxy_ctx});
+        Kx_x(u);
         auto F = lin::cyclic_transpose(u, u_buffer.data());
         lin::solve_with_factorized(Kx_y, F, Kxy_ctx);
         lin::cyclic_transpose(F, u);
@@ -397,12 +368,12 @@ private:
         multiply(By, rhsx2_t, u_t, Ux.dofs(), "T");
         lin::cyclic_transpose(u_t, u);
 
-        apply_bc(u, Ky_x_nf, Ky_y_nf);
+        apply_bc(u, Ky_x_nf, Ky_y);
 
-        // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, dim_data{Ky_y, Kyy_ctx});
+        // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, Ky_y);
         lin::solve_with_factorized(Ky_x, u, Kyx_ctx);
         auto F2 = lin::cyclic_transpose(u, u_buffer.data());
-        lin::solve_with_factorized(Ky_y, F2, Kyy_ctx);
+        Ky_y(F2);
         lin::cyclic_transpose(F2, u);
 
         // Substep 3
@@ -421,10 +392,10 @@ private:
         multiply(MUy, rhsx1_t, u_t, Ux.dofs(), "T");
         lin::cyclic_transpose(u_t, u);
 
-        apply_bc(u, Kx_x_nf, Kx_y_nf);
+        apply_bc(u, Kx_x, Kx_y_nf);
 
-        // ads_solve(u, u_buffer, dim_data{Kx_x, Kxx_ctx}, dim_data{Kx_y, Kxy_ctx});
-        lin::solve_with_factorized(Kx_x, u, Kxx_ctx);
+        // ads_solve(u, u_buffer, Kx_x, dim_data{Kx_y, Kxy_ctx});
+        Kx_x(u);
         auto F3 = lin::cyclic_transpose(u, u_buffer.data());
         lin::solve_with_factorized(Kx_y, F3, Kxy_ctx);
         lin::cyclic_transpose(F, u);
@@ -6,6 +6,7 @@
 
 #include <cmath>
 
+#include "../common/parallel_ads.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
@@ -38,6 +39,11 @@ class implicit_elasticity : public ads::simulation_3d {
     ads::lin::band_matrix Dx, Dy, Dz;
     ads::lin::band_matrix Kx, Ky, Kz;
 
+    // Each matrix is factorized separately, with its own pivots
+    ads::direction_solver Mx_solver, My_solver, Mz_solver;
+    ads::direction_solver Dx_solver, Dy_solver, Dz_solver;
+    ads::direction_solver Kx_solver, Ky_solver, Kz_solver;
+
     static constexpr double lambda = 1;
     static constexpr double mi = 1;
 
@@ -100,13 +106,17 @@ private:
     }
 
     void before() override {
+        Mx_solver = ads::mass_solver(x);
+        My_solver = ads::mass_solver(y);
+        Mz_solver = ads::mass_solver(z);
         prepare_matrices();
-        ads::lin::factorize(Kx, x.ctx);
-        ads::lin::factorize(Ky, y.ctx);
-        ads::lin::factorize(Kz, z.ctx);
-        ads::lin::factorize(Dx, x.ctx);
-        ads::lin::factorize(Dy, y.ctx);
-        ads::lin::factorize(Dz, z.ctx);
+
+        Kx_solver = ads::direction_solver{Kx};
+        Ky_solver = ads::direction_solver{Ky};
+        Kz_solver = ads::direction_solver{Kz};
+        Dx_solver = ads::direction_solver{Dx};
+        Dy_solver = ads::direction_solver{Dy};
+        Dz_solver = ads::direction_solver{Dz};
     }
 
     void compute_rhs(double t) {
@@ -470,13 +480,13 @@ private:
             executor.synchronized([&] { apply_local_contribution(local, e); });
         });
 
-        ads_solve(now.ux, buffer, x.data(), y.data(), z.data());
-        ads_solve(now.uy, buffer, x.data(), y.data(), z.data());
-        ads_solve(now.uz, buffer, x.data(), y.data(), z.data());
+        ads::parallel_ads_solve(now.ux, buffer, executor, Mx_solver, My_solver, Mz_solver);
+        ads::parallel_ads_solve(now.uy, buffer, executor, Mx_solver, My_solver, Mz_solver);
+        ads::parallel_ads_solve(now.uz, buffer, executor, Mx_solver, My_solver, Mz_solver);
 
-        ads_solve(now.vx, buffer, ads::dim_data{Dx, x.ctx}, y.data(), z.data());
-        ads_solve(now.vy, buffer, ads::dim_data{Kx, x.ctx}, y.data(), z.data());
-        ads_solve(now.vz, buffer, ads::dim_data{Kx, x.ctx}, y.data(), z.data());
+        ads::parallel_ads_solve(now.vx, buffer, executor, Dx_solver, My_solver, Mz_solver);
+        ads::parallel_ads_solve(now.vy, buffer, executor, Kx_solver, My_solver, Mz_solver);
+        ads::parallel_ads_solve(now.vz, buffer, executor, Kx_solver, My_solver, Mz_solver);
 
         swap(now, prev);
 
@@ -486,13 +496,13 @@ private:
             executor.synchronized([&] { apply_local_contribution(local, e); });
         });
 
-        ads_solve(now.ux, buffer, x.data(), y.data(), z.data());
-        ads_solve(now.uy, buffer, x.data(), y.data(), z.data());
-        ads_solve(now.uz, buffer, x.data(), y.data(), z.data());
+        ads::parallel_ads_solve(now.ux, buffer, executor, Mx_solver, My_solver, Mz_solver);
+        ads::parallel_ads_solve(now.uy, buffer, executor, Mx_solver, My_solver, Mz_solver);
+        ads::parallel_ads_solve(now.uz, buffer, executor, Mx_solver, My_solver, Mz_solver);
 
-        ads_solve(now.vx, buffer, x.data(), ads::dim_data{Ky, y.ctx}, z.data());
-        ads_solve(now.vy, buffer, x.data(), ads::dim_data{Dy, y.ctx}, z.data());
-        ads_solve(now.vz, buffer, x.data(), ads::dim_data{Ky, y.ctx}, z.data());
+        ads::parallel_ads_solve(now.vx, buffer, executor, Mx_solver, Ky_solver, Mz_solver);
+        ads::parallel_ads_solve(now.vy, buffer, executor, Mx_solver, Dy_solver, Mz_solver);
+        ads::parallel_ads_solve(now.vz, buffer, executor, Mx_solver, Ky_solver, Mz_solver);
 
         swap(now, prev);
 
@@ -502,13 +512,13 @@ private:
             executor.synchronized([&] { apply_local_contribution(local, e); });
         });
 
-        ads_solve(now.ux, buffer, x.data(), y.data(), z.data());
-        ads_solve(now.uy, buffer, x.data(), y.data(), z.data());
-        ads_solve(now.uz, buffer, x.data(), y.data(), z.data());
+        ads::parallel_ads_solve(now.ux, buffer, executor, Mx_solver, My_solver, Mz_solver);
+        ads::parallel_ads_solve(now.uy, buffer, executor, Mx_solver, My_solver, Mz_solver);
+        ads::parallel_ads_solve(now.uz, buffer, executor, Mx_solver, My_solver, Mz_solver);
 
-        ads_solve(now.vx, buffer, x.data(), y.data(), ads::dim_data{Kz, z.ctx});
-        ads_solve(now.vy, buffer, x.data(), y.data(), ads::dim_data{Kz, z.ctx});
-        ads_solve(now.vz, buffer, x.data(), y.data(), ads::dim_data{Dz, z.ctx});
+        ads::parallel_ads_solve(now.vx, buffer, executor, Mx_solver, My_solver, Kz_solver);
+        ads::parallel_ads_solve(now.vy, buffer, executor, Mx_solver, My_solver, Kz_solver);
+        ads::parallel_ads_solve(now.vz, buffer, executor, Mx_solver, My_solver, Dz_solver);
     }
 
     void after_step(int iter, double t) override {
@@ -5,7 +5,9 @@
 #define ERIKKSON_ERIKKSON_BASE_HPP
 
 #include <fstream>
+#include <vector>
 
+#include "../common/point_eval.hpp"
 #include "ads/bspline/eval.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/simulation.hpp"
@@ -42,48 +44,45 @@ protected:
 
     void plot_horizontal(const char* filename, double y0, const vector_type& u, const dimension& Ux,
                          const dimension& Uy) const {
-        std::ofstream out{filename};
-        auto ctx_x = bspline::eval_ctx{Ux.B.degree};
-        auto ctx_y = bspline::eval_ctx{Uy.B.degree};
-
-        auto print = [&](double xx) {
-            auto val = bspline::eval(xx, y0, u, Ux.B, Uy.B, ctx_x, ctx_y);
-            out << std::setprecision(16) << xx << " " << val << std::endl;
-        };
-
-        print(Ux.a);
-        auto N = Ux.basis.quad_order;
-        for (auto e : Ux.element_indices()) {
-            std::vector<double> qs(Ux.basis.x[e], Ux.basis.x[e] + N);
-            std::sort(begin(qs), end(qs));
-            for (auto xx : qs) {
-                print(xx);
-            }
+        auto points = std::vector<point_type>{};
+        for (auto xx : plot_coordinates(Ux)) {
+            points.push_back({xx, y0});
         }
-        print(Ux.b);
+        plot_points(filename, 0, points, u, Ux, Uy);
     }
 
     void plot_vertical(const char* filename, double x0, const vector_type& u, const dimension& Ux,
                        const dimension& Uy) const {
-        std::ofstream out{filename};
-        auto ctx_x = bspline::eval_ctx{Ux.B.degree};
-        auto ctx_y = bspline::eval_ctx{Uy.B.degree};
-
-        auto print = [&](double yy) {
-            auto val = bspline::eval(x0, yy, u, Ux.B, Uy.B, ctx_x, ctx_y);
-            out << std::setprecision(16) << yy << " " << val << std::endl;
-        };
-
-        print(Uy.a);
-        auto N = Uy.basis.quad_order;
-        for (auto e : Uy.element_indices()) {
-            std::vector<double> qs(Uy.basis.x[e], Uy.basis.x[e] + N);
+        auto points = std::vector<point_type>{};
+        for (auto yy : plot_coordinates(Uy)) {
+            points.push_back({x0, yy});
+        }
+        plot_points(filename, 1, points, u, Ux, Uy);
+    }
+
+    // Endpoints of the interval and all the quadrature points, in order
+    std::vector<double> plot_coordinates(const dimension& U) const {
+        auto coords = std::vector<double>{U.a};
+        auto N = U.basis.quad_order;
+        for (auto e : U.element_indices()) {
+            std::vector<double> qs(U.basis.x[e], U.basis.x[e] + N);
             std::sort(begin(qs), end(qs));
-            for (auto yy : qs) {
-                print(yy);
-            }
+            coords.insert(end(coords), begin(qs), end(qs));
+        }
+        coords.push_back(U.b);
+        return coords;
+    }
+
+    void plot_points(const char* filename, int axis, const std::vector<point_type>& points,
+                     const vector_type& u, const dimension& Ux, const dimension& Uy) const {
+        auto eval = batch_evaluator<2>{Ux.B, Uy.B};
+        eval.set_points(points);
+        auto vals = eval.values(u);
+
+        std::ofstream out{filename};
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            out << std::setprecision(16) << points[i][axis] << " " << vals[i][0] << std::endl;
         }
-        print(Uy.b);
     }
 
     void plot_middle(const char* filename, const vector_type& u, const dimension& Ux,
@@ -4,6 +4,9 @@
 #ifndef ERIKKSON_ERIKKSON_CG_HPP
 #define ERIKKSON_ERIKKSON_CG_HPP
 
+#include "../common/outer_iteration.hpp"
+#include "../common/coupled_assembly.hpp"
+#include "../common/mixed_form_operator.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/lin/dense_matrix.hpp"
 #include "ads/lin/dense_solve.hpp"
@@ -74,13 +77,20 @@ private:
     point_type beta{{1, 1}};
     // point_type beta{{ 1, 0 }};
 
+    // Matrix-free B, scalar product of the test space and the load vector
+    mixed_form_operator B_form;
+    mixed_form_operator A_form;
+    vector_type load;
+
     mumps::solver solver;
+    outer_iteration outer;
 
     output_manager<2> output;
 
 public:
     erikkson_CG(const dimension& trial_x, const dimension& trial_y,  //
-                const dimension& test_x, const dimension& test_y, const timesteps_config& steps)
+                const dimension& test_x, const dimension& test_y, const timesteps_config& steps,
+                outer_iteration_config outer_config = {})
     : Base{test_x, test_y, steps}
     , Ux{trial_x}
     , Uy{trial_y}
@@ -112,6 +122,10 @@ public:
     , u_buffer{{Ux.dofs(), Uy.dofs()}}
     , full_rhs(Vx.dofs() * Vy.dofs() + Ux.dofs() * Uy.dofs())
     , h{element_diam(Ux, Uy)}
+    , B_form{Ux, Uy, Vx, Vy, executor, [this](point_type x) { return form_coeffs(x); }}
+    , A_form{Vx, Vy, Vx, Vy, executor, [this](point_type) { return scalar_product_coeffs(); }}
+    , load{{Vx.dofs(), Vy.dofs()}}
+    , outer{outer_config}
     , output{Ux.B, Uy.B, 500} { }
 
 private:
@@ -147,26 +161,26 @@ private:
         }
 
         // B, B^T
-        for (auto i : dofs(Vx, Vy)) {
-            for (auto j : dofs(Ux, Uy)) {
-                double val = 0;
-                // val += kron(M.MUVx, M.MUVy, i, j);
-                val += /*steps.dt */ (c_diff[0] * kron(M.KUVx, M.MUVy, i, j)
-                                      + beta[0] * kron(M.AUVx, M.MUVy, i, j));
-                val += /*steps.dt */ (c_diff[1] * kron(M.MUVx, M.KUVy, i, j)
-                                      + beta[1] * kron(M.MUVx, M.AUVy, i, j));
-
-                if (val != 0) {
-                    if (!is_boundary(i, Vx, Vy) && !is_boundary(j, Ux, Uy)) {
-                        int ii = linear_index(i, Vx, Vy) + 1;
-                        int jj = linear_index(j, Ux, Uy) + 1;
-
-                        problem.add(ii, N + jj, -val);
-                        problem.add(N + jj, ii, val);
-                    }
-                }
-            }
-        }
+        auto value = [&](index_type i, index_type j) {
+            if (is_boundary(i, Vx, Vy) || is_boundary(j, Ux, Uy))
+                return 0.0;
+
+            double val = 0;
+            // val += kron(M.MUVx, M.MUVy, i, j);
+            val += /*steps.dt */ (c_diff[0] * kron(M.KUVx, M.MUVy, i, j)
+                                  + beta[0] * kron(M.AUVx, M.MUVy, i, j));
+            val += /*steps.dt */ (c_diff[1] * kron(M.MUVx, M.KUVy, i, j)
+                                  + beta[1] * kron(M.MUVx, M.AUVy, i, j));
+            return val;
+        };
+        auto emit = [&](index_type i, index_type j, double val) {
+            int ii = linear_index(i, Vx, Vy) + 1;
+            int jj = linear_index(j, Ux, Uy) + 1;
+
+            problem.add(ii, N + jj, -val);
+            problem.add(N + jj, ii, val);
+        };
+        assemble_coupled_block(Vx, Vy, Ux, Uy, executor, value, emit);
 
         // Dirichlet BC - upper left
         for_boundary_dofs(Vx, Vy, [&](index_type dof) {
@@ -181,6 +195,13 @@ private:
         });
     }
 
+    form_coefficients form_coeffs(point_type x) const {
+        auto diff = diffusion(x[0], x[1]);
+        return {diff, diff, beta[0], beta[1], 0};
+    }
+
+    form_coefficients scalar_product_coeffs() const { return {h * h, h * h, 0, 0, 1}; }
+
     double diffusion(double /*x*/, double /*y*/) const {
         return epsilon;
         // const double eta = epsilon;
@@ -311,6 +332,8 @@ private:
         Ux.factorize_matrix();
         Uy.factorize_matrix();
 
+        B_form.load([this](point_type x) { return erikkson2_forcing(x[0], x[1], epsilon); }, load);
+
         // auto init = [this](double x, double y) { return init_state(x, y); };
         // compute_projection(u, Ux.basis, Uy.basis, init);
         // ads_solve(u, u_buffer, Ux.data(), Uy.data());
@@ -355,7 +378,7 @@ private:
         std::fill(begin(full_rhs), end(full_rhs), 0);
 
         // compute_rhs_nonstationary(Vx, Vy, r_rhs, u_rhs, t);
-        compute_rhs(Vx, Vy, r_rhs, u_rhs);
+        compute_rhs(r_rhs, u_rhs);
 
         zero_bc(r_rhs, Vx, Vy);
         zero_bc(u_rhs, Ux, Uy);
@@ -383,14 +406,18 @@ private:
         zero(u);
 
         std::cout << "Step " << (iter + 1) << std::endl;
-        constexpr auto max_iters = 30;
-        for (int i = 1;; ++i) {
+        outer.start();
+        for (;;) {
+            outer.record(r.data, u);
             auto norm = substep(true, true, t);
-            std::cout << "  substep " << i << ": |eta| = " << norm << std::endl;
-            if (norm < 1e-7 || i >= max_iters) {
+            std::cout << "  substep " << outer.iterations() + 1 << ": |eta| = " << norm
+                      << std::endl;
+            if (outer.finished(norm)) {
                 break;
             }
+            outer.accelerate(r.data, u);
         }
+        outer.print_summary(std::cout);
     }
 
     void after_step(int iter, double t) override {
@@ -408,57 +435,15 @@ private:
         print_solution("solution.data", u, Ux, Uy);
     }
 
-    void compute_rhs(const dimension& Vx, const dimension& Vy, vector_view& r_rhs,
-                     vector_view& u_rhs) {
-        executor.for_each(elements(Vx, Vy), [&](index_type e) {
-            auto R = vector_type{{Vx.basis.dofs_per_element(), Vy.basis.dofs_per_element()}};
-            auto U = vector_type{{Ux.basis.dofs_per_element(), Uy.basis.dofs_per_element()}};
-
-            double J = jacobian(e);
-            for (auto q : quad_points(Vx, Vy)) {
-                double W = weight(q);
-                double WJ = W * J;
-                auto x = point(e, q);
-                value_type uu = eval(u, e, q, Ux, Uy);
-                value_type rr = eval(r.data, e, q, *r.Vx, *r.Vy);
-                auto diff = diffusion(x[0], x[1]);
-
-                for (auto a : dofs_on_element(e, Vx, Vy)) {
-                    auto aa = dof_global_to_local(e, a, Vx, Vy);
-                    value_type v = eval_basis(e, q, a, Vx, Vy);
-
-                    // double F = 1;
-                    // double F = 0;
-                    double F = erikkson2_forcing(x[0], x[1], epsilon);
-                    double lv = F * v.val;
-
-                    double val = -lv;
-
-                    // Bu
-                    val += diff * uu.dx * v.dx + beta[0] * uu.dx * v.val;
-                    val += diff * uu.dy * v.dy + beta[1] * uu.dy * v.val;
-                    // -Aw
-                    val -= (rr.val * v.val + h * h * (rr.dx * v.dx + rr.dy * v.dy));
-
-                    R(aa[0], aa[1]) += val * WJ;
-                }
-                for (auto a : dofs_on_element(e, Ux, Uy)) {
-                    auto aa = dof_global_to_local(e, a, Ux, Uy);
-                    value_type w = eval_basis(e, q, a, Ux, Uy);
-                    double val = 0;
-
-                    // -B'w
-                    val -= (diff * w.dx * rr.dx + beta[0] * w.dx * rr.val);
-                    val -= (diff * w.dy * rr.dy + beta[1] * w.dy * rr.val);
-
-                    U(aa[0], aa[1]) += val * WJ;
-                }
-            }
-            executor.synchronized([&]() {
-                update_global_rhs(r_rhs, R, e, Vx, Vy);
-                update_global_rhs(u_rhs, U, e, Ux, Uy);
-            });
-        });
+    void compute_rhs(vector_view& r_rhs, vector_view& u_rhs) {
+        // -F
+        for (auto i : dofs(Vx, Vy)) {
+            r_rhs(i[0], i[1]) -= load(i[0], i[1]);
+        }
+        // Bu, -B'w
+        B_form.apply(u, r.data, r_rhs, u_rhs, 1, -1);
+        // -Aw
+        A_form.apply(r.data, r_rhs, -1);
     }
 
     void compute_rhs_nonstationary(const dimension& Vx, const dimension& Vy, vector_view& r_rhs,
@@ -6,6 +6,10 @@
 
 #include <galois/Timer.h>
 
+#include "../common/boundary_trace.hpp"
+#include "../common/coupled_assembly.hpp"
+#include "../common/mixed_form_operator.hpp"
+#include "../common/outer_iteration.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/lin/dense_matrix.hpp"
 #include "ads/lin/dense_solve.hpp"
@@ -79,7 +83,22 @@ private:
     // point_type beta{{ 1, 1 }};
     // point_type beta{{ 1, 0 }};
 
+    // Tangential mass matrices of the Nitsche boundary terms, the second one
+    // weighted by beta * n
+    struct nitsche_side {
+        boundary_trace trace;
+        lin::dense_matrix M;
+        lin::dense_matrix Mb;
+    };
+
+    std::vector<nitsche_side> nitsche;
+
+    // Matrix-free B and scalar product of the test space
+    mixed_form_operator B_form;
+    mixed_form_operator A_form;
+
     mumps::solver solver;
+    outer_iteration outer;
 
     output_manager<2> output;
 
@@ -88,7 +107,8 @@ private:
 
 public:
     erikkson_CG_weak(const dimension& trial_x, const dimension& trial_y, const dimension& test_x,
-                     const dimension& test_y, const timesteps_config& steps)
+                     const dimension& test_y, const timesteps_config& steps,
+                     outer_iteration_config outer_config = {})
     : Base{test_x, test_y, steps}
     , Ux{trial_x}
     , Uy{trial_y}
@@ -120,6 +140,9 @@ public:
     , u_buffer{{Ux.dofs(), Uy.dofs()}}
     , full_rhs(Vx.dofs() * Vy.dofs() + Ux.dofs() * Uy.dofs())
     , h{element_diam(Ux, Uy)}
+    , B_form{Ux, Uy, Vx, Vy, executor, [this](point_type x) { return form_coeffs(x); }}
+    , A_form{Vx, Vy, Vx, Vy, executor, [this](point_type) { return scalar_product_coeffs(); }}
+    , outer{outer_config}
     , output{Ux.B, Uy.B, 500} {
         int p = Vx.basis.degree;
         gamma = 3 * epsilon * p * p / h;
@@ -162,6 +185,14 @@ private:
         return {-r * x[1], r * x[0]};
     }
 
+    form_coefficients form_coeffs(point_type x) const {
+        auto diff = diffusion(x);
+        auto v = beta(x);
+        return {diff, diff, v[0], v[1], 0};
+    }
+
+    form_coefficients scalar_product_coeffs() const { return {h * h, h * h, 0, 0, 1}; }
+
     value_type eval_basis_at(point_type p, index_type e, index_type dof, const dimension& x,
                              const dimension& y) const {
         int spanx = bspline::find_span(p[0], x.B);
@@ -203,61 +234,6 @@ private:
         return e >= xrange.first && e <= xrange.second;
     }
 
-    template <typename Form>
-    double integrate_boundary(boundary side, index_type i, index_type j, const dimension& Ux,
-                              const dimension& Uy, const dimension& Vx, const dimension& Vy,
-                              Form&& form) const {
-        double val = 0;
-        bool horizontal = side == boundary::top || side == boundary::bottom;
-
-        if (horizontal) {
-            int ey = side == boundary::bottom ? 0 : Uy.elements - 1;
-            if (!supported_in_1d(j[1], ey, Vy) || !supported_in_1d(i[1], ey, Uy))
-                return 0;
-
-            auto y0 = side == boundary::bottom ? Uy.a : Uy.b;
-
-            for (auto e : Ux.basis.element_range(i[0])) {
-                if (!supported_in_1d(j[0], e, Vx))
-                    continue;
-
-                double J = Ux.basis.J[e];
-
-                for (int q = 0; q < Ux.basis.quad_order; ++q) {
-                    double w = Ux.basis.w[q];
-                    point_type x{Ux.basis.x[e][q], y0};
-                    value_type ww = eval_basis_at(x, {e, ey}, i, Ux, Uy);
-                    value_type uu = eval_basis_at(x, {e, ey}, j, Vx, Vy);
-                    double fuw = form(ww, uu, x);
-                    val += fuw * w * J;
-                }
-            }
-        } else {
-            int ex = side == boundary::left ? 0 : Ux.elements - 1;
-            if (!supported_in_1d(j[0], ex, Vx) || !supported_in_1d(i[0], ex, Ux))
-                return 0;
-
-            auto x0 = side == boundary::left ? Ux.a : Ux.b;
-
-            for (auto e : Uy.basis.element_range(i[1])) {
-                if (!supported_in_1d(j[1], e, Vy))
-                    continue;
-
-                double J = Uy.basis.J[e];
-
-                for (int q = 0; q < Uy.basis.quad_order; ++q) {
-                    double w = Uy.basis.w[q];
-                    point_type x{x0, Uy.basis.x[e][q]};
-                    value_type ww = eval_basis_at(x, {ex, e}, i, Ux, Uy);
-                    value_type uu = eval_basis_at(x, {ex, e}, j, Vx, Vy);
-                    double fuw = form(ww, uu, x);
-                    val += fuw * w * J;
-                }
-            }
-        }
-        return val;
-    }
-
     template <typename Fun, typename Form>
     double integrate_boundary(boundary side, index_type i, const dimension& Ux, const dimension& Uy,
                               Fun&& g, Form&& form) const {
@@ -354,66 +330,56 @@ private:
         }
 
         // B, B^T
-        for (auto i : dofs(Vx, Vy)) {
-            for (auto j : dofs(Ux, Uy)) {
-                if (is_fixed(i, Vx, Vy) || is_fixed(j, Ux, Uy))
+        auto value = [&](index_type i, index_type j) {
+            if (is_fixed(i, Vx, Vy) || is_fixed(j, Ux, Uy))
+                return 0.0;
+
+            double val = 0;
+            for (auto e : elements_supporting_dof(i, Vx, Vy)) {
+                if (!supported_in(j, e, Ux, Uy))
                     continue;
 
-                double val = 0;
-                for (auto e : elements_supporting_dof(i, Vx, Vy)) {
-                    if (!supported_in(j, e, Ux, Uy))
-                        continue;
-
-                    double J = jacobian(e, x, y);
-                    for (auto q : quad_points(Vx, Vy)) {
-                        double w = weight(q);
-                        auto x = point(e, q);
-                        value_type ww = eval_basis(e, q, i, Vx, Vy);
-                        value_type uu = eval_basis(e, q, j, Ux, Uy);
-
-                        auto diff = diffusion(x);
-                        double bwu = diff * grad_dot(uu, ww) + dot(beta(x), uu) * ww.val;
-                        val += bwu * w * J;
-                    }
-                }
+                double J = jacobian(e, x, y);
+                for (auto q : quad_points(Vx, Vy)) {
+                    double w = weight(q);
+                    auto x = point(e, q);
+                    value_type ww = eval_basis(e, q, i, Vx, Vy);
+                    value_type uu = eval_basis(e, q, j, Ux, Uy);
 
-                auto int_bd = [&](auto side, auto form) {
-                    if (touches(i, side, Vx, Vy) && touches(j, side, Ux, Uy)) {
-                        val += integrate_boundary(side, i, j, Vx, Vy, Ux, Uy,
-                                                  [&](auto w, auto u, auto x) {
-                                                      return form(w, u, x, this->normal(side));
-                                                  });
-                    }
-                };
-
-                auto boundary_term = [&](auto form) {
-                    int_bd(boundary::left, form);
-                    int_bd(boundary::right, form);
-                    int_bd(boundary::top, form);
-                    int_bd(boundary::bottom, form);
-                };
-
-                // <eps \/u*n, v>
-                boundary_term(
-                    [&](auto w, auto u, auto, auto n) { return -epsilon * w.val * dot(u, n); });
-                // <u, eps \/v*n>
-                boundary_term(
-                    [&](auto w, auto u, auto, auto n) { return -epsilon * u.val * dot(w, n); });
-                // <u, v beta*n>
-                boundary_term([&](auto w, auto u, point_type x, auto n) {
-                    return -u.val * w.val * dot(beta(x), n);
-                });
-                // <u, gamma v>
-                boundary_term([&](auto w, auto u, auto, auto) { return -u.val * w.val * gamma; });
-
-                if (val != 0) {
-                    int ii = linear_index(i, Vx, Vy) + 1;
-                    int jj = linear_index(j, Ux, Uy) + 1;
-
-                    problem.add(ii, N + jj, -val);
-                    problem.add(N + jj, ii, val);
+                    auto diff = diffusion(x);
+                    double bwu = diff * grad_dot(uu, ww) + dot(beta(x), uu) * ww.val;
+                    val += bwu * w * J;
                 }
             }
+            return val;
+        };
+        auto emit = [&](index_type i, index_type j, double val) {
+            int ii = linear_index(i, Vx, Vy) + 1;
+            int jj = linear_index(j, Ux, Uy) + 1;
+
+            problem.add(ii, N + jj, -val);
+            problem.add(N + jj, ii, val);
+        };
+        assemble_coupled_block(Vx, Vy, Ux, Uy, executor, value, emit);
+
+        // Nitsche boundary terms of B, B^T
+        auto add_boundary = [&](index_type i, index_type j, double val) {
+            if (!is_fixed(i, Vx, Vy) && !is_fixed(j, Ux, Uy)) {
+                emit(i, j, val);
+            }
+        };
+
+        for (const auto& side : nitsche) {
+            // <eps \/u*n, v> + <u, eps \/v*n> + <u, gamma v>
+            side.trace.assemble(
+                side.M,
+                [&](trace_value w, trace_value u) {
+                    return -epsilon * (w.val * u.dn + u.val * w.dn) - gamma * u.val * w.val;
+                },
+                add_boundary);
+            // <u, v beta*n>
+            side.trace.assemble(
+                side.Mb, [](trace_value w, trace_value u) { return -u.val * w.val; }, add_boundary);
         }
 
         // Dirichlet BC - upper left
@@ -445,6 +411,17 @@ private:
         }
     }
 
+    void prepare_nitsche_terms() {
+        nitsche.clear();
+        for (auto side : {boundary::left, boundary::right, boundary::bottom, boundary::top}) {
+            auto trace = boundary_trace{side, Vx, Vy, Ux, Uy};
+            auto n = trace.normal();
+            auto M = trace.mass();
+            auto Mb = trace.mass([&](point_type x) { return dot(beta(x), n); });
+            nitsche.push_back({std::move(trace), std::move(M), std::move(Mb)});
+        }
+    }
+
     void prepare_matrices() {
         gram_matrix_1d(MVx, Vx.basis);
         gram_matrix_1d(MVy, Vy.basis);
@@ -479,6 +456,7 @@ private:
 
     void before() override {
         prepare_matrices();
+        prepare_nitsche_terms();
         Ux.factorize_matrix();
         Uy.factorize_matrix();
         Vx.factorize_matrix();
@@ -535,7 +513,7 @@ private:
 
         integration_timer.start();
         // compute_rhs_nonstationary(Vx, Vy, r_rhs, u_rhs, t);
-        compute_rhs(Vx, Vy, r_rhs, u_rhs);
+        compute_rhs(r_rhs, u_rhs);
 
         // BC
         dirichlet_bc(u_rhs, boundary::left, Ux, Uy, 0);
@@ -561,7 +539,7 @@ private:
         return norm(u_rhs);
     }
 
-    void step(int /*iter*/, double t) override {
+    void step(int iter, double t) override {
         // bool xrhs[] = { false, true };
 
         // bool x_rhs = xrhs[iter % sizeof(xrhs)];
@@ -574,15 +552,19 @@ private:
         // swap(u, u_prev);
         // zero(u);
 
-        // std::cout << "Step " << (iter + 1) << std::endl;
-        constexpr auto max_iters = 30;
-        for (int i = 1;; ++i) {
+        std::cout << "Step " << (iter + 1) << std::endl;
+        outer.start();
+        for (;;) {
+            outer.record(r.data, u);
             auto norm = substep(true, true, t);
-            // std::cout << "  substep " << i << ": |eta| = " << norm << std::endl;
-            if (norm < 1e-7 || i >= max_iters) {
+            std::cout << "  substep " << outer.iterations() + 1 << ": |eta| = " << norm
+                      << std::endl;
+            if (outer.finished(norm)) {
                 break;
             }
+            outer.accelerate(r.data, u);
         }
+        outer.print_summary(std::cout);
     }
 
     void after_step(int iter, double /*t*/) override {
@@ -609,54 +591,12 @@ private:
         print_solution("solution.data", u, Ux, Uy);
     }
 
-    void compute_rhs(const dimension& Vx, const dimension& Vy, vector_view& r_rhs,
-                     vector_view& u_rhs) {
-        executor.for_each(elements(Vx, Vy), [&](index_type e) {
-            auto R = vector_type{{Vx.basis.dofs_per_element(), Vy.basis.dofs_per_element()}};
-            auto U = vector_type{{Ux.basis.dofs_per_element(), Uy.basis.dofs_per_element()}};
-
-            double J = jacobian(e);
-            for (auto q : quad_points(Vx, Vy)) {
-                double W = weight(q);
-                double WJ = W * J;
-                auto x = point(e, q);
-                value_type uu = eval(u, e, q, Ux, Uy);
-                value_type rr = eval(r.data, e, q, *r.Vx, *r.Vy);
-                auto diff = diffusion(x);
+    void compute_rhs(vector_view& r_rhs, vector_view& u_rhs) {
+        // Bu, -B'w
+        B_form.apply(u, r.data, r_rhs, u_rhs, 1, -1);
+        // -Aw
+        A_form.apply(r.data, r_rhs, -1);
 
-                for (auto a : dofs_on_element(e, Vx, Vy)) {
-                    auto aa = dof_global_to_local(e, a, Vx, Vy);
-                    value_type v = eval_basis(e, q, a, Vx, Vy);
-
-                    // double F = 1;
-                    double F = 0;
-                    // double F = erikkson2_forcing(x[0], x[1], epsilon);
-                    double lv = F * v.val;
-
-                    double val = -lv;
-
-                    // Bu
-                    val += diff * grad_dot(uu, v) + dot(beta(x), uu) * v.val;
-                    // -Aw
-                    val -= (rr.val * v.val + h * h * grad_dot(rr, v));
-
-                    R(aa[0], aa[1]) += val * WJ;
-                }
-                for (auto a : dofs_on_element(e, Ux, Uy)) {
-                    auto aa = dof_global_to_local(e, a, Ux, Uy);
-                    value_type w = eval_basis(e, q, a, Ux, Uy);
-                    double val = 0;
-
-                    // -B'w
-                    val -= diff * grad_dot(w, rr) + dot(beta(x), w) * rr.val;
-                    U(aa[0], aa[1]) += val * WJ;
-                }
-            }
-            executor.synchronized([&]() {
-                update_global_rhs(r_rhs, R, e, Vx, Vy);
-                update_global_rhs(u_rhs, U, e, Ux, Uy);
-            });
-        });
         // // Boundary terms
         // for (auto i : dofs(Vx, Vy)) {
         //     double val = 0;
@@ -5,7 +5,13 @@
 #define ERIKKSON_ERIKKSON_INVERSE_HPP
 
 #include <galois/Timer.h>
+#include <cmath>
+#include <optional>
+#include <utility>
+#include <vector>
 
+#include "../common/coupled_assembly.hpp"
+#include "../common/mumps_factorization.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/lin/dense_matrix.hpp"
 #include "ads/lin/dense_solve.hpp"
@@ -49,15 +55,33 @@ private:
 
     point_type beta;
 
+    // Solution of the problem on another trial space, e.g. of a coarser level,
+    // projected onto this one to serve as the initial guess
+    struct initial_guess {
+        vector_type u;
+        dimension x, y;
+    };
+    std::optional<initial_guess> guess;
+
+    // Iterative refinement with the factorized matrix - at most max_sweeps
+    // solves, stopping once the relative residual drops below tolerance
+    int max_sweeps = 3;
+    double tolerance = 1e-12;
+    std::vector<double> residuals_;
+
     galois::StatTimer solver_timer{"solver"};
-    mumps::solver solver;
+    mumps::factorization solver;
 
     output_manager<2> output;
 
+    // no progress report and no output files, the solution is only kept in memory
+    bool quiet;
+
 public:
     erikkson_inverse(double bx, double by,                                //
                      dimension const& trial_x, dimension const& trial_y,  //
-                     dimension const& test_x, dimension const& test_y)
+                     dimension const& test_x, dimension const& test_y,    //
+                     bool quiet = false)
     : Base{test_x, test_y, timesteps_config{1, 0.0}}
     , Ux{trial_x}
     , Uy{trial_y}
@@ -79,7 +103,26 @@ public:
     , full_rhs(Vx.dofs() * Vy.dofs() + Ux.dofs() * Uy.dofs())
     , h{element_diam(Ux, Uy)}
     , beta{bx, by}
-    , output{Ux.B, Uy.B, 500} { }
+    , output{Ux.B, Uy.B, 500}
+    , quiet{quiet} { }
+
+    // Coefficients of the solution in the trial space, available after run()
+    const vector_type& solution() const { return u; }
+
+    // Starts the solver from the solution u0 of the problem on the trial space
+    // U0x x U0y, instead of from zero. Needs to be called before run().
+    void warm_start(vector_type u0, dimension const& U0x, dimension const& U0y) {
+        guess = initial_guess{std::move(u0), U0x, U0y};
+    }
+
+    void set_refinement(int max_sweeps, double tolerance) {
+        this->max_sweeps = max_sweeps;
+        this->tolerance = tolerance;
+    }
+
+    // Relative residuals of the initial guess and after each solve, available
+    // after run()
+    const std::vector<double>& residuals() const { return residuals_; }
 
 private:
     double element_diam(const dimension& Ux, const dimension& Uy) const {
@@ -103,25 +146,24 @@ private:
         }
 
         // B, B^T
-        for (auto i : dofs(Vx, Vy)) {
-            for (auto j : dofs(Ux, Uy)) {
-                double val = 0;
-                val += c_diff[0] * kron(KUVx, MUVy, i, j) + beta[0] * kron(AUVx, MUVy, i, j);
-                val += c_diff[1] * kron(MUVx, KUVy, i, j) + beta[1] * kron(MUVx, AUVy, i, j);
-
-                if (val != 0) {
-                    int ii = linear_index(i, Vx, Vy) + 1;
-                    int jj = linear_index(j, Ux, Uy) + 1;
-
-                    if (!is_boundary(i, Vx, Vy)) {
-                        problem.add(ii, N + jj, -val);
-                    }
-                    if (!is_boundary(i, Vx, Vy) && !is_boundary(j, Ux, Uy)) {
-                        problem.add(N + jj, ii, val);
-                    }
-                }
+        auto value = [&](index_type i, index_type j) {
+            double val = 0;
+            val += c_diff[0] * kron(KUVx, MUVy, i, j) + beta[0] * kron(AUVx, MUVy, i, j);
+            val += c_diff[1] * kron(MUVx, KUVy, i, j) + beta[1] * kron(MUVx, AUVy, i, j);
+            return val;
+        };
+        auto emit = [&](index_type i, index_type j, double val) {
+            int ii = linear_index(i, Vx, Vy) + 1;
+            int jj = linear_index(j, Ux, Uy) + 1;
+
+            if (!is_boundary(i, Vx, Vy)) {
+                problem.add(ii, N + jj, -val);
             }
-        }
+            if (!is_boundary(i, Vx, Vy) && !is_boundary(j, Ux, Uy)) {
+                problem.add(N + jj, ii, val);
+            }
+        };
+        assemble_coupled_block(Vx, Vy, Ux, Uy, executor, value, emit);
 
         // Dirichlet BC - upper left
         for_boundary_dofs(Vx, Vy, [&](index_type dof) {
@@ -164,16 +206,50 @@ private:
         Ux.factorize_matrix();
         Uy.factorize_matrix();
 
+        if (guess) {
+            project_guess();
+            guess.reset();
+        }
         stationary_bc(u, Ux, Uy);
     }
 
+    void project_guess() {
+        auto const& g = *guess;
+        bspline::eval_ctx ctx_x{g.x.B.degree}, ctx_y{g.y.B.degree};
+        auto const fun = [&](double x, double y) {
+            return bspline::eval(x, y, g.u, g.x.B, g.y.B, ctx_x, ctx_y);
+        };
+        compute_projection(u, Ux.basis, Uy.basis, fun);
+        ads_solve(u, u_buffer, Ux.data(), Uy.data());
+    }
+
+    // r = b - A x, with A given by the entries of problem
+    static void residual(mumps::problem& problem, std::vector<double> const& x,
+                         std::vector<double> const& b, std::vector<double>& r) {
+        r = b;
+        auto const* irn = problem.irn();
+        auto const* jcn = problem.jcn();
+        auto const* a = problem.a();
+        for (int k = 0; k < problem.nonzero_entries(); ++k) {
+            r[irn[k] - 1] -= a[k] * x[jcn[k] - 1];
+        }
+    }
+
+    static double norm(std::vector<double> const& v) {
+        double sum = 0;
+        for (double a : v) {
+            sum += a * a;
+        }
+        return std::sqrt(sum);
+    }
+
     void step(int /*iter*/, double t) override {
         mumps::problem problem{full_rhs};
 
-        std::cout << "Assembling matrix" << std::endl;
+        log("Assembling matrix");
         assemble_problem(problem, steps.dt);
 
-        std::cout << "Computing RHS" << std::endl;
+        log("Computing RHS");
         zero(rhs);
 
         std::fill(begin(full_rhs), end(full_rhs), 0);
@@ -185,17 +261,48 @@ private:
         }
         stationary_bc(view_out, Ux, Uy);
 
-        std::cout << "Solving" << std::endl;
+        // Starting from u - zero or the projected initial guess, with the boundary
+        // values already set - and zero in the test space
+        auto sol = std::vector<double>(full_rhs.size());
+        vector_view sol_out{sol.data() + view_in.size(), {Ux.dofs(), Uy.dofs()}};
+        for (auto i : dofs(Ux, Uy)) {
+            sol_out(i[0], i[1]) = u(i[0], i[1]);
+        }
+
+        log("Solving");
         solver_timer.start();
-        solver.solve(problem);
+        solver.factorize(problem);
+
+        auto r = std::vector<double>(full_rhs.size());
+        auto const norm_rhs = norm(full_rhs);
+        residuals_.clear();
+        for (int sweep = 0;; ++sweep) {
+            residual(problem, sol, full_rhs, r);
+            residuals_.push_back(norm_rhs > 0 ? norm(r) / norm_rhs : norm(r));
+            if (sweep == max_sweeps || residuals_.back() <= tolerance) {
+                break;
+            }
+            solver.solve(problem, r.data());
+            for (std::size_t i = 0; i < sol.size(); ++i) {
+                sol[i] += r[i];
+            }
+        }
         solver_timer.stop();
 
         for (auto i : dofs(Ux, Uy)) {
-            u(i[0], i[1]) = view_out(i[0], i[1]);
+            u(i[0], i[1]) = sol_out(i[0], i[1]);
         }
 
+        if (quiet) {
+            return;
+        }
         std::cout << "  solver time:       " << static_cast<double>(solver_timer.get()) << " ms"
                   << std::endl;
+        std::cout << "  residuals:        ";
+        for (double res : residuals_) {
+            std::cout << " " << res;
+        }
+        std::cout << std::endl;
         std::cout << "  assembly    FLOPS: " << solver.flops_assembly() << std::endl;
         std::cout << "  elimination FLOPS: " << solver.flops_elimination() << std::endl;
 
@@ -203,10 +310,19 @@ private:
     }
 
     void after() override {
+        if (quiet) {
+            return;
+        }
         output.to_file(u, "values.data");
         print_solution("coeffs.data", u, Ux, Uy);
     }
 
+    void log(const char* message) const {
+        if (!quiet) {
+            std::cout << message << std::endl;
+        }
+    }
+
     double errorL2(double /*t*/) const {
         auto const exact = [&](auto x) { return erikkson_exact(x[0], x[1], epsilon); };
         return error_relative_L2(u, Ux, Uy, exact) * 100;
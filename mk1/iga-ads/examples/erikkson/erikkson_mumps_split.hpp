@@ -4,6 +4,11 @@
 #ifndef ERIKKSON_ERIKKSON_MUMPS_SPLIT_HPP
 #define ERIKKSON_ERIKKSON_MUMPS_SPLIT_HPP
 
+#include <map>
+#include <tuple>
+
+#include "../common/coupled_assembly.hpp"
+#include "../common/mumps_factorization.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/lin/dense_matrix.hpp"
 #include "ads/lin/dense_solve.hpp"
@@ -81,7 +86,10 @@ private:
     // point_type beta{{ len * cos(angle), len * sin(angle) }};
     point_type beta{{1, 0}};
 
-    mumps::solver solver;
+    // Factorized substep matrices, keyed by refinement flags and left-hand side
+    // coefficients. Each scheme uses at most two distinct matrices.
+    using lhs_key = std::tuple<bool, bool, double, double>;
+    std::map<lhs_key, mumps::factorization> factorizations;
 
     output_manager<2> output;
 
@@ -178,26 +186,25 @@ private:
         });
 
         // B, B^T
-        for (auto i : dofs(Vx, Vy)) {
-            for (auto j : dofs(Ux, Uy)) {
-                double MM = kron(M.MUVx, M.MUVy, i, j);
-                double Lx =
-                    c_diff[0] * kron(M.KUVx, M.MUVy, i, j) + beta[0] * kron(M.AUVx, M.MUVy, i, j);
-                double Ly =
-                    c_diff[1] * kron(M.MUVx, M.KUVy, i, j) + beta[1] * kron(M.MUVx, M.AUVy, i, j);
-                double val = MM + cx * Lx + cy * Ly;
-
-                if (val != 0) {
-                    if (!is_boundary(i, Vx, Vy) && !is_boundary(j, Ux, Uy)) {
-                        int ii = linear_index(i, Vx, Vy) + 1;
-                        int jj = linear_index(j, Ux, Uy) + 1;
-
-                        problem.add(ii, N + jj, -val);
-                        problem.add(N + jj, ii, val);
-                    }
-                }
-            }
-        }
+        auto value = [&](index_type i, index_type j) {
+            if (is_boundary(i, Vx, Vy) || is_boundary(j, Ux, Uy))
+                return 0.0;
+
+            double MM = kron(M.MUVx, M.MUVy, i, j);
+            double Lx =
+                c_diff[0] * kron(M.KUVx, M.MUVy, i, j) + beta[0] * kron(M.AUVx, M.MUVy, i, j);
+            double Ly =
+                c_diff[1] * kron(M.MUVx, M.KUVy, i, j) + beta[1] * kron(M.MUVx, M.AUVy, i, j);
+            return MM + cx * Lx + cy * Ly;
+        };
+        auto emit = [&](index_type i, index_type j, double val) {
+            int ii = linear_index(i, Vx, Vy) + 1;
+            int jj = linear_index(j, Ux, Uy) + 1;
+
+            problem.add(ii, N + jj, -val);
+            problem.add(N + jj, ii, val);
+        };
+        assemble_coupled_block(Vx, Vy, Ux, Uy, executor, value, emit);
 
         // Dirichlet BC - lower right
         for_boundary_dofs(Ux, Uy, [&](index_type dof) {
@@ -306,10 +313,15 @@ private:
         zero_bc(r_rhs, Vx, Vy);
         zero_bc(u_rhs, Ux, Uy);
 
-        int size = Vx.dofs() * Vy.dofs() + Ux.dofs() * Uy.dofs();
-        mumps::problem problem(full_rhs.data(), size);
-        assemble_problem(problem, Lx_lhs, Ly_lhs, sx, sy, Vx, Vy, matrices(x_refine, y_refine));
-        solver.solve(problem);
+        auto& solver = factorizations[{x_refine, y_refine, Lx_lhs, Ly_lhs}];
+        auto const key = mumps::matrix_key(x_refine, y_refine, Lx_lhs, Ly_lhs);
+        if (!solver.factorized(key)) {
+            int size = Vx.dofs() * Vy.dofs() + Ux.dofs() * Uy.dofs();
+            mumps::problem problem(full_rhs.data(), size);
+            assemble_problem(problem, Lx_lhs, Ly_lhs, sx, sy, Vx, Vy, matrices(x_refine, y_refine));
+            solver.factorize(problem, key);
+        }
+        solver.solve(key, full_rhs.data());
 
         copy_solution(u_rhs, r_rhs, u);
     }
@@ -3,6 +3,7 @@
 
 #include "inverse.hpp"
 
+#include <fstream>
 #include <utility>
 
 #include "ads/util.hpp"
@@ -61,3 +62,23 @@ auto basis_from_points(std::vector<double> const& points, int p, int c) -> ads::
     }
     return {std::move(knot), p};
 }
+
+auto inverse_basis_x(int n, int p, int c) -> ads::bspline::basis {
+    auto const d = shishkin_const(n, inverse_epsilon);
+    return basis_from_points(make_points(n, false, true, d), p, c);
+}
+
+auto inverse_basis_y(int n, int p, int c) -> ads::bspline::basis {
+    auto const d = shishkin_const(n, inverse_epsilon);
+    return basis_from_points(make_points(n, true, true, d), p, c);
+}
+
+auto write_binary_solution(std::string const& path, ads::lin::tensor<double, 2> const& u) -> void {
+    auto output = std::ofstream{path, std::ios::binary};
+    output.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+    int const sizes[] = {u.size(0), u.size(1)};
+    output.write(reinterpret_cast<char const*>(sizes), sizeof(sizes));
+    output.write(reinterpret_cast<char const*>(u.data()),
+                 static_cast<std::streamsize>(sizeof(double) * u.size()));
+}
@@ -6,9 +6,11 @@
 
 #include <array>
 #include <cmath>
+#include <string>
 #include <vector>
 
 #include "ads/bspline/bspline.hpp"
+#include "ads/lin/tensor.hpp"
 
 inline auto shishkin_const(int n, double eps) -> double {
     return std::log(n) / std::log(2) * eps;
@@ -20,4 +22,17 @@ auto make_points(int elems, bool left, bool right, double width) -> std::vector<
 
 auto basis_from_points(std::vector<double> const& points, int p, int c) -> ads::bspline::basis;
 
+// Diffusion coefficient of the inverse problem, determines the width of layers
+constexpr double inverse_epsilon = 1e-2;
+
+// Bases of the spaces of the inverse problem with n elements in each direction,
+// refined towards the boundary layers at x = 1 and y = 0, 1
+auto inverse_basis_x(int n, int p, int c) -> ads::bspline::basis;
+
+auto inverse_basis_y(int n, int p, int c) -> ads::bspline::basis;
+
+// Coefficients in binary form: both sizes as ints, then the values in the
+// order of the tensor storage
+auto write_binary_solution(std::string const& path, ads::lin::tensor<double, 2> const& u) -> void;
+
 #endif  // ERIKKSON_INVERSE_HPP
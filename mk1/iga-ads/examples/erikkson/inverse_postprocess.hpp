@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef ERIKKSON_INVERSE_POSTPROCESS_HPP
+#define ERIKKSON_INVERSE_POSTPROCESS_HPP
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ads/bspline/eval.hpp"
+#include "ads/executor/galois.hpp"
+#include "ads/simulation/dimension.hpp"
+#include "ads/simulation/simulation_2d.hpp"
+#include "ads/util/math/vec.hpp"
+
+// Reads coefficients written by print_solution
+inline auto read_solution(std::string const& path, ads::dimension const& x,
+                          ads::dimension const& y) -> ads::lin::tensor<double, 2> {
+    auto data = ads::lin::tensor<double, 2>{{x.dofs(), y.dofs()}};
+    auto input = std::ifstream{path};
+    input.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    for (int i = 0; i < data.size(); ++i) {
+        int ix, iy;
+        double val;
+        input >> ix >> iy >> val;
+        data(ix, iy) = val;
+    }
+    return data;
+}
+
+// Compares the solutions of two levels - prints the L2 and H1 norms of the
+// difference of the coarse solution and the fine one, and values of the fine
+// solution at a 3 x 3 grid of points. The coarse solution is evaluated on the
+// fine mesh, so the meshes need not be nested.
+class inverse_postprocess : public ads::simulation_2d {
+private:
+    ads::dimension dcoarse_x;
+    ads::dimension dcoarse_y;
+    ads::dimension dfine_x;
+    ads::dimension dfine_y;
+
+    vector_type u_coarse, u_fine;
+
+    ads::bspline::eval_ders_ctx ctx_coarse_x;
+    ads::bspline::eval_ders_ctx ctx_coarse_y;
+    ads::bspline::eval_ders_ctx ctx_fine_x;
+    ads::bspline::eval_ders_ctx ctx_fine_y;
+
+    ads::galois_executor executor{4};
+
+public:
+    inverse_postprocess(vector_type u_coarse,                                              //
+                        ads::dimension const& dcoarse_x, ads::dimension const& dcoarse_y,  //
+                        vector_type u_fine,                                                //
+                        ads::dimension const& dfine_x, ads::dimension const& dfine_y)
+    : simulation_2d{dcoarse_x, dcoarse_y, ads::timesteps_config{1, 1.0}}
+    , dcoarse_x{dcoarse_x}
+    , dcoarse_y{dcoarse_y}
+    , dfine_x{dfine_x}
+    , dfine_y{dfine_y}
+    , u_coarse{std::move(u_coarse)}
+    , u_fine{std::move(u_fine)}
+    , ctx_coarse_x{dcoarse_x.p, 1}
+    , ctx_coarse_y{dcoarse_y.p, 1}
+    , ctx_fine_x{dfine_x.p, 1}
+    , ctx_fine_y{dfine_y.p, 1} { }
+
+    auto eval_coarse(double x, double y) -> value_type {
+        return ads::bspline::eval_ders(x, y, u_coarse, dcoarse_x.B, dcoarse_y.B, ctx_coarse_x,
+                                       ctx_coarse_y);
+    }
+
+    auto eval_fine(double x, double y) -> value_type {
+        return ads::bspline::eval_ders(x, y, u_fine, dfine_x.B, dfine_y.B, ctx_fine_x, ctx_fine_y);
+    }
+
+    auto before() -> void override {
+        auto const diffL2 =
+            errorL2(u_fine, dfine_x, dfine_y, [&](auto x) { return eval_coarse(x[0], x[1]); });
+        auto const diffH1 =
+            errorH1(u_fine, dfine_x, dfine_y, [&](auto x) { return eval_coarse(x[0], x[1]); });
+
+        std::cout << diffL2 << " " << diffH1 << std::endl;
+
+        auto const points = std::vector<ads::math::vec<2>>{
+            {0.25, 0.25}, {0.25, 0.50}, {0.25, 0.75},  //
+            {0.50, 0.25}, {0.50, 0.50}, {0.50, 0.75},  //
+            {0.75, 0.25}, {0.75, 0.50}, {0.75, 0.75},  //
+        };
+
+        for (auto const [x, y] : points) {
+            const auto val = eval_fine(x, y).val;
+            std::cout << val << " ";
+        }
+        std::cout << std::endl;
+    }
+};
+
+#endif  // ERIKKSON_INVERSE_POSTPROCESS_HPP
@@ -50,17 +50,10 @@ auto main(int argc, char* argv[]) -> int {
     auto const quad_order = std::max(args.p_trial, args.p_test) + 1;
     auto const ders = 1;
 
-    auto const eps = 1e-2;
-    auto const d = shishkin_const(args.n, eps);
-
-    auto trial_basis_x =
-        basis_from_points(make_points(args.n, false, true, d), args.p_trial, args.c_trial);
-    auto trial_basis_y =
-        basis_from_points(make_points(args.n, true, true, d), args.p_trial, args.c_trial);
-    auto test_basis_x =
-        basis_from_points(make_points(args.n, false, true, d), args.p_test, args.c_test);
-    auto test_basis_y =
-        basis_from_points(make_points(args.n, true, true, d), args.p_test, args.c_test);
+    auto trial_basis_x = inverse_basis_x(args.n, args.p_trial, args.c_trial);
+    auto trial_basis_y = inverse_basis_y(args.n, args.p_trial, args.c_trial);
+    auto test_basis_x = inverse_basis_x(args.n, args.p_test, args.c_test);
+    auto test_basis_y = inverse_basis_y(args.n, args.p_test, args.c_test);
 
     auto dtrial_x = ads::dimension{trial_basis_x, quad_order, ders};
     auto dtrial_y = ads::dimension{trial_basis_y, quad_order, ders};
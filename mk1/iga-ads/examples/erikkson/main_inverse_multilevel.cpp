@@ -0,0 +1,152 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include <lyra/lyra.hpp>
+
+#include "ads/simulation/dimension.hpp"
+#include "ads/simulation/utils.hpp"
+#include "erikkson_inverse.hpp"
+#include "inverse.hpp"
+#include "inverse_postprocess.hpp"
+
+// Solves the problem on a sequence of consecutive levels and compares the
+// solutions of each pair of them, like inverse.sh, but in a single process -
+// coefficients are passed between the levels and to the postprocessing
+// directly instead of through text files. Each level is started from the
+// solution of the previous one, projected onto its trial space, and refined
+// iteratively with its factorized matrix.
+
+auto parse_args(int argc, char* argv[]) {
+    struct {
+        int level;
+        double bx, by;
+        int levels = 2;
+        int sweeps = 3;
+        double tolerance = 1e-12;
+        int n_base = 16;
+        int p_trial = 2, c_trial = 1;
+        int p_test = 2, c_test = 0;
+        bool text = false;
+        bool binary = false;
+    } args{};
+
+    bool show_help = false;
+
+    auto const cli = lyra::help(show_help)                                            //
+                   | lyra::arg(args.level, "level")("accuracy level").required()      //
+                   | lyra::arg(args.bx, "bx")("x advection").required()               //
+                   | lyra::arg(args.by, "by")("y advection").required()               //
+                   | lyra::opt(args.levels, "L")["--levels"]("number of levels")      //
+                   | lyra::opt(args.sweeps, "S")["--sweeps"]                          //
+                     ("maximum number of solves on each level")
+                   | lyra::opt(args.tolerance, "tol")["--tolerance"]                  //
+                     ("relative residual at which the solves stop")
+                   | lyra::opt(args.n_base, "N")["--n-base"]("mesh resolution base")  //
+                   | lyra::opt(args.p_trial, "p")["--trial-p"]("trial p")             //
+                   | lyra::opt(args.c_trial, "c")["--trial-c"]("trial continuity")    //
+                   | lyra::opt(args.p_test, "P")["--test-p"]("test p")                //
+                   | lyra::opt(args.c_test, "C")["--test-c"]("test continuity")       //
+                   | lyra::opt(args.text)["--text"]                                   //
+                     ("save coefficients to level_<level>.data")
+                   | lyra::opt(args.binary)["--binary"]                               //
+                     ("save coefficients to level_<level>.bin")
+        ;
+
+    auto const result = cli.parse({argc, argv});
+
+    if (!result) {
+        std::cerr << "Error: " << result.errorMessage() << std::endl;
+        std::cerr << cli << std::endl;
+        std::exit(1);
+    }
+
+    if (show_help) {
+        std::cout << cli << std::endl;
+        std::exit(0);
+    }
+
+    if (args.levels < 1 || args.sweeps < 1) {
+        std::cerr << "Error: number of levels and sweeps need to be positive" << std::endl;
+        std::cerr << cli << std::endl;
+        std::exit(1);
+    }
+
+    return args;
+}
+
+auto main(int argc, char* argv[]) -> int {
+    auto const args = parse_args(argc, argv);
+
+    auto const quad_order = std::max(args.p_trial, args.p_test) + 1;
+    auto const ders = 1;
+
+    auto trial_x = [&](int n) {
+        return ads::dimension{inverse_basis_x(n, args.p_trial, args.c_trial), quad_order, ders};
+    };
+    auto trial_y = [&](int n) {
+        return ads::dimension{inverse_basis_y(n, args.p_trial, args.c_trial), quad_order, ders};
+    };
+    auto test_x = [&](int n) {
+        return ads::dimension{inverse_basis_x(n, args.p_test, args.c_test), quad_order, ders};
+    };
+    auto test_y = [&](int n) {
+        return ads::dimension{inverse_basis_y(n, args.p_test, args.c_test), quad_order, ders};
+    };
+
+    struct solution {
+        ads::lin::tensor<double, 2> u;
+        ads::dimension x, y;
+    };
+
+    // Solves on the mesh with n elements, starting from the previous solution
+    auto solve = [&](int n, std::optional<solution> const& previous, std::string const& name) {
+        auto Ux = trial_x(n);
+        auto Uy = trial_y(n);
+        auto sim = ads::erikkson_inverse{args.bx, args.by, Ux, Uy, test_x(n), test_y(n), true};
+        sim.set_refinement(args.sweeps, args.tolerance);
+        if (previous) {
+            sim.warm_start(previous->u, previous->x, previous->y);
+        }
+        sim.run();
+        auto u = sim.solution();
+
+        std::cout << name << ": " << n << " elements, residuals:";
+        for (double res : sim.residuals()) {
+            std::cout << " " << res;
+        }
+        std::cout << std::endl;
+
+        if (args.text) {
+            ads::print_solution(name + ".data", u, Ux, Uy);
+        }
+        if (args.binary) {
+            write_binary_solution(name + ".bin", u);
+        }
+        return solution{std::move(u), std::move(Ux), std::move(Uy)};
+    };
+
+    try {
+        auto previous = std::optional<solution>{};
+        for (int level = args.level; level < args.level + args.levels; ++level) {
+            auto const n = static_cast<int>(std::ldexp(args.n_base, level - 1));
+            auto current = solve(n, previous, "level_" + std::to_string(level));
+
+            if (previous) {
+                inverse_postprocess{std::move(previous->u), previous->x, previous->y,  //
+                                    current.u, current.x, current.y}
+                    .run();
+            }
+            previous = std::move(current);
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
 // SPDX-License-Identifier: MIT
 
+#include "../common/mesh_points.hpp"
 #include "ads/util.hpp"
 #include "erikkson_cg.hpp"
 #include "erikkson_cg_weak.hpp"
@@ -9,57 +10,6 @@
 #include "erikkson_supg_weak.hpp"
 #include "pollution_rotation.hpp"
 
-double shishkin_const(int n, double eps) {
-    return std::log(n) / std::log(2) * eps;
-}
-
-ads::bspline::basis create_basis(double a, double b, int p, int elements, int repeated_nodes,
-                                 bool adapt, double d) {
-    int points = elements + 1;
-    int r = repeated_nodes + 1;
-    int knot_size = 2 * (p + 1) + (points - 2) * r;
-    ads::bspline::knot_vector knot(knot_size);
-
-    for (int i = 0; i <= p; ++i) {
-        knot[i] = a;
-        knot[knot_size - i - 1] = b;
-    }
-
-    auto x0 = 0.5;
-    auto y0 = 1 - d;
-
-    for (int i = 1; i < points - 1; ++i) {
-        auto t = ads::lerp(i, elements, 0.0, 1.0);
-
-        auto s = adapt ? (t < x0 ? t / x0 * y0 : (t - x0) / (1 - x0) * (1 - y0) + y0) : t;
-        for (int j = 0; j < r; ++j) {
-            knot[p + 1 + (i - 1) * r + j] = ads::lerp(s, a, b);
-        }
-    }
-
-    return {std::move(knot), p};
-}
-
-ads::bspline::basis basis_from_points(const std::vector<double>& points, int p,
-                                      int repeated_nodes) {
-    auto elems = ads::narrow_cast<int>(points.size() - 1);
-    int r = repeated_nodes + 1;
-    int size = (elems - 1) * r + 2 * (p + 1);
-    auto knot = ads::bspline::knot_vector(size);
-
-    for (int i = 0; i <= p; ++i) {
-        knot[i] = points[0];
-        knot[size - i - 1] = points[elems];
-    }
-
-    for (int i = 1; i < elems; ++i) {
-        for (int j = 0; j < r; ++j) {
-            knot[p + 1 + (i - 1) * r + j] = points[i];
-        }
-    }
-    return {std::move(knot), p};
-}
-
 std::vector<double> make_points(int n) {
     std::vector<double> points{};
 
@@ -117,9 +67,10 @@ ads::bspline::basis create_checkboard_basis(double a, double b, int p, int eleme
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 12) {
-        std::cerr << "Usage: erikkson_mumps <type> <Nx> <Ny> <subdivision> <adapt> <p_trial> "
-                     "<C_trial> <p_test> <C_test> <dt> <steps>"
+    if (argc < 12 || argc > 15) {
+        std::cerr << "Usage: erikkson_mumps <type> <Nx> <Ny> <subdivision> <mesh> <p_trial> "
+                     "<C_trial> <p_test> <C_test> <dt> <steps> "
+                     "[anderson_depth [outer_tolerance [outer_max_iters]]]"
                   << std::endl;
         std::exit(1);
     }
@@ -128,7 +79,7 @@ int main(int argc, char* argv[]) {
     int ny = std::atoi(argv[3]);
 
     int subdivision = std::atoi(argv[4]);
-    bool adapt = std::atoi(argv[5]) != 0;
+    const std::string mesh_spec{argv[5]};
 
     int p_trial = std::atoi(argv[6]);
     int C_trial = std::atoi(argv[7]);
@@ -137,6 +88,18 @@ int main(int argc, char* argv[]) {
     auto dt = std::atof(argv[10]);
     int nsteps = std::atoi(argv[11]);
 
+    // Outer iteration of igrm-cg and igrm-cg-weak, Anderson mixing off by default
+    auto outer = ads::outer_iteration_config{};
+    if (argc > 12) {
+        outer.depth = std::atoi(argv[12]);
+    }
+    if (argc > 13) {
+        outer.tolerance = std::atof(argv[13]);
+    }
+    if (argc > 14) {
+        outer.max_iters = std::atoi(argv[14]);
+    }
+
     std::cout << "trial (" << p_trial << ", " << C_trial << "), "
               << "test (" << p_test << ", " << C_test << ")" << std::endl;
 
@@ -145,18 +108,21 @@ int main(int argc, char* argv[]) {
 
     int quad = std::max(p_trial, p_test) + 1;
 
-    std::cout << "adaptations: " << std::boolalpha << adapt << std::endl;
+    std::cout << "mesh: " << mesh_spec << std::endl;
 
     ads::timesteps_config steps{nsteps, dt};
     int ders = 2;
 
     bool const bd_layer_x = true;
     bool const bd_layer_y = false;
-    bool const adapt_x = bd_layer_x && adapt;
-    bool const adapt_y = bd_layer_y && adapt;
 
-    // auto d = 1e-4;
-    auto d = shishkin_const(nx, 1e-6);
+    // Shishkin mesh width for eps = 1e-6 unless given explicitly
+    auto defaults = ads::mesh_config{};
+    // defaults.width = 1e-4;
+    defaults.width = ads::shishkin_width(nx, 1e-6);
+    auto const mesh = ads::parse_mesh_config(mesh_spec, defaults);
+    auto const mesh_x = bd_layer_x ? mesh : ads::mesh_config{};
+    auto const mesh_y = bd_layer_y ? mesh : ads::mesh_config{};
 
     // auto points_x = make_points(nx);
     // for (auto x : points_x) {
@@ -164,26 +130,32 @@ int main(int argc, char* argv[]) {
     // }
     // std::cout << std::endl;
 
+    // Test meshes are the trial meshes with each element split into subdivision elements, as the
+    // trial dimensions evaluate on subdivided elements. Layer meshes with subdivision * N
+    // elements are not refinements of those with N elements in general.
+    auto const trial_points_x = ads::layer_points(mesh_x, 0, S, nx);
+    auto const trial_points_y = ads::layer_points(mesh_y, -S, S, ny);
+    auto const test_points_x = ads::refine_points(trial_points_x, {{0, S}}, subdivision);
+    auto const test_points_y = ads::refine_points(trial_points_y, {{-S, S}}, subdivision);
+
     // auto trial_basis_x = basis_from_points(points_x, p_trial, p_trial - 1 - C_trial);
-    auto trial_basis_x = create_basis(0, S, p_trial, nx, p_trial - 1 - C_trial, adapt_x, d);
+    auto trial_basis_x = ads::basis_from_points(trial_points_x, p_trial, p_trial - 1 - C_trial);
     // auto trial_basis_x = create_checkboard_basis(0, S, p_trial, n, p_trial - 1 - C_trial,
     // adapt_x);
     auto dtrial_x = ads::dimension{trial_basis_x, quad, ders, subdivision};
 
-    auto trial_basis_y = create_basis(-S, S, p_trial, ny, p_trial - 1 - C_trial, adapt_y, d);
+    auto trial_basis_y = ads::basis_from_points(trial_points_y, p_trial, p_trial - 1 - C_trial);
     // auto trial_basis_y = create_checkboard_basis(0, S, p_trial, n, p_trial - 1 - C_trial,
     // adapt_y);
     auto dtrial_y = ads::dimension{trial_basis_y, quad, ders, subdivision};
 
     // auto test_basis_x = basis_from_points(points_x, p_test, p_test - 1 - C_test);
-    auto test_basis_x =
-        create_basis(0, S, p_test, subdivision * nx, p_test - 1 - C_test, adapt_x, d);
+    auto test_basis_x = ads::basis_from_points(test_points_x, p_test, p_test - 1 - C_test);
     // auto test_basis_x = create_checkboard_basis(0, S, p_test, subdivision*n, p_test - 1 - C_test,
     // adapt_x);
     auto dtest_x = ads::dimension{test_basis_x, quad, ders, 1};
 
-    auto test_basis_y =
-        create_basis(-S, S, p_test, subdivision * ny, p_test - 1 - C_test, adapt_y, d);
+    auto test_basis_y = ads::basis_from_points(test_points_y, p_test, p_test - 1 - C_test);
     // auto test_basis_y = create_checkboard_basis(0, S, p_test, subdivision*n, p_test - 1 - C_test,
     // adapt_y);
     auto dtest_y = ads::dimension{test_basis_y, quad, ders, 1};
@@ -205,9 +177,9 @@ int main(int argc, char* argv[]) {
     if (type == "igrm-mumps")
         ads::erikkson_mumps{dtrial_x, dtrial_y, dtest_x, dtest_y, steps}.run();
     if (type == "igrm-cg")
-        ads::erikkson_CG{dtrial_x, dtrial_y, dtest_x, dtest_y, steps}.run();
+        ads::erikkson_CG{dtrial_x, dtrial_y, dtest_x, dtest_y, steps, outer}.run();
     if (type == "igrm-cg-weak")
-        ads::erikkson_CG_weak{dtrial_x, dtrial_y, dtest_x, dtest_y, steps}.run();
+        ads::erikkson_CG_weak{dtrial_x, dtrial_y, dtest_x, dtest_y, steps, outer}.run();
     if (type == "supg")
         ads::erikkson_supg{dtrial_x, dtrial_y, steps}.run();
     if (type == "supg-weak")
@@ -217,7 +189,7 @@ int main(int argc, char* argv[]) {
     // if (type == "split") erikkson_mumps_split{dtrial_x, dtrial_y, dtest_x, dtest_y, steps}.run();
 
     // erikkson_mumps_split sim{dtrial_x, dtrial_y, dtest_x, dtest_y, steps};
-    // pollution_CG sim{dtrial_x, dtrial_y, dtest_x, dtest_y, steps};
+    // pollution_CG sim{dtrial_x, dtrial_y, dtest_x, dtest_y, steps, outer};
     // erikkson_quanling sim{dtrial_x, dtrial_y, dtest_x, dtest_y, steps};
 
     // sim.run();
@@ -3,33 +3,13 @@
 
 #include <cstdlib>
 
+#include "../common/mesh_points.hpp"
 #include "erikkson_mumps_split.hpp"
 
-ads::bspline::basis create_basis(double a, double b, int p, int elements, int repeated_nodes) {
-    int points = elements + 1;
-    int r = repeated_nodes + 1;
-    int knot_size = 2 * (p + 1) + (points - 2) * r;
-    ads::bspline::knot_vector knot(knot_size);
-
-    for (int i = 0; i <= p; ++i) {
-        knot[i] = a;
-        knot[knot_size - i - 1] = b;
-    }
-    for (int i = 1; i < points - 1; ++i) {
-        auto t = ads::lerp(i, elements, 0.0, 1.0);
-
-        for (int j = 0; j < r; ++j) {
-            knot[p + 1 + (i - 1) * r + j] = ads::lerp(t, a, b);
-        }
-    }
-
-    return {std::move(knot), p};
-}
-
 int main(int argc, char* argv[]) {
-    if (argc != 9) {
+    if (argc != 9 && argc != 10) {
         std::cerr << "Usage: erikkson_nonstationary <type> <Nx> <Ny> <p_trial> <C_trial> <p_test> "
-                     "<C_test> <steps>"
+                     "<C_test> <steps> [mesh]"
                   << std::endl;
         std::exit(1);
     }
@@ -57,16 +37,26 @@ int main(int argc, char* argv[]) {
     ads::timesteps_config steps{nsteps, dt};
     int ders = 2;
 
-    auto trial_basis_x = create_basis(0, S, p_trial, nx, p_trial - 1 - C_trial);
+    // Boundary layer at x = 1, Shishkin mesh width for eps = 1e-2 unless given explicitly
+    auto defaults = ads::mesh_config{};
+    defaults.width = ads::shishkin_width(nx, 1e-2);
+    auto const mesh_x = argc > 9 ? ads::parse_mesh_config(argv[9], defaults) : ads::mesh_config{};
+    auto const mesh_y = ads::mesh_config{};
+
+    auto trial_basis_x = ads::basis_from_points(ads::layer_points(mesh_x, 0, S, nx), p_trial,
+                                                p_trial - 1 - C_trial);
     auto dtrial_x = ads::dimension{trial_basis_x, quad, ders, 1};
 
-    auto trial_basis_y = create_basis(0, S, p_trial, ny, p_trial - 1 - C_trial);
+    auto trial_basis_y = ads::basis_from_points(ads::layer_points(mesh_y, 0, S, ny), p_trial,
+                                                p_trial - 1 - C_trial);
     auto dtrial_y = ads::dimension{trial_basis_y, quad, ders, 1};
 
-    auto test_basis_x = create_basis(0, S, p_test, nx, p_test - 1 - C_test);
+    auto test_basis_x = ads::basis_from_points(ads::layer_points(mesh_x, 0, S, nx), p_test,
+                                               p_test - 1 - C_test);
     auto dtest_x = ads::dimension{test_basis_x, quad, ders, 1};
 
-    auto test_basis_y = create_basis(0, S, p_test, ny, p_test - 1 - C_test);
+    auto test_basis_y = ads::basis_from_points(ads::layer_points(mesh_y, 0, S, ny), p_test,
+                                               p_test - 1 - C_test);
     auto dtest_y = ads::dimension{test_basis_y, quad, ders, 1};
 
     auto trial_dim = dtrial_x.B.dofs();
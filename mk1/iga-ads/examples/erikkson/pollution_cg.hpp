@@ -4,6 +4,10 @@
 #ifndef ERIKKSON_POLLUTION_CG_HPP
 #define ERIKKSON_POLLUTION_CG_HPP
 
+#include <limits>
+
+#include "../common/mixed_form_operator.hpp"
+#include "../common/outer_iteration.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/lin/dense_matrix.hpp"
 #include "ads/lin/dense_solve.hpp"
@@ -66,8 +70,6 @@ private:
 
     double alpha = 1;
 
-    double tolerance = 1e-7;
-
     double pecelet = 1e4;
     double epsilon = 1 / pecelet;
 
@@ -79,13 +81,23 @@ private:
 
     point_type beta{{len * cos(angle), len* sin(angle)}};
 
+    // Matrix-free B, scalar product of the test space, mass matrix used for the
+    // previous time step and the emission load vector
+    mixed_form_operator B_form;
+    mixed_form_operator A_form;
+    mixed_form_operator M_form;
+    vector_type emission_load;
+
     mumps::solver solver;
+    outer_iteration outer;
 
     output_manager<2> output;
 
 public:
+    // Outer iterations are by default limited only by the tolerance
     pollution_CG(dimension trial_x, dimension trial_y, dimension test_x, dimension test_y,
-                 const timesteps_config& steps)
+                 const timesteps_config& steps,
+                 outer_iteration_config outer_config = {std::numeric_limits<int>::max(), 1e-7})
     : Base{std::move(test_x), std::move(test_y), steps}
     , Ux{std::move(trial_x)}
     , Uy{std::move(trial_y)}
@@ -116,6 +128,11 @@ public:
     , r{{{Vx.dofs(), Vy.dofs()}}, &Vx, &Vy}
     , u_buffer{{Ux.dofs(), Uy.dofs()}}
     , full_rhs(Vx.dofs() * Vy.dofs() + Ux.dofs() * Uy.dofs())
+    , B_form{Ux, Uy, Vx, Vy, executor, [this](point_type) { return form_coeffs(); }}
+    , A_form{Vx, Vy, Vx, Vy, executor, [this](point_type) { return scalar_product_coeffs(); }}
+    , M_form{Ux, Uy, Vx, Vy, executor, [](point_type) { return form_coefficients{0, 0, 0, 0, 1}; }}
+    , emission_load{{Vx.dofs(), Vy.dofs()}}
+    , outer{outer_config}
     , output{Ux.B, Uy.B, 500} { }
 
 private:
@@ -405,6 +422,8 @@ private:
         Ux.factorize_matrix();
         Uy.factorize_matrix();
 
+        M_form.load([this](point_type x) { return emission(x[0], x[1]); }, emission_load);
+
         // auto init = [this](double x, double y) { return init_state(x, y); };
         // compute_projection(u, Ux.basis, Uy.basis, init);
         // ads_solve(u, u_buffer, Ux.data(), Uy.data());
@@ -479,7 +498,7 @@ private:
         vector_view u_rhs{full_rhs.data() + r_rhs.size(), {Ux.dofs(), Uy.dofs()}};
 
         std::fill(begin(full_rhs), end(full_rhs), 0);
-        compute_rhs(Vx, Vy, r_rhs, u_rhs, steps.dt);
+        compute_rhs(r_rhs, u_rhs, steps.dt);
         zero_bc(r_rhs, u_rhs);
 
         int size = Vx.dofs() * Vy.dofs() + Ux.dofs() * Uy.dofs();
@@ -507,13 +526,18 @@ private:
         apply_bc(u);
 
         std::cout << "Step " << (iter + 1) << std::endl;
-        for (int i = 0;; ++i) {
+        outer.start();
+        for (;;) {
+            outer.record(r.data, u);
             auto norm = substep();
-            std::cout << "  substep " << (i + 1) << ": |eta| = " << norm << std::endl;
-            if (norm < tolerance) {
+            std::cout << "  substep " << outer.iterations() + 1 << ": |eta| = " << norm
+                      << std::endl;
+            if (outer.finished(norm)) {
                 break;
             }
+            outer.accelerate(r.data, u);
         }
+        outer.print_summary(std::cout);
     }
 
     void after_step(int iter, double t) override {
@@ -528,6 +552,7 @@ private:
         auto angle = M_PI / 3 * phase + 1.5 * M_PI / 4;
 
         beta = {len * cos(angle), len * sin(angle)};
+        B_form.set_coefficients([this](point_type) { return form_coeffs(); });
         // prepare_matrices();
     }
 
@@ -640,54 +665,24 @@ private:
         return (r2 - 1) * (r2 - 1) * (r2 + 1) * (r2 + 1);
     };
 
-    void compute_rhs(const dimension& Vx, const dimension& Vy, vector_view& r_rhs,
-                     vector_view& u_rhs, double dt) {
-        executor.for_each(elements(Vx, Vy), [&](index_type e) {
-            auto R = vector_type{{Vx.basis.dofs_per_element(), Vy.basis.dofs_per_element()}};
-            auto U = vector_type{{Ux.basis.dofs_per_element(), Uy.basis.dofs_per_element()}};
-
-            double J = jacobian(e);
-            for (auto q : quad_points(Vx, Vy)) {
-                double W = weight(q);
-                double WJ = W * J;
-                auto x = point(e, q);
-                value_type uu = eval(u, e, q, Ux, Uy);
-                value_type uu_prev = eval(u_prev, e, q, Ux, Uy);
-
-                value_type rr = eval(r.data, e, q, *r.Vx, *r.Vy);
-
-                for (auto a : dofs_on_element(e, Vx, Vy)) {
-                    auto aa = dof_global_to_local(e, a, Vx, Vy);
-                    value_type v = eval_basis(e, q, a, Vx, Vy);
-                    double lv = uu_prev.val * v.val + dt * emission(x[0], x[1]) * v.val;
-                    double val = -lv;
-                    // Bu
-                    val += uu.val * v.val;
-                    val += dt * (c_diff[0] * uu.dx * v.dx + beta[0] * uu.dx * v.val);
-                    val += dt * (c_diff[1] * uu.dy * v.dy + beta[1] * uu.dy * v.val);
-                    // -Aw
-                    val -= (rr.val * v.val + minh2 * (rr.dx * v.dx + rr.dy * v.dy));
-
-                    R(aa[0], aa[1]) += val * WJ;
-                }
-                for (auto a : dofs_on_element(e, Ux, Uy)) {
-                    auto aa = dof_global_to_local(e, a, Ux, Uy);
-                    value_type w = eval_basis(e, q, a, Ux, Uy);
-                    double val = 0;
+    // Coefficients of the form of the implicit Euler step, (u, v) + dt b(u, v)
+    form_coefficients form_coeffs() const {
+        double dt = steps.dt;
+        return {dt * c_diff[0], dt * c_diff[1], dt * beta[0], dt * beta[1], 1};
+    }
 
-                    // -B'w
-                    val -= w.val * rr.val;
-                    val -= dt * (c_diff[0] * w.dx * rr.dx + beta[0] * w.dx * rr.val);
-                    val -= dt * (c_diff[1] * w.dy * rr.dy + beta[1] * w.dy * rr.val);
+    form_coefficients scalar_product_coeffs() const { return {minh2, minh2, 0, 0, 1}; }
 
-                    U(aa[0], aa[1]) += val * WJ;
-                }
-            }
-            executor.synchronized([&]() {
-                update_global_rhs(r_rhs, R, e, Vx, Vy);
-                update_global_rhs(u_rhs, U, e, Ux, Uy);
-            });
-        });
+    void compute_rhs(vector_view& r_rhs, vector_view& u_rhs, double dt) {
+        // -(u_prev, v) - dt (f, v)
+        M_form.apply(u_prev, r_rhs, -1);
+        for (auto i : dofs(Vx, Vy)) {
+            r_rhs(i[0], i[1]) -= dt * emission_load(i[0], i[1]);
+        }
+        // Bu, -B'w
+        B_form.apply(u, r.data, r_rhs, u_rhs, 1, -1);
+        // -Aw
+        A_form.apply(r.data, r_rhs, -1);
     }
 
     value_type exact(double x, double y, double eps) const {
@@ -6,6 +6,7 @@
 
 #include <cmath>
 
+#include "../common/parallel_ads.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
@@ -21,6 +22,8 @@ private:
 
     galois_executor executor{4};
 
+    direction_solver Mx, My, Mz;
+
     environment env{1};
     lin::tensor<double, 6> kq;
     output_manager<3> output;
@@ -41,6 +44,13 @@ public:
     };
 
 private:
+    void prepare_matrices() {
+        Mx = mass_solver(x);
+        My = mass_solver(y);
+        Mz = mass_solver(z);
+        Base::prepare_matrices();
+    }
+
     void before() override {
         fill_permeability_map();
         prepare_matrices();
@@ -51,6 +61,8 @@ private:
         output.to_file(u, "out_%d.vti", 0);
     }
 
+    void solve(vector_type& v) { parallel_ads_solve(v, buffer, executor, Mx, My, Mz); }
+
     void fill_permeability_map() {
         for (auto e : elements()) {
             for (auto q : quad_points()) {
@@ -4,9 +4,8 @@
 #ifndef IMPLICIT_COUPLED_HPP
 #define IMPLICIT_COUPLED_HPP
 
+#include "../common/cyclic_band_solver.hpp"
 #include "ads/executor/galois.hpp"
-#include "ads/lin/dense_matrix.hpp"
-#include "ads/lin/dense_solve.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
 
@@ -26,15 +25,13 @@ private:
     output_manager<2> output;
     galois_executor executor{4};
 
-    // Large matrices - dense matrices + data for solver
-    lin::dense_matrix Ax, Ay;
-    lin::solver_ctx Ax_ctx, Ay_ctx;
+    double s = 40;
 
-    // NEW: Mass matrices for the periodic basis
-    lin::dense_matrix Mx, My;
-    lin::solver_ctx Mx_ctx, My_ctx;
+    // Periodic implicit operators, the same for both equations
+    cyclic_band_solver Ax, Ay;
 
-    double s = 40;
+    // NEW: Mass matrices for the periodic basis
+    cyclic_band_solver Mx, My;
 
 public:
     explicit coupled(const config_2d& config)
@@ -46,22 +43,10 @@ public:
     , u2{shape()}
     , u2_prev{shape()}
     , output{x.B, y.B, 200}
-    , Ax{2 * (x.dofs() - 1), 2 * (x.dofs() - 1)}  // 2x2 matrix for x direction
-    , Ay{2 * (y.dofs() - 1), 2 * (y.dofs() - 1)}  // 2x2 matrix for y direction
-    , Ax_ctx{Ax}
-    , Ay_ctx{Ay}
-    , Mx{x.dofs() - 1, x.dofs() - 1}  // NEW: initialization of mass matrices
-    , My{y.dofs() - 1, y.dofs() - 1}
-    , Mx_ctx{Mx}
-    , My_ctx{My} {
-        // Fill the large matrices
-        matrix(Ax, x.basis, steps.dt);
-        matrix(Ay, y.basis, steps.dt);
-
-        // NEW: Fill the mass matrices
-        mass_matrix(Mx, x.basis, steps.dt);
-        mass_matrix(My, y.basis, steps.dt);
-    }
+    , Ax{matrix(x.basis, steps.dt)}
+    , Ay{matrix(y.basis, steps.dt)}
+    , Mx{mass_matrix(x.basis, steps.dt)}  // NEW: initialization of mass matrices
+    , My{mass_matrix(y.basis, steps.dt)} { }
 
     double init_state(double x, double y) {
         double dx = x - 0.5;
@@ -72,8 +57,9 @@ public:
 
 private:
     // NEW: Mass matrix no longer diagonal
-    void mass_matrix(lin::dense_matrix& M, const basis_data& d, double /*h*/) {
+    static cyclic_band_matrix mass_matrix(const basis_data& d, double /*h*/) {
         auto N = d.basis.dofs() - 1;
+        auto M = cyclic_band_matrix{N, d.basis.degree};
         for (element_id e = 0; e < d.elements; ++e) {
             for (int q = 0; q < d.quad_order; ++q) {
                 int first = d.first_dof(e);
@@ -84,15 +70,19 @@ private:
                         int ib = b + first;
                         auto va = d.b[e][q][0][a];
                         auto vb = d.b[e][q][0][b];
-                        M(ia % N, ib % N) += va * vb * d.w[q] * d.J[e];  // upper left
+                        M(ia % N, ib % N) += va * vb * d.w[q] * d.J[e];
                     }
                 }
             }
         }
+        return M;
     }
 
-    void matrix(lin::dense_matrix& K, const basis_data& d, double h) const {
+    // Both equations use the same operator, so the block diagonal 2N x 2N
+    // matrix of the coupled system is represented by a single N x N block
+    cyclic_band_matrix matrix(const basis_data& d, double h) const {
         auto N = d.basis.dofs() - 1;
+        auto K = cyclic_band_matrix{N, d.basis.degree};
         for (element_id e = 0; e < d.elements; ++e) {
             for (int q = 0; q < d.quad_order; ++q) {
                 int first = d.first_dof(e);
@@ -106,8 +96,7 @@ private:
                         auto da = d.b[e][q][1][a];
                         auto db = d.b[e][q][1][b];
                         auto val = va * vb + 0.5 * h * da * db - 0.5 * h * s * va * db;
-                        K(ia % N, ib % N) += val * d.w[q] * d.J[e];          // upper left
-                        K(N + ia % N, N + ib % N) += val * d.w[q] * d.J[e];  // lower right
+                        K(ia % N, ib % N) += val * d.w[q] * d.J[e];
 
                         // Mass-Mass-Stiffness matrix (what you need if I recall correctly):
                         // K(ia, ib) += va * vb * d.w[q] * d.J[e]; // upper left
@@ -117,17 +106,10 @@ private:
                 }
             }
         }
+        return K;
     }
 
-    void prepare_matrices() {
-        Base::prepare_matrices();
-        // Dense factorization (overloaded function)
-        lin::factorize(Ax, Ax_ctx);
-        lin::factorize(Ay, Ay_ctx);
-        // NEW: factorize mass matrices
-        lin::factorize(Mx, Mx_ctx);
-        lin::factorize(My, My_ctx);
-    }
+    void prepare_matrices() { Base::prepare_matrices(); }
 
     void before() override {
         prepare_matrices();
@@ -168,12 +150,12 @@ private:
 
         // ads_solve(u, buffer, dim_data{Kx, x.ctx}, y.data());
         // ads_solve(u2, buffer, dim_data{Kx, x.ctx}, y.data());
-        // Expanded ADS call:
-        lin::solve_with_factorized(Ax, view_x, Ax_ctx);
+        // Expanded ADS call - columns of view_x hold lines of both equations:
+        Ax(view_x);
         auto F = lin::cyclic_transpose(view_x, buf.data());
         // NEW: periodic mass matrix instead of a standard one
         // lin::solve_with_factorized(y.data().M, F, y.data().ctx);
-        lin::solve_with_factorized(My, F, My_ctx);
+        My(F);
         lin::cyclic_transpose(F, view_x);
 
         // ... and copy the solutions back to the separate vectors
@@ -205,9 +187,9 @@ private:
         // Expanded ADS call:
         // NEW: periodic mass matrix instead of a standard one
         // lin::solve_with_factorized(x.data().M, view_y, x.data().ctx);
-        lin::solve_with_factorized(Mx, view_y, Mx_ctx);
+        Mx(view_y);
         auto F2 = lin::cyclic_transpose(view_y, buf.data());
-        lin::solve_with_factorized(Ay, F2, Ay_ctx);
+        Ay(F2);
         lin::cyclic_transpose(F2, view_y);
 
         // ... and copy the solutions back to the separate vectors
@@ -4,6 +4,7 @@
 #ifndef IMPLICIT_IMPLICIT_HPP
 #define IMPLICIT_IMPLICIT_HPP
 
+#include "../common/fast_diagonalization.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
@@ -18,7 +19,8 @@ private:
     output_manager<2> output;
     galois_executor executor{4};
 
-    lin::band_matrix Kx, Ky;
+    // Crank-Nicolson step M + dt/2 K solved exactly by fast diagonalization
+    fdm_direction Fx, Fy;
 
     int save_every = 1;
 
@@ -28,12 +30,9 @@ public:
     , u{shape()}
     , u_prev{shape()}
     , output{x.B, y.B, 200}
-    , Kx{x.p, x.p, x.B.dofs()}
-    , Ky{y.p, y.p, y.B.dofs()}
-    , save_every{save_every} {
-        matrix(Kx, x.basis, steps.dt);
-        matrix(Ky, y.basis, steps.dt);
-    }
+    , Fx{mass_matrix(x), stiffness_matrix(x, 0.5 * steps.dt)}
+    , Fy{mass_matrix(y), stiffness_matrix(y, 0.5 * steps.dt)}
+    , save_every{save_every} { }
 
     double init_state(double x, double y) {
         double dx = x - 0.5;
@@ -43,7 +42,16 @@ public:
     };
 
 private:
-    void matrix(lin::band_matrix& K, const basis_data& d, double h) {
+    static lin::band_matrix mass_matrix(const dimension& dim) { return matrix(dim, 1, 0); }
+
+    static lin::band_matrix stiffness_matrix(const dimension& dim, double h) {
+        return matrix(dim, 0, h);
+    }
+
+    // Matrix of the form m * (u, v) + h * (u', v')
+    static lin::band_matrix matrix(const dimension& dim, double m, double h) {
+        const auto& d = dim.basis;
+        auto K = lin::band_matrix{dim.p, dim.p, dim.B.dofs()};
         for (element_id e = 0; e < d.elements; ++e) {
             for (int q = 0; q < d.quad_order; ++q) {
                 int first = d.first_dof(e);
@@ -56,11 +64,12 @@ private:
                         auto vb = d.b[e][q][0][b];
                         auto da = d.b[e][q][1][a];
                         auto db = d.b[e][q][1][b];
-                        K(ia, ib) += (va * vb + 0.5 * h * da * db) * d.w[q] * d.J[e];
+                        K(ia, ib) += (m * va * vb + h * da * db) * d.w[q] * d.J[e];
                     }
                 }
             }
         }
+        return K;
     }
 
     void solve(vector_type& v) {
@@ -77,8 +86,6 @@ private:
     void prepare_matrices() {
         // x.fix_left();
         Base::prepare_matrices();
-        lin::factorize(Kx, x.ctx);
-        lin::factorize(Ky, y.ctx);
     }
 
     void before() override {
@@ -100,14 +107,8 @@ private:
     }
 
     void step(int /*iter*/, double /*t*/) override {
-        compute_rhs_1();
-        ads_solve(u, buffer, dim_data{Kx, x.ctx}, y.data());
-
-        using std::swap;
-        swap(u, u_prev);
-
-        compute_rhs_2();
-        ads_solve(u, buffer, x.data(), dim_data{Ky, y.ctx});
+        compute_rhs();
+        fdm_solve(u, buffer, executor, Fx, Fy);
     }
 
     void after_step(int iter, double t) override {
@@ -129,33 +130,7 @@ private:
         }
     }
 
-    void compute_rhs_1() {
-        auto& rhs = u;
-
-        zero(rhs);
-
-        executor.for_each(elements(), [&](index_type e) {
-            auto U = element_rhs();
-
-            double J = jacobian(e);
-            for (auto q : quad_points()) {
-                double w = weight(q);
-                for (auto a : dofs_on_element(e)) {
-                    auto aa = dof_global_to_local(e, a);
-                    value_type v = eval_basis(e, q, a);
-                    value_type u = eval_fun(u_prev, e, q);
-
-                    double gradient_prod = u.dy * v.dy;
-                    double val = u.val * v.val - 0.5 * steps.dt * gradient_prod;
-                    U(aa[0], aa[1]) += val * w * J;
-                }
-            }
-
-            executor.synchronized([&]() { update_global_rhs(rhs, U, e); });
-        });
-    }
-
-    void compute_rhs_2() {
+    void compute_rhs() {
         auto& rhs = u;
 
         zero(rhs);
@@ -171,7 +146,7 @@ private:
                     value_type v = eval_basis(e, q, a);
                     value_type u = eval_fun(u_prev, e, q);
 
-                    double gradient_prod = u.dx * v.dx;
+                    double gradient_prod = grad_dot(u, v);
                     double val = u.val * v.val - 0.5 * steps.dt * gradient_prod;
                     U(aa[0], aa[1]) += val * w * J;
                 }
@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <array>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include <lyra/lyra.hpp>
+
+#include "head_data.hpp"
+
+auto parse_args(int argc, char* argv[]) {
+    struct {
+        std::string input, output;
+        std::array<double, 3> spacing = {0, 0, 0};
+    } args{};
+
+    bool show_help = false;
+
+    auto const* const desc =
+        "Converts text material data for maxwell_head and maxwell_ads\n"
+        "to the binary volume format";
+
+    auto const cli = lyra::help(show_help).description(desc)                           //
+                   | lyra::arg(args.input, "input")("text density data").required()    //
+                   | lyra::arg(args.output, "output")("binary volume file").required()  //
+                   | lyra::opt(args.spacing[0], "sx")["--sx"]("voxel size in x")       //
+                   | lyra::opt(args.spacing[1], "sy")["--sy"]("voxel size in y")       //
+                   | lyra::opt(args.spacing[2], "sz")["--sz"]("voxel size in z")       //
+        ;
+
+    auto const result = cli.parse({argc, argv});
+    if (!result) {
+        std::cerr << "Error: " << result.errorMessage() << std::endl;
+        std::cerr << cli << std::endl;
+        std::exit(1);
+    }
+    if (show_help) {
+        std::cout << cli << std::endl;
+        std::exit(0);
+    }
+    return args;
+}
+
+// Example invocation:
+// <prog> mri.dat mri.vol --sx 0.5 --sy 0.5 --sz 1
+//
+// Without voxel sizes, the volume is stretched to fill the domain, like the text data.
+int main(int argc, char* argv[]) {
+    auto const args = parse_args(argc, argv);
+
+    auto const data = read_density_data(args.input);
+    try {
+        write_density_volume(data, args.spacing, args.output);
+    } catch (std::exception const& e) {
+        std::cerr << "Error writing " << args.output << ": " << e.what() << std::endl;
+        std::exit(1);
+    }
+    std::cout << data.size(0) << " x " << data.size(1) << " x " << data.size(2) << " voxels"
+              << std::endl;
+}
@@ -3,14 +3,105 @@
 
 #include "head_data.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <system_error>
+#include <utility>
+#include <vector>
 
 #include <fmt/core.h>
 
+#include "../common/mapped_file.hpp"
+
+namespace {
+
+// Binary volume header, stored in native byte order
+struct volume_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t dtype;
+    std::uint32_t dims[3];
+    std::uint32_t reserved;
+    double spacing[3];
+    std::uint64_t data_offset;
+};
+
+static_assert(sizeof(volume_header) == 64);
+
+constexpr char volume_magic[8] = {'A', 'D', 'S', 'V', 'O', 'X', 'E', 'L'};
+constexpr std::uint32_t volume_version = 1;
+
+// Voxel value types
+constexpr std::uint32_t dtype_uint8 = 1;
+
+// Validates the header of a mapped volume file and the size of its payload
+auto volume_header_of(ads::mapped_file const& file, std::string_view path) -> volume_header {
+    auto header = volume_header{};
+    if (file.size() < sizeof(header)) {
+        throw std::runtime_error{fmt::format("{}: file too short for volume header", path)};
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, volume_magic, sizeof(volume_magic)) != 0) {
+        throw std::runtime_error{fmt::format("{}: not a binary volume file", path)};
+    }
+    if (header.version != volume_version) {
+        throw std::runtime_error{
+            fmt::format("{}: unsupported volume format version {}", path, header.version)};
+    }
+    if (header.dtype != dtype_uint8) {
+        throw std::runtime_error{fmt::format("{}: unsupported voxel type {}", path, header.dtype)};
+    }
+
+    auto const count = std::size_t{header.dims[0]} * header.dims[1] * header.dims[2];
+    if (header.data_offset < sizeof(header) || header.data_offset > file.size()
+        || file.size() - header.data_offset < count) {
+        throw std::runtime_error{fmt::format("{}: truncated volume data", path)};
+    }
+    return header;
+}
+
+}  // namespace
+
+head_data::head_data(density_data const& data)
+: dims_{data.size(0), data.size(1), data.size(2)} {
+    auto voxels = std::make_shared<std::vector<byte>>();
+    voxels->reserve(static_cast<std::size_t>(dims_[0]) * dims_[1] * dims_[2]);
+    for (int iz = 0; iz < dims_[2]; ++iz) {
+        for (int iy = 0; iy < dims_[1]; ++iy) {
+            for (int ix = 0; ix < dims_[0]; ++ix) {
+                voxels->push_back(data(ix, iy, iz));
+            }
+        }
+    }
+    voxels_ = voxels->data();
+    storage_ = std::move(voxels);
+    scale_ = {double(dims_[0]), double(dims_[1]), double(dims_[2])};
+}
+
+head_data::head_data(std::shared_ptr<void const> storage, byte const* voxels, dims_type dims,
+                     point_type spacing)
+: storage_{std::move(storage)}
+, voxels_{voxels}
+, dims_{dims}
+, scale_{double(dims[0]), double(dims[1]), double(dims[2])} {
+    if (std::all_of(begin(spacing), end(spacing), [](double s) { return s > 0; })) {
+        auto length = 0.0;
+        for (int i = 0; i < 3; ++i) {
+            length = std::max(length, dims_[i] * spacing[i]);
+        }
+        for (int i = 0; i < 3; ++i) {
+            scale_[i] = length / spacing[i];
+        }
+    }
+}
+
 auto read_density_data(std::istream& input) -> ads::lin::tensor<std::uint8_t, 3> {
     using byte = std::uint8_t;
     int nx;
@@ -46,6 +137,9 @@ auto read_density_data(std::string_view path) -> ads::lin::tensor<std::uint8_t,
     std::ifstream input;
     input.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     try {
+        if (is_density_volume(path)) {
+            return read_density_volume(path);
+        }
         input.open(std::string{path});
         return read_density_data(input);
     } catch (std::system_error const& e) {
@@ -57,3 +151,88 @@ auto read_density_data(std::string_view path) -> ads::lin::tensor<std::uint8_t,
         std::exit(1);
     }
 }
+
+auto is_density_volume(std::string_view path) -> bool {
+    auto input = std::ifstream{std::string{path}, std::ios::binary};
+    char magic[sizeof(volume_magic)] = {};
+    input.read(magic, sizeof(magic));
+    return input && std::memcmp(magic, volume_magic, sizeof(magic)) == 0;
+}
+
+auto read_density_volume(std::string_view path) -> ads::lin::tensor<std::uint8_t, 3> {
+    using byte = std::uint8_t;
+    auto const file = ads::mapped_file{std::string{path}};
+    auto const header = volume_header_of(file, path);
+
+    auto const nx = static_cast<int>(header.dims[0]);
+    auto const ny = static_cast<int>(header.dims[1]);
+    auto const nz = static_cast<int>(header.dims[2]);
+
+    auto const* voxels = reinterpret_cast<byte const*>(file.data() + header.data_offset);
+    auto data = ads::lin::tensor<byte, 3>{{nx, ny, nz}};
+
+    for (int iz = 0; iz < nz; ++iz) {
+        for (int iy = 0; iy < ny; ++iy) {
+            auto const* row = voxels + (static_cast<std::size_t>(iz) * ny + iy) * nx;
+            for (int ix = 0; ix < nx; ++ix) {
+                data(ix, iy, iz) = row[ix];
+            }
+        }
+    }
+    return data;
+}
+
+auto write_density_volume(ads::lin::tensor<std::uint8_t, 3> const& data,
+                          head_data::point_type const& spacing, std::string_view path) -> void {
+    using byte = std::uint8_t;
+    auto const nx = data.size(0);
+    auto const ny = data.size(1);
+    auto const nz = data.size(2);
+
+    auto header = volume_header{};
+    std::memcpy(header.magic, volume_magic, sizeof(volume_magic));
+    header.version = volume_version;
+    header.dtype = dtype_uint8;
+    header.dims[0] = static_cast<std::uint32_t>(nx);
+    header.dims[1] = static_cast<std::uint32_t>(ny);
+    header.dims[2] = static_cast<std::uint32_t>(nz);
+    std::copy(begin(spacing), end(spacing), header.spacing);
+    header.data_offset = sizeof(header);
+
+    auto output = std::ofstream{std::string{path}, std::ios::binary};
+    output.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+    output.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    auto row = std::string(static_cast<std::size_t>(nx), '\0');
+    for (int iz = 0; iz < nz; ++iz) {
+        for (int iy = 0; iy < ny; ++iy) {
+            for (int ix = 0; ix < nx; ++ix) {
+                row[ix] = static_cast<char>(static_cast<byte>(data(ix, iy, iz)));
+            }
+            output.write(row.data(), static_cast<std::streamsize>(row.size()));
+        }
+    }
+}
+
+auto load_head_data(std::string_view path) -> head_data {
+    if (!is_density_volume(path)) {
+        return head_data{read_density_data(path)};
+    }
+    try {
+        auto file = std::make_shared<ads::mapped_file const>(std::string{path});
+        auto const header = volume_header_of(*file, path);
+
+        auto const* voxels =
+            reinterpret_cast<std::uint8_t const*>(file->data() + header.data_offset);
+        auto const dims = head_data::dims_type{static_cast<int>(header.dims[0]),
+                                               static_cast<int>(header.dims[1]),
+                                               static_cast<int>(header.dims[2])};
+        auto const spacing =
+            head_data::point_type{header.spacing[0], header.spacing[1], header.spacing[2]};
+
+        return head_data{std::move(file), voxels, dims, spacing};
+    } catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::exit(1);
+    }
+}
@@ -6,10 +6,11 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <iosfwd>
+#include <memory>
 #include <string_view>
-#include <utility>
 
 #include "ads/lin/tensor/tensor.hpp"
 
@@ -18,6 +19,7 @@ public:
     using byte = std::uint8_t;
     using density_data = ads::lin::tensor<byte, 3>;
     using point_type = std::array<double, 3>;
+    using dims_type = std::array<int, 3>;
 
 private:
     enum class material { air, tissue, bone };
@@ -25,23 +27,45 @@ private:
     static constexpr std::array<double, 3> eps_vals = {1.0, 45.8, 16.6};
     static constexpr std::array<double, 3> mu_vals = {1.0, 1.0, 1.0};
 
-    density_data density_map_;
+    // Voxels with x index varying fastest, owned or in a mapped volume file
+    // kept alive by storage_
+    std::shared_ptr<void const> storage_;
+    byte const* voxels_ = nullptr;
+    dims_type dims_ = {};
+    point_type scale_ = {};  // voxels per unit length of the domain
 
 public:
-    explicit head_data(density_data data)
-    : density_map_{std::move(data)} { }
+    // Voxels stretched to fill the domain
+    explicit head_data(density_data const& data);
+
+    // Voxels of given size, placed at the origin of the domain with the
+    // longest side of the volume spanning it. If any of the sizes is not
+    // positive, voxels are stretched to fill the domain.
+    head_data(std::shared_ptr<void const> storage, byte const* voxels, dims_type dims,
+              point_type spacing);
 
     auto eps(point_type x) const -> double { return eps_vals[index_at(x)]; }
 
     auto mu(point_type x) const -> double { return mu_vals[index_at(x)]; }
 
+    // Index of the material at x, to be used with eps_of and mu_of when
+    // material values are precomputed
+    auto material_at(point_type x) const noexcept -> int { return index_at(x); }
+
+    static auto eps_of(int material) noexcept -> double { return eps_vals[material]; }
+
+    static auto mu_of(int material) noexcept -> double { return mu_vals[material]; }
+
 private:
     auto density(point_type x) const -> byte {
-        const auto ix = discretize(x[0], density_map_.size(0));
-        const auto iy = discretize(x[1], density_map_.size(1));
-        const auto iz = discretize(x[2], density_map_.size(2));
+        const auto ix = discretize(x[0], dims_[0], scale_[0]);
+        const auto iy = discretize(x[1], dims_[1], scale_[1]);
+        const auto iz = discretize(x[2], dims_[2], scale_[2]);
 
-        return density_map_(ix, iy, iz);
+        if (ix == dims_[0] || iy == dims_[1] || iz == dims_[2]) {
+            return 0;  // outside of the scanned volume
+        }
+        return voxels_[(static_cast<std::size_t>(iz) * dims_[1] + iy) * dims_[0] + ix];
     }
 
     auto as_index(material m) const noexcept -> int { return static_cast<int>(m); }
@@ -52,8 +76,11 @@ private:
         return as_index(mat);
     }
 
-    static auto discretize(double t, int n) noexcept -> int {
-        return std::min(static_cast<int>(t * n), n - 1);
+    // Voxel index of coordinate t, or n if t lies past the last voxel. The far
+    // end of the last voxel still belongs to it.
+    static auto discretize(double t, int n, double scale) noexcept -> int {
+        const auto s = t * scale;
+        return s <= n ? std::min(static_cast<int>(s), n - 1) : n;
     }
 
     auto as_material(byte n) const noexcept -> material {
@@ -69,6 +96,22 @@ private:
 
 auto read_density_data(std::istream& input) -> ads::lin::tensor<std::uint8_t, 3>;
 
+// Reads density data in either text or binary volume format, detected by
+// the file header
 auto read_density_data(std::string_view path) -> ads::lin::tensor<std::uint8_t, 3>;
 
+// Binary volume format - a 64 byte header (see head_data.cpp) with dimensions,
+// voxel spacing and voxel type, followed by raw voxel values with x index
+// varying fastest. Spacing 0 means unknown.
+auto is_density_volume(std::string_view path) -> bool;
+
+auto read_density_volume(std::string_view path) -> ads::lin::tensor<std::uint8_t, 3>;
+
+auto write_density_volume(ads::lin::tensor<std::uint8_t, 3> const& data,
+                          head_data::point_type const& spacing, std::string_view path) -> void;
+
+// Head data from a file in either format. Voxels of binary volumes are read
+// directly from the memory-mapped file, placed according to its spacing.
+auto load_head_data(std::string_view path) -> head_data;
+
 #endif  // MAXWELL_HEAD_DATA_HPP
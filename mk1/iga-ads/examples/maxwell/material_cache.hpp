@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef MAXWELL_MATERIAL_CACHE_HPP
+#define MAXWELL_MATERIAL_CACHE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "head_data.hpp"
+#include "spaces.hpp"
+
+// Material of the head model at each quadrature point of a space. Voxel
+// lookups are performed once, after which material coefficients are read
+// from a table indexed by element and quadrature point. Material indices
+// are stored as bytes, so the cache is small compared to the solution.
+class material_cache {
+public:
+    using index_type = std::array<int, 3>;
+
+private:
+    std::vector<std::uint8_t> materials_;
+    index_type elems_ = {};
+    index_type quad_ = {};
+
+public:
+    material_cache() = default;
+
+    material_cache(space const& V, head_data const& data)
+    : elems_{V.x.basis.elements, V.y.basis.elements, V.z.basis.elements}
+    , quad_{V.x.basis.quad_order, V.y.basis.quad_order, V.z.basis.quad_order} {
+        auto const [ex, ey, ez] = elems_;
+        auto const [qx, qy, qz] = quad_;
+        materials_.resize(std::size_t{1} * ex * ey * ez * qx * qy * qz);
+
+        for (int ix = 0; ix < ex; ++ix) {
+            for (int iy = 0; iy < ey; ++iy) {
+                for (int iz = 0; iz < ez; ++iz) {
+                    for (int jx = 0; jx < qx; ++jx) {
+                        for (int jy = 0; jy < qy; ++jy) {
+                            for (int jz = 0; jz < qz; ++jz) {
+                                auto const x = head_data::point_type{V.x.basis.x[ix][jx],
+                                                                     V.y.basis.x[iy][jy],
+                                                                     V.z.basis.x[iz][jz]};
+                                auto const m = data.material_at(x);
+                                materials_[offset({ix, iy, iz}, {jx, jy, jz})] =
+                                    static_cast<std::uint8_t>(m);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    auto material(index_type e, index_type q) const -> int { return materials_[offset(e, q)]; }
+
+    auto eps(index_type e, index_type q) const -> double {
+        return head_data::eps_of(material(e, q));
+    }
+
+    auto mu(index_type e, index_type q) const -> double { return head_data::mu_of(material(e, q)); }
+
+private:
+    auto offset(index_type e, index_type q) const -> std::size_t {
+        auto const el = (std::size_t{1} * e[0] * elems_[1] + e[1]) * elems_[2] + e[2];
+        auto const qi = (q[0] * quad_[1] + q[1]) * quad_[2] + q[2];
+        return el * quad_[0] * quad_[1] * quad_[2] + qi;
+    }
+};
+
+#endif  // MAXWELL_MATERIAL_CACHE_HPP
@@ -4,68 +4,18 @@
 #ifndef MAXWELL_MAXWELL_ADS_HPP
 #define MAXWELL_MAXWELL_ADS_HPP
 
-#include <cassert>
 #include <string_view>
 #include <utility>
 
+#include "../common/line_solver.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
 #include "maxwell_base.hpp"
 #include "maxwell_head_problem.hpp"
+#include "material_cache.hpp"
 #include "spaces.hpp"
 #include "state.hpp"
 
-class solver_phase {
-private:
-    using matrix = ads::lin::band_matrix;
-    using context = ads::lin::solver_ctx;
-
-    struct entry {
-        matrix mat;
-        context ctx;
-
-        entry()
-        : ctx{mat} { }
-
-        explicit entry(matrix mat)
-        : mat{std::move(mat)}
-        , ctx{this->mat} { }
-    };
-
-    using entry_table = ads::lin::tensor<entry, 2>;
-
-    entry_table entries_;
-
-public:
-    solver_phase(int n, int m)
-    : entries_{{n, m}} { }
-
-    auto set_matrix(int i, int j, matrix mat) -> void {
-        assert(i < entries_.size(0));
-        assert(j < entries_.size(1));
-
-        auto e = entry{std::move(mat)};
-        ads::lin::factorize(e.mat, e.ctx);
-
-        entries_(i, j) = std::move(e);
-    }
-
-    template <typename Rhs>
-    auto operator()(Rhs& rhs) -> void {
-        auto* data = rhs.data();
-        auto const rhs_size = rhs.size(0);
-
-        auto offset = 0;
-        for (int j = 0; j < entries_.size(1); ++j) {
-            for (int i = 0; i < entries_.size(0); ++i) {
-                auto& entry = entries_(i, j);
-                solve_with_factorized(entry.mat, data + offset, entry.ctx, 1);
-                offset += rhs_size;
-            }
-        }
-    }
-};
-
 class maxwell_ads : public maxwell_base {
 private:
     using Base = maxwell_base;
@@ -74,12 +24,14 @@ private:
     space V;
     space_set U;
 
-    state prev, half, now;
+    state prev, now;
+    step_workspace work{{0, 0, 0}};
 
     ads::lin::tensor<double, 3> stiffness_coeffs;
-    solver_phase Bx, By, Bz;
+    ads::line_solver Bx, By, Bz;
 
     Problem problem;
+    material_cache materials;
 
     ads::output_manager<3> output;
 
@@ -89,12 +41,11 @@ public:
     , V{x, y, z}
     , U{V, V, V, V, V, V}
     , prev{vector_shape(V)}
-    , half{vector_shape(V)}
     , now{vector_shape(V)}
     , stiffness_coeffs{vector_shape(V)}
-    , Bx{V.y.dofs(), V.z.dofs()}
-    , By{V.z.dofs(), V.y.dofs()}
-    , Bz{V.x.dofs(), V.y.dofs()}
+    , Bx{V.y.dofs(), V.z.dofs(), executor}
+    , By{V.z.dofs(), V.y.dofs(), executor}
+    , Bz{V.x.dofs(), V.y.dofs(), executor}
     , problem{data_file}
     , output{V.x.B, V.y.B, V.z.B, 50} { }
 
@@ -139,33 +90,30 @@ private:
     }
 
     template <typename CoeffFun>
-    auto fill_solver_phase(solver_phase& phase, ads::dimension const& special_dim,
-                           ads::dimension const& dim2, ads::dimension const& dim3, CoeffFun&& coeff)
-        -> void {
-        for (int i = 0; i < dim2.dofs(); ++i) {
-            for (int j = 0; j < dim3.dofs(); ++j) {
-                auto M = ads::lin::band_matrix{special_dim.p, special_dim.p, special_dim.dofs()};
-
-                auto const form = [i, j, &coeff](auto u, auto v, auto dof) {
-                    auto const h = coeff(dof, i, j);
-                    return u.val * v.val + h * u.dx * v.dx;
-                };
-                form_matrix(M, special_dim.basis, form);
-
-                fix_dof(0, special_dim, M);
-                fix_dof(special_dim.dofs() - 1, special_dim, M);
-
-                phase.set_matrix(i, j, M);
-            }
-        }
+    auto fill_solver_phase(ads::line_solver& phase, ads::dimension const& special_dim,
+                           CoeffFun&& coeff) -> void {
+        phase.factorize_all([&](int i, int j) {
+            auto M = ads::lin::band_matrix{special_dim.p, special_dim.p, special_dim.dofs()};
+
+            auto const form = [i, j, &coeff](auto u, auto v, auto dof) {
+                auto const h = coeff(dof, i, j);
+                return u.val * v.val + h * u.dx * v.dx;
+            };
+            form_matrix(M, special_dim.basis, form);
+
+            fix_dof(0, special_dim, M);
+            fix_dof(special_dim.dofs() - 1, special_dim, M);
+
+            return M;
+        });
     }
 
     auto fill_solver_phases() -> void {
-        fill_solver_phase(Bx, V.x, V.y, V.z,
+        fill_solver_phase(Bx, V.x,
                           [this](int ix, int iy, int iz) { return stiffness_coeffs(ix, iy, iz); });
-        fill_solver_phase(By, V.y, V.z, V.x,
+        fill_solver_phase(By, V.y,
                           [this](int iy, int iz, int ix) { return stiffness_coeffs(ix, iy, iz); });
-        fill_solver_phase(Bz, V.z, V.x, V.y,
+        fill_solver_phase(Bz, V.z,
                           [this](int iz, int ix, int iy) { return stiffness_coeffs(ix, iy, iz); });
     }
 
@@ -180,6 +128,8 @@ private:
     }
 
     void before() override {
+        work = make_workspace(V);
+        materials = material_cache{V, problem.data()};
         prepare_matrices();
         set_init_state(now, U, problem);
         after_step(-1, -steps.dt);
@@ -205,16 +155,19 @@ private:
 
     void step(int /*iter*/, double /*t*/) override {
         const auto tau = steps.dt;
-        const auto a = [this, tau](auto x) { return tau / (2 * problem.eps(x)); };
-        const auto b = [this, tau](auto x) { return tau * tau / (4 * problem.eps(x)); };
-        const auto c = [this, tau](auto x) { return tau / (2 * problem.mu(x)); };
-
-        const auto shape = vector_shape(V);
+        const auto a = [this, tau](auto e, auto q, auto) {
+            return tau / (2 * materials.eps(e, q));
+        };
+        const auto b = [this, tau](auto e, auto q, auto) {
+            return tau * tau / (4 * materials.eps(e, q));
+        };
+        const auto c = [this, tau](auto e, auto q, auto) {
+            return tau / (2 * materials.mu(e, q));
+        };
 
         // Buffer large enough for all the RHS
-        auto buffer = vector_type{shape};
-
-        auto mid = state{shape};
+        auto& buffer = work.buffer;
+        auto& mid = work.mid;
 
         // First substep
         substep1_fill_E(mid, prev, U, a, b);
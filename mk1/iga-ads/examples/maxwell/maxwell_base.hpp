@@ -5,8 +5,10 @@
 #define MAXWELL_MAXWELL_BASE_HPP
 
 #include <array>
+#include <cassert>
 #include <cmath>
 #include <string_view>
+#include <type_traits>
 
 #include <lyra/lyra.hpp>
 
@@ -70,12 +72,45 @@ class maxwell_base : public ads::simulation_3d {
 private:
     using Base = ads::simulation_3d;
 
+protected:
     ads::galois_executor executor{4};
 
-protected:
     explicit maxwell_base(ads::config_3d const& config)
     : Base{config} { }
 
+    // Workspace for the time steps, zeroed in parallel over the elements of V
+    // with the same loop as the right-hand side assembly. Each element writes
+    // the dofs it owns - from its first dof up to the first dof of the next
+    // element - so that pages are first touched by the threads processing
+    // these elements in the time steps.
+    auto make_workspace(space const& V) -> step_workspace {
+        auto work = step_workspace{vector_shape(V)};
+        auto const fields = work.fields();
+        for (auto* f : fields) {
+            release_pages(*f);
+        }
+
+        auto const owned = [](int e, ads::dimension const& d) {
+            auto const end = e + 1 < d.basis.elements ? d.basis.first_dof(e + 1) : d.dofs();
+            return std::array<int, 2>{d.basis.first_dof(e), end};
+        };
+        executor.for_each(elements(V.x, V.y, V.z), [&](auto const e) {
+            auto const [x0, x1] = owned(e[0], V.x);
+            auto const [y0, y1] = owned(e[1], V.y);
+            auto const [z0, z1] = owned(e[2], V.z);
+            for (auto* f : fields) {
+                for (int iz = z0; iz < z1; ++iz) {
+                    for (int iy = y0; iy < y1; ++iy) {
+                        for (int ix = x0; ix < x1; ++ix) {
+                            (*f)(ix, iy, iz) = 0;
+                        }
+                    }
+                }
+            }
+        });
+        return work;
+    }
+
     auto dof_support(index_type dof, space const& V) const -> std::array<interval, 3> {
         auto const [ix, iy, iz] = dof;
         using ::dof_support;
@@ -92,17 +127,19 @@ protected:
         constexpr int Y = 1;
         constexpr int Z = 2;
 
-        compute_rhs(rhs.E1, prev, prev, U, U.E1, [=](auto E, auto, auto H, auto v, auto x) {
-            return (E[X].val + a(x) * (H[Z].dy - H[Y].dz)) * v.val + b(x) * E[Y].dx * v.dy;
-        });
-
-        compute_rhs(rhs.E2, prev, prev, U, U.E2, [=](auto E, auto, auto H, auto v, auto x) {
-            return (E[Y].val + a(x) * (H[X].dz - H[Z].dx)) * v.val + b(x) * E[Z].dy * v.dz;
-        });
+        auto const coeffs = [=](auto e, auto q, auto x) {
+            return std::array<double, 2>{coeff_at(a, e, q, x), coeff_at(b, e, q, x)};
+        };
 
-        compute_rhs(rhs.E3, prev, prev, U, U.E3, [=](auto E, auto, auto H, auto v, auto x) {
-            return (E[Z].val + a(x) * (H[Y].dx - H[X].dy)) * v.val + b(x) * E[X].dz * v.dx;
-        });
+        compute_rhs(rhs.E1, rhs.E2, rhs.E3, prev, prev, U, coeffs,
+                    [](auto E, auto, auto H, auto v, auto k) {
+                        auto const [a, b] = k;
+                        return std::array<double, 3>{
+                            (E[X].val + a * (H[Z].dy - H[Y].dz)) * v.val + b * E[Y].dx * v.dy,
+                            (E[Y].val + a * (H[X].dz - H[Z].dx)) * v.val + b * E[Z].dy * v.dz,
+                            (E[Z].val + a * (H[Y].dx - H[X].dy)) * v.val + b * E[X].dz * v.dx,
+                        };
+                    });
 
         zero_sides("yz", rhs.E1, U.E1);
         zero_sides("xz", rhs.E2, U.E2);
@@ -115,17 +152,16 @@ protected:
         constexpr int Y = 1;
         constexpr int Z = 2;
 
-        compute_rhs(rhs.H1, prev, mid, U, U.H1, [=](auto E, auto En, auto H, auto v, auto x) {
-            return (H[X].val - c(x) * (E[Z].dy - En[Y].dz)) * v.val;
-        });
-
-        compute_rhs(rhs.H2, prev, mid, U, U.H2, [=](auto E, auto En, auto H, auto v, auto x) {
-            return (H[Y].val - c(x) * (E[X].dz - En[Z].dx)) * v.val;
-        });
+        auto const coeffs = [=](auto e, auto q, auto x) { return coeff_at(c, e, q, x); };
 
-        compute_rhs(rhs.H3, prev, mid, U, U.H3, [=](auto E, auto En, auto H, auto v, auto x) {
-            return (H[Z].val - c(x) * (E[Y].dx - En[X].dy)) * v.val;
-        });
+        compute_rhs(rhs.H1, rhs.H2, rhs.H3, prev, mid, U, coeffs,
+                    [](auto E, auto En, auto H, auto v, auto c) {
+                        return std::array<double, 3>{
+                            (H[X].val - c * (E[Z].dy - En[Y].dz)) * v.val,
+                            (H[Y].val - c * (E[X].dz - En[Z].dx)) * v.val,
+                            (H[Z].val - c * (E[Y].dx - En[X].dy)) * v.val,
+                        };
+                    });
 
         zero_sides("x", rhs.H1, U.H1);
         zero_sides("y", rhs.H2, U.H2);
@@ -138,17 +174,19 @@ protected:
         constexpr int Y = 1;
         constexpr int Z = 2;
 
-        compute_rhs(rhs.E1, prev, prev, U, U.E1, [=](auto E, auto, auto H, auto v, auto x) {
-            return (E[X].val + a(x) * (H[Z].dy - H[Y].dz)) * v.val + b(x) * E[Z].dx * v.dz;
-        });
+        auto const coeffs = [=](auto e, auto q, auto x) {
+            return std::array<double, 2>{coeff_at(a, e, q, x), coeff_at(b, e, q, x)};
+        };
 
-        compute_rhs(rhs.E2, prev, prev, U, U.E2, [=](auto E, auto, auto H, auto v, auto x) {
-            return (E[Y].val + a(x) * (H[X].dz - H[Z].dx)) * v.val + b(x) * E[X].dy * v.dx;
-        });
-
-        compute_rhs(rhs.E3, prev, prev, U, U.E3, [=](auto E, auto, auto H, auto v, auto x) {
-            return (E[Z].val + a(x) * (H[Y].dx - H[X].dy)) * v.val + b(x) * E[Y].dz * v.dy;
-        });
+        compute_rhs(rhs.E1, rhs.E2, rhs.E3, prev, prev, U, coeffs,
+                    [](auto E, auto, auto H, auto v, auto k) {
+                        auto const [a, b] = k;
+                        return std::array<double, 3>{
+                            (E[X].val + a * (H[Z].dy - H[Y].dz)) * v.val + b * E[Z].dx * v.dz,
+                            (E[Y].val + a * (H[X].dz - H[Z].dx)) * v.val + b * E[X].dy * v.dx,
+                            (E[Z].val + a * (H[Y].dx - H[X].dy)) * v.val + b * E[Y].dz * v.dy,
+                        };
+                    });
 
         zero_sides("yz", rhs.E1, U.E1);
         zero_sides("xz", rhs.E2, U.E2);
@@ -161,66 +199,100 @@ protected:
         constexpr int Y = 1;
         constexpr int Z = 2;
 
-        compute_rhs(rhs.H1, prev, mid, U, U.H1, [=](auto E, auto En, auto H, auto v, auto x) {
-            return (H[X].val - c(x) * (En[Z].dy - E[Y].dz)) * v.val;
-        });
+        auto const coeffs = [=](auto e, auto q, auto x) { return coeff_at(c, e, q, x); };
 
-        compute_rhs(rhs.H2, prev, mid, U, U.H2, [=](auto E, auto En, auto H, auto v, auto x) {
-            return (H[Y].val - c(x) * (En[X].dz - E[Z].dx)) * v.val;
-        });
-
-        compute_rhs(rhs.H3, prev, mid, U, U.H3, [=](auto E, auto En, auto H, auto v, auto x) {
-            return (H[Z].val - c(x) * (En[Y].dx - E[X].dy)) * v.val;
-        });
+        compute_rhs(rhs.H1, rhs.H2, rhs.H3, prev, mid, U, coeffs,
+                    [](auto E, auto En, auto H, auto v, auto c) {
+                        return std::array<double, 3>{
+                            (H[X].val - c * (En[Z].dy - E[Y].dz)) * v.val,
+                            (H[Y].val - c * (En[X].dz - E[Z].dx)) * v.val,
+                            (H[Z].val - c * (En[Y].dx - E[X].dy)) * v.val,
+                        };
+                    });
 
         zero_sides("x", rhs.H1, U.H1);
         zero_sides("y", rhs.H2, U.H2);
         zero_sides("z", rhs.H3, U.H3);
     }
 
-    template <typename RHS, typename Form>
-    void compute_rhs(RHS& rhs, state const& prev, state const& mid, space_set const& U,
-                     space const& V, Form&& form) {
-        zero(rhs);
+    // Coefficients are given either as functions of the point, or of the
+    // element, quadrature point and the point, which allows using values
+    // precomputed at quadrature points
+    template <typename F>
+    static auto coeff_at(F const& f, index_type e, index_type q, point_type x) -> double {
+        if constexpr (std::is_invocable_v<F const&, index_type, index_type, point_type>) {
+            return f(e, q, x);
+        } else {
+            return f(x);
+        }
+    }
+
+    // Assembles right-hand sides of three components in a single pass over the
+    // elements. All the components of E and H, as well as the test functions,
+    // need to use the same space, so that the basis functions are evaluated
+    // only once at each quadrature point. Material coefficients are computed
+    // once per quadrature point by coeffs(e, q, x), and passed to form(E, E_n,
+    // H, v, k), which returns contributions to all three right-hand sides.
+    template <typename RHS, typename Coeffs, typename Form>
+    void compute_rhs(RHS& rhs1, RHS& rhs2, RHS& rhs3, state const& prev, state const& mid,
+                     space_set const& U, Coeffs&& coeffs, Form&& form) {
+        auto const& V = U.E1;
+        assert(same_space(U, V));
+
+        zero(rhs1);
+        zero(rhs2);
+        zero(rhs3);
         auto const shape = ::local_shape(V);
+        bool const same_state = &prev == &mid;
 
         executor.for_each(elements(V.x, V.y, V.z), [&](auto const e) {
-            auto loc = vector_type{shape};
+            auto loc1 = vector_type{shape};
+            auto loc2 = vector_type{shape};
+            auto loc3 = vector_type{shape};
 
             auto const J = jacobian(e, V.x, V.y, V.z);
             for (auto const q : quad_points(V.x, V.y, V.z)) {
                 auto const W = weight(q, V.x, V.y, V.z);
                 auto const x = point(e, q, V.x, V.y, V.z);
+                auto const k = coeffs(e, q, x);
 
-                using vec = std::array<value_type, 3>;
-
-                auto const E1 = eval(prev.E1, e, q, U.E1.x, U.E1.y, U.E1.z);
-                auto const E2 = eval(prev.E2, e, q, U.E2.x, U.E2.y, U.E2.z);
-                auto const E3 = eval(prev.E3, e, q, U.E3.x, U.E3.y, U.E3.z);
-                auto const E = vec{E1, E2, E3};
-
-                auto const E1_n = eval(mid.E1, e, q, U.E1.x, U.E1.y, U.E1.z);
-                auto const E2_n = eval(mid.E2, e, q, U.E2.x, U.E2.y, U.E2.z);
-                auto const E3_n = eval(mid.E3, e, q, U.E3.x, U.E3.y, U.E3.z);
-                auto const E_n = vec{E1_n, E2_n, E3_n};
-
-                auto const H1 = eval(prev.H1, e, q, U.H1.x, U.H1.y, U.H1.z);
-                auto const H2 = eval(prev.H2, e, q, U.H2.x, U.H2.y, U.H2.z);
-                auto const H3 = eval(prev.H3, e, q, U.H3.x, U.H3.y, U.H3.z);
-                auto const H = vec{H1, H2, H3};
+                auto const E = eval_fields(e, q, V, prev.E1, prev.E2, prev.E3);
+                auto const E_n = same_state ? E : eval_fields(e, q, V, mid.E1, mid.E2, mid.E3);
+                auto const H = eval_fields(e, q, V, prev.H1, prev.H2, prev.H3);
 
                 for (auto const a : dofs_on_element(e, V.x, V.y, V.z)) {
                     auto const aa = dof_global_to_local(e, a, V.x, V.y, V.z);
                     auto const v = eval_basis(e, q, a, V.x, V.y, V.z);
 
-                    auto const val = form(E, E_n, H, v, x);
-                    loc(aa[0], aa[1], aa[2]) += val * W * J;
+                    auto const [val1, val2, val3] = form(E, E_n, H, v, k);
+                    loc1(aa[0], aa[1], aa[2]) += val1 * W * J;
+                    loc2(aa[0], aa[1], aa[2]) += val2 * W * J;
+                    loc3(aa[0], aa[1], aa[2]) += val3 * W * J;
                 }
             }
-            executor.synchronized([&] { update_global_rhs(rhs, loc, e, V.x, V.y, V.z); });
+            executor.synchronized([&] {
+                update_global_rhs(rhs1, loc1, e, V.x, V.y, V.z);
+                update_global_rhs(rhs2, loc2, e, V.x, V.y, V.z);
+                update_global_rhs(rhs3, loc3, e, V.x, V.y, V.z);
+            });
         });
     }
 
+    // Values of three functions from space V at a quadrature point, computed
+    // with a single pass over the basis functions
+    auto eval_fields(index_type e, index_type q, space const& V, vector_type const& u1,
+                     vector_type const& u2, vector_type const& u3) const
+        -> std::array<value_type, 3> {
+        auto vals = std::array<value_type, 3>{};
+        for (auto const b : dofs_on_element(e, V.x, V.y, V.z)) {
+            auto const B = eval_basis(e, q, b, V.x, V.y, V.z);
+            vals[0] += u1(b[0], b[1], b[2]) * B;
+            vals[1] += u2(b[0], b[1], b[2]) * B;
+            vals[2] += u3(b[0], b[1], b[2]) * B;
+        }
+        return vals;
+    }
+
     template <typename Problem>
     auto compute_norms(state const& s, space_set const& U, Problem const& problem, double t) const
         -> maxwell_result_info {
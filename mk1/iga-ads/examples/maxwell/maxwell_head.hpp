@@ -4,15 +4,22 @@
 #ifndef MAXWELL_MAXWELL_HEAD_HPP
 #define MAXWELL_MAXWELL_HEAD_HPP
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <utility>
+#include <vector>
 
+#include <boost/range/counting_range.hpp>
+
+#include "../common/mumps_factorization.hpp"
 #include "ads/form_matrix.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
 #include "ads/solver/mumps.hpp"
 #include "maxwell_base.hpp"
 #include "maxwell_head_problem.hpp"
+#include "material_cache.hpp"
 #include "spaces.hpp"
 #include "state.hpp"
 
@@ -24,13 +31,18 @@ private:
     space V;
     space_set U;
 
-    ads::mumps::problem E1_1, E2_1, E3_1;
-    ads::mumps::problem E1_2, E2_2, E3_2;
+    // Matrices do not change in time, so they are factorized only once. The
+    // factorizations keep their own copies of the matrices, so the assembled
+    // problems are dropped and solves are checked against the time step.
+    ads::mumps::factorization E1_1_lu, E2_1_lu, E3_1_lu;
+    ads::mumps::factorization E1_2_lu, E2_2_lu, E3_2_lu;
+    std::uint64_t lu_key = 0;
 
-    state prev, half, now;
+    state prev, now;
+    step_workspace work{{0, 0, 0}};
 
     Problem problem;
-    ads::mumps::solver solver;
+    material_cache materials;
 
     bool avg_material_data;
 
@@ -41,80 +53,224 @@ public:
     : Base{config}
     , V{x, y, z}
     , U{V, V, V, V, V, V}
-    , E1_1{nullptr, V.dofs()}
-    , E2_1{nullptr, V.dofs()}
-    , E3_1{nullptr, V.dofs()}
-    , E1_2{nullptr, V.dofs()}
-    , E2_2{nullptr, V.dofs()}
-    , E3_2{nullptr, V.dofs()}
     , prev{vector_shape(V)}
-    , half{vector_shape(V)}
     , now{vector_shape(V)}
     , problem{data_file}
     , avg_material_data{avg_material_data}
     , output{V.x.B, V.y.B, V.z.B, 50} { }
 
 private:
+    struct matrix_entry {
+        int row;
+        int col;
+        double value;
+    };
+
+    // Elements are processed in parallel in chunks, each of which collects the
+    // nonzero entries in its own buffer. Buffers are merged into A afterwards,
+    // so no locking is necessary.
     template <typename BC>
     void matrix(ads::mumps::problem& A, double tau, double cx, double cy, double cz, BC&& bc) {
-        auto shape_loc = local_matrix_shape(V);
-
+        auto elems = std::vector<index_type>{};
         for (auto e : elements(V.x, V.y, V.z)) {
-            auto J = jacobian(e, V.x, V.y, V.z);
-            using buffer_type = ads::lin::tensor<double, 6>;
-            auto loc = buffer_type{shape_loc};
+            elems.push_back(e);
+        }
 
-            for (auto q : quad_points(V.x, V.y, V.z)) {
-                auto W = weight(q, V.x, V.y, V.z);
-                auto x = point(e, q, V.x, V.y, V.z);
+        constexpr int chunk_size = 64;
+        int const chunk_count = (static_cast<int>(elems.size()) + chunk_size - 1) / chunk_size;
+        auto buffers = std::vector<std::vector<matrix_entry>>(chunk_count);
 
-                for (auto i : dofs_on_element(e, V.x, V.y, V.z)) {
-                    auto il = dof_global_to_local(e, i, V.x, V.y, V.z);
-                    auto v = eval_basis(e, q, i, V.x, V.y, V.z);
+        executor.for_each(boost::counting_range(0, chunk_count), [&](int chunk) {
+            auto& buffer = buffers[chunk];
+            int const begin = chunk * chunk_size;
+            int const end = std::min(begin + chunk_size, static_cast<int>(elems.size()));
 
-                    double a = stiffness_coeff(tau, x, i);
+            for (int k = begin; k < end; ++k) {
+                auto const e = elems[k];
+                auto const loc = element_matrix(e, tau, cx, cy, cz);
 
+                for (auto i : dofs_on_element(e, V.x, V.y, V.z)) {
+                    if (bc(i))
+                        continue;
+                    auto il = dof_global_to_local(e, i, V.x, V.y, V.z);
+                    int ii = linear_index(i, V.x, V.y, V.z) + 1;
                     for (auto j : dofs_on_element(e, V.x, V.y, V.z)) {
+                        if (bc(j))
+                            continue;
                         auto jl = dof_global_to_local(e, j, V.x, V.y, V.z);
-                        auto u = eval_basis(e, q, j, V.x, V.y, V.z);
+                        int jj = linear_index(j, V.x, V.y, V.z) + 1;
 
-                        auto M = u.val * v.val;
-                        auto S = cx * u.dx * v.dx + cy * u.dy * v.dy + cz * u.dz * v.dz;
-                        auto form = M + a * S;
-                        loc(il[0], il[1], il[2], jl[0], jl[1], jl[2]) += form * W * J;
+                        auto val = loc(il[0], il[1], il[2], jl[0], jl[1], jl[2]);
+                        buffer.push_back({ii, jj, val});
                     }
                 }
             }
-            // Update global matrix
-            for (auto i : dofs_on_element(e, V.x, V.y, V.z)) {
-                if (bc(i))
-                    continue;
-                auto il = dof_global_to_local(e, i, V.x, V.y, V.z);
-                int ii = linear_index(i, V.x, V.y, V.z) + 1;
-                for (auto j : dofs_on_element(e, V.x, V.y, V.z)) {
-                    if (bc(j))
-                        continue;
-                    auto jl = dof_global_to_local(e, j, V.x, V.y, V.z);
-                    int jj = linear_index(j, V.x, V.y, V.z) + 1;
+        });
 
-                    auto val = loc(il[0], il[1], il[2], jl[0], jl[1], jl[2]);
-                    A.add(ii, jj, val);
-                }
+        for (auto const& buffer : buffers) {
+            for (auto const& entry : buffer) {
+                A.add(entry.row, entry.col, entry.value);
             }
         }
         apply_dirichlet_bc(A, bc);
     }
 
-    auto stiffness_coeff(double tau, point_type x, index_type test) const -> double {
-        point_type xx;
-        if (avg_material_data) {
-            auto const [rx, ry, rz] = dof_support(test, V);
-            xx = point_type{(rx.a + rx.b) / 2, (ry.a + ry.b) / 2, (rz.a + rz.b) / 2};
-        } else {
-            xx = x;
+    // Products of 1D basis functions (d = 0) or their derivatives (d = 1) on
+    // element e, multiplied by quadrature weights: T(q, a, b)
+    static auto weighted_products(ads::basis_data const& basis, ads::element_id e, int d)
+        -> ads::lin::tensor<double, 3> {
+        int const nq = basis.quad_order;
+        int const n = basis.last_dof(e) - basis.first_dof(e) + 1;
+        auto T = ads::lin::tensor<double, 3>{{nq, n, n}};
+
+        for (int q = 0; q < nq; ++q) {
+            auto const* B = basis.b[e][q][d];
+            for (int a = 0; a < n; ++a) {
+                for (int b = 0; b < n; ++b) {
+                    T(q, a, b) = basis.w[q] * B[a] * B[b];
+                }
+            }
+        }
+        return T;
+    }
+
+    // Element matrix of M + a S, where M is the mass matrix and S is the
+    // weighted stiffness cx u_x v_x + cy u_y v_y + cz u_z v_z.
+    //
+    // Both parts are products of 1D integrals, with the exception of the
+    // material coefficient a. Sum factorization is used to contract the
+    // quadrature points one axis at a time (z, then y, then x), which requires
+    // O(p^6 q) operations instead of O(p^6 q^3) needed by evaluating basis
+    // functions at every quadrature point.
+    auto element_matrix(index_type e, double tau, double cx, double cy, double cz) const
+        -> ads::lin::tensor<double, 6> {
+        int const qx = V.x.basis.quad_order;
+        int const qy = V.y.basis.quad_order;
+        int const qz = V.z.basis.quad_order;
+
+        auto const Mx = weighted_products(V.x.basis, e[0], 0);
+        auto const My = weighted_products(V.y.basis, e[1], 0);
+        auto const Mz = weighted_products(V.z.basis, e[2], 0);
+        auto const Dx = weighted_products(V.x.basis, e[0], 1);
+        auto const Dy = weighted_products(V.y.basis, e[1], 1);
+        auto const Dz = weighted_products(V.z.basis, e[2], 1);
+
+        int const nx = Mx.size(1);
+        int const ny = My.size(1);
+        int const nz = Mz.size(1);
+
+        // Material coefficient at quadrature points. With averaged material
+        // data it depends only on the test function, and is applied at the end.
+        auto coeff = ads::lin::tensor<double, 3>{{qx, qy, qz}};
+        for (auto q : quad_points(V.x, V.y, V.z)) {
+            coeff(q[0], q[1], q[2]) = avg_material_data ? 1.0 : material_coeff(tau, e, q);
+        }
+
+        // Contraction over z
+        auto TM = ads::lin::tensor<double, 4>{{qx, qy, nz, nz}};
+        auto TD = ads::lin::tensor<double, 4>{{qx, qy, nz, nz}};
+        for (int i = 0; i < qx; ++i) {
+            for (int j = 0; j < qy; ++j) {
+                for (int k = 0; k < qz; ++k) {
+                    auto const c = coeff(i, j, k);
+                    for (int a = 0; a < nz; ++a) {
+                        for (int b = 0; b < nz; ++b) {
+                            TM(i, j, a, b) += c * Mz(k, a, b);
+                            TD(i, j, a, b) += c * Dz(k, a, b);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Contraction over y: UM contains the x-derivative term, UD the y- and z-terms
+        auto UM = ads::lin::tensor<double, 5>{{qx, ny, ny, nz, nz}};
+        auto UD = ads::lin::tensor<double, 5>{{qx, ny, ny, nz, nz}};
+        for (int i = 0; i < qx; ++i) {
+            for (int j = 0; j < qy; ++j) {
+                for (int ay = 0; ay < ny; ++ay) {
+                    for (int by = 0; by < ny; ++by) {
+                        auto const m = My(j, ay, by);
+                        auto const d = Dy(j, ay, by);
+                        for (int az = 0; az < nz; ++az) {
+                            for (int bz = 0; bz < nz; ++bz) {
+                                auto const tm = TM(i, j, az, bz);
+                                auto const td = TD(i, j, az, bz);
+                                UM(i, ay, by, az, bz) += m * tm;
+                                UD(i, ay, by, az, bz) += cy * d * tm + cz * m * td;
+                            }
+                        }
+                    }
+                }
+            }
         }
-        double eps = problem.eps(xx);
-        double mu = problem.mu(xx);
+
+        // Contraction over x, together with the mass term
+        auto Mx1 = ads::lin::tensor<double, 2>{{nx, nx}};
+        auto My1 = ads::lin::tensor<double, 2>{{ny, ny}};
+        auto Mz1 = ads::lin::tensor<double, 2>{{nz, nz}};
+        sum_quad_points(Mx, Mx1);
+        sum_quad_points(My, My1);
+        sum_quad_points(Mz, Mz1);
+
+        auto const J = jacobian(e, V.x, V.y, V.z);
+        auto loc = ads::lin::tensor<double, 6>{local_matrix_shape(V)};
+
+        for (int ax = 0; ax < nx; ++ax) {
+            for (int ay = 0; ay < ny; ++ay) {
+                for (int az = 0; az < nz; ++az) {
+                    auto const a = avg_material_data ? test_coeff(tau, e, {ax, ay, az}) : 1.0;
+
+                    for (int bx = 0; bx < nx; ++bx) {
+                        for (int by = 0; by < ny; ++by) {
+                            for (int bz = 0; bz < nz; ++bz) {
+                                double S = 0;
+                                for (int i = 0; i < qx; ++i) {
+                                    S += cx * Dx(i, ax, bx) * UM(i, ay, by, az, bz)
+                                       + Mx(i, ax, bx) * UD(i, ay, by, az, bz);
+                                }
+                                auto const M = Mx1(ax, bx) * My1(ay, by) * Mz1(az, bz);
+                                loc(ax, ay, az, bx, by, bz) = (M + a * S) * J;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return loc;
+    }
+
+    static void sum_quad_points(ads::lin::tensor<double, 3> const& T,
+                                ads::lin::tensor<double, 2>& out) {
+        for (int q = 0; q < T.size(0); ++q) {
+            for (int a = 0; a < T.size(1); ++a) {
+                for (int b = 0; b < T.size(2); ++b) {
+                    out(a, b) += T(q, a, b);
+                }
+            }
+        }
+    }
+
+    // Coefficient of the stiffness term for test function with local index
+    // a on element e, using material data averaged over its support
+    auto test_coeff(double tau, index_type e, index_type a) const -> double {
+        auto const i = index_type{V.x.basis.first_dof(e[0]) + a[0],  //
+                                  V.y.basis.first_dof(e[1]) + a[1],  //
+                                  V.z.basis.first_dof(e[2]) + a[2]};
+        auto const [rx, ry, rz] = dof_support(i, V);
+        auto const xx = point_type{(rx.a + rx.b) / 2, (ry.a + ry.b) / 2, (rz.a + rz.b) / 2};
+        return material_coeff(tau, xx);
+    }
+
+    auto material_coeff(double tau, point_type x) const -> double {
+        double eps = problem.eps(x);
+        double mu = problem.mu(x);
+        return tau * tau / (4 * eps * mu);
+    }
+
+    auto material_coeff(double tau, index_type e, index_type q) const -> double {
+        double eps = materials.eps(e, q);
+        double mu = materials.mu(e, q);
         return tau * tau / (4 * eps * mu);
     }
 
@@ -135,24 +291,40 @@ private:
         factorize_matrices(V);
 
         auto tau = steps.dt;
+        lu_key = ads::mumps::matrix_key(tau);
 
         // E x n = 0
-        matrix(E1_1, tau, 0, 1, 0,
-               [this](auto i) { return is_boundary(i[1], V.y) || is_boundary(i[2], V.z); });
-        matrix(E2_1, tau, 0, 0, 1,
-               [this](auto i) { return is_boundary(i[0], V.x) || is_boundary(i[2], V.z); });
-        matrix(E3_1, tau, 1, 0, 0,
-               [this](auto i) { return is_boundary(i[0], V.x) || is_boundary(i[1], V.y); });
+        auto const bc1 = [this](auto i) {
+            return is_boundary(i[1], V.y) || is_boundary(i[2], V.z);
+        };
+        auto const bc2 = [this](auto i) {
+            return is_boundary(i[0], V.x) || is_boundary(i[2], V.z);
+        };
+        auto const bc3 = [this](auto i) {
+            return is_boundary(i[0], V.x) || is_boundary(i[1], V.y);
+        };
+
+        factorize_matrix(E1_1_lu, tau, 0, 1, 0, bc1);
+        factorize_matrix(E2_1_lu, tau, 0, 0, 1, bc2);
+        factorize_matrix(E3_1_lu, tau, 1, 0, 0, bc3);
+
+        factorize_matrix(E1_2_lu, tau, 0, 0, 1, bc1);
+        factorize_matrix(E2_2_lu, tau, 1, 0, 0, bc2);
+        factorize_matrix(E3_2_lu, tau, 0, 1, 0, bc3);
+    }
 
-        matrix(E1_2, tau, 0, 0, 1,
-               [this](auto i) { return is_boundary(i[1], V.y) || is_boundary(i[2], V.z); });
-        matrix(E2_2, tau, 1, 0, 0,
-               [this](auto i) { return is_boundary(i[0], V.x) || is_boundary(i[2], V.z); });
-        matrix(E3_2, tau, 0, 1, 0,
-               [this](auto i) { return is_boundary(i[0], V.x) || is_boundary(i[1], V.y); });
+    // Assembles the matrix in a problem that lives only until it is factorized
+    template <typename BC>
+    void factorize_matrix(ads::mumps::factorization& lu, double tau, double cx, double cy,
+                          double cz, BC&& bc) {
+        auto A = ads::mumps::problem{nullptr, V.dofs()};
+        matrix(A, tau, cx, cy, cz, bc);
+        lu.factorize(A, lu_key);
     }
 
     void before() override {
+        work = make_workspace(V);
+        materials = material_cache{V, problem.data()};
         prepare_matrices();
         set_init_state(now, U, problem);
         after_step(-1, -steps.dt);
@@ -164,25 +336,15 @@ private:
     }
 
     auto substep1_solve_E(state& rhs) -> void {
-        E1_1.rhs(rhs.E1.data());
-        solver.solve(E1_1);
-
-        E2_1.rhs(rhs.E2.data());
-        solver.solve(E2_1);
-
-        E3_1.rhs(rhs.E3.data());
-        solver.solve(E3_1);
+        E1_1_lu.solve(lu_key, rhs.E1.data());
+        E2_1_lu.solve(lu_key, rhs.E2.data());
+        E3_1_lu.solve(lu_key, rhs.E3.data());
     }
 
     auto substep2_solve_E(state& rhs) -> void {
-        E1_2.rhs(rhs.E1.data());
-        solver.solve(E1_2);
-
-        E2_2.rhs(rhs.E2.data());
-        solver.solve(E2_2);
-
-        E3_2.rhs(rhs.E3.data());
-        solver.solve(E3_2);
+        E1_2_lu.solve(lu_key, rhs.E1.data());
+        E2_2_lu.solve(lu_key, rhs.E2.data());
+        E3_2_lu.solve(lu_key, rhs.E3.data());
     }
 
     auto solve_H(state& rhs, vector_type& buffer) -> void {
@@ -193,16 +355,19 @@ private:
 
     void step(int /*iter*/, double /*t*/) override {
         const auto tau = steps.dt;
-        const auto a = [this, tau](auto x) { return tau / (2 * problem.eps(x)); };
-        const auto b = [this, tau](auto x) { return tau * tau / (4 * problem.eps(x)); };
-        const auto c = [this, tau](auto x) { return tau / (2 * problem.mu(x)); };
-
-        const auto shape = vector_shape(V);
+        const auto a = [this, tau](auto e, auto q, auto) {
+            return tau / (2 * materials.eps(e, q));
+        };
+        const auto b = [this, tau](auto e, auto q, auto) {
+            return tau * tau / (4 * materials.eps(e, q));
+        };
+        const auto c = [this, tau](auto e, auto q, auto) {
+            return tau / (2 * materials.mu(e, q));
+        };
 
         // Buffer large enough for all the RHS
-        auto buffer = vector_type{shape};
-
-        auto mid = state{shape};
+        auto& buffer = work.buffer;
+        auto& mid = work.mid;
 
         // First substep
         substep1_fill_E(mid, prev, U, a, b);
@@ -19,7 +19,7 @@ public:
     using point_type = head_data::point_type;
 
     explicit maxwell_head_problem(std::string_view data_path)
-    : data_{read_density_data(data_path)} { }
+    : data_{load_head_data(data_path)} { }
 
     auto init_E1() const { return init_state_.init_E1(); }
     auto init_E2() const { return init_state_.init_E2(); }
@@ -33,6 +33,8 @@ public:
 
     auto mu(point_type x) const -> double { return data_.mu(x); }
 
+    auto data() const noexcept -> head_data const& { return data_; }
+
     constexpr static value_type unknown{NAN, NAN, NAN, NAN};
 
     auto E1(point_type, double) const -> value_type { return unknown; }
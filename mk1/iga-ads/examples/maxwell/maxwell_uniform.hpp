@@ -23,7 +23,8 @@ private:
     space V;
     space_set U;
 
-    state prev, half, now;
+    state prev, now;
+    step_workspace work{{0, 0, 0}};
 
     ads::lin::band_matrix Bx, By, Bz;
     ads::lin::solver_ctx Bx_ctx, By_ctx, Bz_ctx;
@@ -38,7 +39,6 @@ public:
     , V{x, y, z}
     , U{V, V, V, V, V, V}
     , prev{vector_shape(V)}
-    , half{vector_shape(V)}
     , now{vector_shape(V)}
     , Bx{V.x.p, V.x.p, V.x.dofs()}
     , By{V.y.p, V.y.p, V.y.dofs()}
@@ -85,6 +85,7 @@ private:
     }
 
     void before() override {
+        work = make_workspace(V);
         prepare_matrices();
         set_init_state(now, U, problem);
         after_step(-1, -steps.dt);
@@ -114,12 +115,9 @@ private:
         const auto b = [this, tau](auto x) { return tau * tau / (4 * problem.eps(x)); };
         const auto c = [this, tau](auto x) { return tau / (2 * problem.mu(x)); };
 
-        const auto shape = vector_shape(V);
-
         // Buffer large enough for all the RHS
-        auto buffer = vector_type{shape};
-
-        auto mid = state{shape};
+        auto& buffer = work.buffer;
+        auto& mid = work.mid;
 
         // First substep
         substep1_fill_E(mid, prev, U, a, b);
@@ -45,6 +45,20 @@ struct space_set {
     space H1, H2, H3;
 };
 
+inline auto same_space(ads::dimension const& a, ads::dimension const& b) noexcept -> bool {
+    return a.p == b.p && a.dofs() == b.dofs() && a.elements == b.elements;
+}
+
+inline auto same_space(space const& a, space const& b) noexcept -> bool {
+    return same_space(a.x, b.x) && same_space(a.y, b.y) && same_space(a.z, b.z);
+}
+
+// Checks if all the components are discretized using space V
+inline auto same_space(space_set const& s, space const& V) noexcept -> bool {
+    return same_space(s.E1, V) && same_space(s.E2, V) && same_space(s.E3, V)  //
+        && same_space(s.H1, V) && same_space(s.H2, V) && same_space(s.H3, V);
+}
+
 inline auto factorize_matrices(space_set& s) -> void {
     factorize_matrices(s.E1);
     factorize_matrices(s.E2);
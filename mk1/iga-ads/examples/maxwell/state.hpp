@@ -5,6 +5,10 @@
 #define MAXWELL_STATE_HPP
 
 #include <array>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "ads/lin/tensor.hpp"
 
@@ -38,4 +42,34 @@ struct state {
     }
 };
 
+// Temporary storage used during a time step - the intermediate state and the
+// ADS solver buffer. Allocated once in before() by maxwell_base::make_workspace
+// and reused by all the time steps.
+struct step_workspace {
+    state mid;
+    state::field buffer;
+
+    explicit step_workspace(const std::array<int, 3>& shape)
+    : mid{shape}
+    , buffer{shape} { }
+
+    auto fields() -> std::array<state::field*, 7> {
+        return {&mid.E1, &mid.E2, &mid.E3, &mid.H1, &mid.H2, &mid.H3, &buffer};
+    }
+};
+
+// Returns whole memory pages of the field to the system. Their contents read
+// as zero afterwards, and each page is placed on the NUMA node of the thread
+// that touches it first, instead of the one that constructed the field.
+inline auto release_pages(state::field& f) -> void {
+    auto const page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    auto const begin = reinterpret_cast<std::uintptr_t>(f.data());
+    auto const end = begin + f.size() * sizeof(double);
+    auto const first = (begin + page - 1) / page * page;
+    auto const last = end / page * page;
+    if (first < last) {
+        ::madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+}
+
 #endif  // MAXWELL_STATE_HPP
@@ -4,6 +4,7 @@
 #ifndef MULTISTEP_MULTISTEP3D_HPP
 #define MULTISTEP_MULTISTEP3D_HPP
 
+#include "../common/fast_diagonalization.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
@@ -18,8 +19,8 @@ private:
 
     util::ring<vector_type> us;
 
-    lin::band_matrix Ax, Ay, Az;
-    lin::solver_ctx Ax_ctx, Ay_ctx, Az_ctx;
+    // M + eta K on the interior dofs, solved exactly by fast diagonalization
+    fdm_direction Fx, Fy, Fz;
 
     output_manager<3> output;
     galois_executor executor{8};
@@ -29,12 +30,6 @@ public:
     : Base{config}
     , multistep_base{std::move(scm), order}
     , us{std::max(s + 1, 2), shape()}
-    , Ax{x.p, x.p, x.dofs()}
-    , Ay{y.p, y.p, y.dofs()}
-    , Az{z.p, z.p, z.dofs()}
-    , Ax_ctx{Ax}
-    , Ay_ctx{Ay}
-    , Az_ctx{Az}
     , output{x.B, y.B, z.B, 80} { }
 
 private:
@@ -50,24 +45,21 @@ private:
     void prepare_matrices() {
         double eta = bs[0] * steps.dt;
 
-        fill_matrix(Ax, x.basis, eta);
-        fill_matrix(Ay, y.basis, eta);
-        fill_matrix(Az, z.basis, eta);
-
-        fix_dof(0, x, Ax);
-        fix_dof(x.dofs() - 1, x, Ax);
-        fix_dof(0, y, Ay);
-        fix_dof(y.dofs() - 1, y, Ay);
-        fix_dof(0, z, Az);
-        fix_dof(z.dofs() - 1, z, Az);
-
-        lin::factorize(Ax, Ax_ctx);
-        lin::factorize(Ay, Ay_ctx);
-        lin::factorize(Az, Az_ctx);
+        Fx = interior_fdm(x, eta);
+        Fy = interior_fdm(y, eta);
+        Fz = interior_fdm(z, eta);
 
         Base::prepare_matrices();
     }
 
+    fdm_direction interior_fdm(const dimension& dim, double eta) {
+        auto M = lin::band_matrix{dim.p, dim.p, dim.dofs()};
+        auto K = lin::band_matrix{dim.p, dim.p, dim.dofs()};
+        fill_matrix(M, dim.basis, 1, 0);
+        fill_matrix(K, dim.basis, 0, eta);
+        return fdm_direction{M, K, 1, dim.dofs() - 2};
+    }
+
     void print_errors(const vector_type& u, double t) const {
         std::cout << " error " << errorL2(u, t) << " " << errorH1(u, t);
         std::cout << " norm " << norm(u, x, y, z, L2{}) << " " << norm(u, x, y, z, H1{});
@@ -103,7 +95,7 @@ private:
         compute_rhs(us[0], t);
         apply_bc(us[0]);
 
-        ads_solve(us[0], buffer, dim_data{Ax, Ax_ctx}, dim_data{Ay, Ay_ctx}, dim_data{Az, Az_ctx});
+        fdm_solve(us[0], buffer, executor, Fx, Fy, Fz);
 
         adjust_solution(us);
     }
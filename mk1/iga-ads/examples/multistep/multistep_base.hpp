@@ -33,6 +33,11 @@ public:
 protected:
     // Compute M + eta K
     void fill_matrix(lin::band_matrix& M, const basis_data& d, double eta) {
+        fill_matrix(M, d, 1, eta);
+    }
+
+    // Compute m M + eta K
+    void fill_matrix(lin::band_matrix& M, const basis_data& d, double m, double eta) {
         for (element_id e = 0; e < d.elements; ++e) {
             for (int q = 0; q < d.quad_order; ++q) {
                 int first = d.first_dof(e);
@@ -45,7 +50,7 @@ protected:
                         auto vb = d.b[e][q][0][b];
                         auto da = d.b[e][q][1][a];
                         auto db = d.b[e][q][1][b];
-                        auto val = va * vb + eta * da * db;
+                        auto val = m * va * vb + eta * da * db;
                         M(ia, ib) += val * d.w[q] * d.J[e];
                     }
                 }
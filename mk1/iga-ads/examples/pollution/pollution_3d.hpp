@@ -4,6 +4,7 @@
 #ifndef POLLUTION_POLLUTION_3D_HPP
 #define POLLUTION_POLLUTION_3D_HPP
 
+#include "../common/parallel_ads.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
@@ -19,7 +20,8 @@ private:
     galois_executor executor{8};
 
     lin::band_matrix Kx, Ky, Kz;
-    lin::solver_ctx Kx_ctx, Ky_ctx, Kz_ctx;
+    direction_solver Kx_solver, Ky_solver, Kz_solver;
+    direction_solver Mx_solver, My_solver, Mz_solver;
 
     int save_every = 10;
 
@@ -43,10 +45,7 @@ public:
     , output{x.B, y.B, z.B, 100}
     , Kx{x.p, x.p, x.B.dofs()}
     , Ky{y.p, y.p, y.B.dofs()}
-    , Kz{z.p, z.p, z.B.dofs()}
-    , Kx_ctx{Kx}
-    , Ky_ctx{Ky}
-    , Kz_ctx{Kz} {
+    , Kz{z.p, z.p, z.B.dofs()} {
         matrix(Kx, x.basis, steps.dt / 3, c_diff[0], wind[0]);
         matrix(Ky, y.basis, steps.dt / 3, c_diff[1], wind[1]);
         matrix(Kz, z.basis, steps.dt / 3, c_diff[2], wind[2]);
@@ -197,9 +196,9 @@ private:
         // fix_dof(y.dofs() - 1, y, Ky);
         // fix_dof(z.dofs() - 1, z, Kz);
 
-        lin::factorize(Kx, Kx_ctx);
-        lin::factorize(Ky, Ky_ctx);
-        lin::factorize(Kz, Kz_ctx);
+        Kx_solver = direction_solver{Kx};
+        Ky_solver = direction_solver{Ky};
+        Kz_solver = direction_solver{Kz};
     }
 
     void prepare_matrices() {
@@ -210,6 +209,9 @@ private:
         // z.fix_left();
         // z.fix_right();
 
+        Mx_solver = mass_solver(x);
+        My_solver = mass_solver(y);
+        Mz_solver = mass_solver(z);
         Base::prepare_matrices();
 
         prepare_implicit_matrices();
@@ -240,19 +242,19 @@ private:
 
         compute_rhs_x();
         impose_bc(u);
-        ads_solve(u, buffer, dim_data{Kx, Kx_ctx}, y.data(), z.data());
+        parallel_ads_solve(u, buffer, executor, Kx_solver, My_solver, Mz_solver);
 
         swap(u, u_prev);
 
         compute_rhs_y();
         impose_bc(u);
-        ads_solve(u, buffer, x.data(), dim_data{Ky, Ky_ctx}, z.data());
+        parallel_ads_solve(u, buffer, executor, Mx_solver, Ky_solver, Mz_solver);
 
         swap(u, u_prev);
 
         compute_rhs_z();
         impose_bc(u);
-        ads_solve(u, buffer, x.data(), y.data(), dim_data{Kz, Kz_ctx});
+        parallel_ads_solve(u, buffer, executor, Mx_solver, My_solver, Kz_solver);
     }
 
     void after_step(int iter, double t) override {
@@ -4,6 +4,7 @@
 #ifndef POLLUTION_POLLUTION_DPG_3D_HPP
 #define POLLUTION_POLLUTION_DPG_3D_HPP
 
+#include "../common/banded_schur_operator.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/lin/dense_matrix.hpp"
 #include "ads/lin/dense_solve.hpp"
@@ -22,16 +23,17 @@ private:
     dimension& Vx;
     dimension& Vy;
     dimension& Vz;
-    lin::dense_matrix Kx_x, Kx_y, Kx_z, Ky_x, Ky_y, Ky_z, Kz_x, Kz_y, Kz_z;
-    lin::solver_ctx Kxx_ctx, Kxy_ctx, Kxz_ctx, Kyx_ctx, Kyy_ctx, Kyz_ctx, Kzx_ctx, Kzy_ctx, Kzz_ctx;
+    // Kx_x = Bx' Ax^-1 Bx etc., applied and solved without forming them
+    banded_schur_operator Kx_x, Ky_y, Kz_z;
+    lin::band_matrix Kx_y, Kx_z, Ky_x, Ky_z, Kz_x, Kz_y;
+    lin::solver_ctx Kxy_ctx, Kxz_ctx, Kyx_ctx, Kyz_ctx, Kzx_ctx, Kzy_ctx;
 
     lin::band_matrix Ax, Ay, Az;
     lin::solver_ctx Ax_ctx, Ay_ctx, Az_ctx;
     lin::band_matrix MUx, MUy, MUz;
 
     lin::band_matrix MUVx, MUVy, MUVz;
-    lin::band_matrix Bx, By, Bz;
-    lin::dense_matrix Tx, Ty, Tz;
+    row_band_matrix Bx, By, Bz;
 
     vector_type u, u_prev;
     vector_type u_buffer;
@@ -63,24 +65,21 @@ public:
     , Vx{x}
     , Vy{y}
     , Vz{z}
-    , Kx_x{Ux.dofs(), Ux.dofs()}
-    , Kx_y{Uy.dofs(), Uy.dofs()}
-    , Kx_z{Uz.dofs(), Uz.dofs()}
-    , Ky_x{Ux.dofs(), Ux.dofs()}
-    , Ky_y{Uy.dofs(), Uy.dofs()}
-    , Ky_z{Uz.dofs(), Uz.dofs()}
-    , Kz_x{Ux.dofs(), Ux.dofs()}
-    , Kz_y{Uy.dofs(), Uy.dofs()}
-    , Kz_z{Uz.dofs(), Uz.dofs()}
-    , Kxx_ctx{Kx_x}
+    , Kx_x{Vx, Ux}
+    , Ky_y{Vy, Uy}
+    , Kz_z{Vz, Uz}
+    , Kx_y{Uy.p, Uy.p, Uy.dofs()}
+    , Kx_z{Uz.p, Uz.p, Uz.dofs()}
+    , Ky_x{Ux.p, Ux.p, Ux.dofs()}
+    , Ky_z{Uz.p, Uz.p, Uz.dofs()}
+    , Kz_x{Ux.p, Ux.p, Ux.dofs()}
+    , Kz_y{Uy.p, Uy.p, Uy.dofs()}
     , Kxy_ctx{Kx_y}
     , Kxz_ctx{Kx_z}
     , Kyx_ctx{Ky_x}
-    , Kyy_ctx{Ky_y}
     , Kyz_ctx{Ky_z}
     , Kzx_ctx{Kz_x}
     , Kzy_ctx{Kz_y}
-    , Kzz_ctx{Kz_z}
     , Ax{Vx.p, Vx.p, Vx.dofs()}
     , Ay{y.p, Vy.p, Vy.dofs()}
     , Az{z.p, Vz.p, Vz.dofs()}
@@ -93,12 +92,9 @@ public:
     , MUVx{Vx.p, Ux.p, Vx.dofs(), Ux.dofs()}
     , MUVy{Vy.p, Uy.p, Vy.dofs(), Uy.dofs()}
     , MUVz{Vz.p, Uz.p, Vz.dofs(), Uz.dofs()}
-    , Bx{Vx.p, Ux.p, Vx.dofs(), Ux.dofs()}
-    , By{Vy.p, Uy.p, Vy.dofs(), Uy.dofs()}
-    , Bz{Vz.p, Uz.p, Vz.dofs(), Uz.dofs()}
-    , Tx{Vx.dofs(), Ux.dofs()}
-    , Ty{Vy.dofs(), Uy.dofs()}
-    , Tz{Vz.dofs(), Uz.dofs()}
+    , Bx{Vx, Ux}
+    , By{Vy, Uy}
+    , Bz{Vz, Uz}
     , u{{Ux.dofs(), Uy.dofs(), Uz.dofs()}}
     , u_prev{{Ux.dofs(), Uy.dofs(), Uz.dofs()}}
     , u_buffer{{Ux.dofs(), Uy.dofs(), Uz.dofs()}}
@@ -129,7 +125,7 @@ private:
         }
     }
 
-    void mass_matrix(lin::band_matrix& M, const basis_data& bU, const basis_data& bV) {
+    void mass_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
                 for (int a = 0; a + bV.first_dof(e) <= bV.last_dof(e); ++a) {
@@ -146,7 +142,7 @@ private:
         }
     }
 
-    void diffusion_matrix(lin::band_matrix& M, const basis_data& bU, const basis_data& bV, double h,
+    void diffusion_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV, double h,
                           double diffusion) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
@@ -164,7 +160,7 @@ private:
         }
     }
 
-    void advection_matrix(lin::band_matrix& M, const basis_data& bU, const basis_data& bV, double h,
+    void advection_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV, double h,
                           double advection) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
@@ -182,7 +178,7 @@ private:
         }
     }
 
-    void matrix(lin::band_matrix& B, const basis_data& bU, const basis_data& bV, double h,
+    void matrix(row_band_matrix& B, const basis_data& bU, const basis_data& bV, double h,
                 double diffusion, double advection) {
         mass_matrix(B, bU, bV);
         diffusion_matrix(B, bU, bV, h, diffusion);
@@ -210,15 +206,12 @@ private:
         MUx.zero();
         MUy.zero();
         MUz.zero();
-        Kx_x.zero();
         Kx_y.zero();
         Kx_z.zero();
         Ky_x.zero();
-        Ky_y.zero();
         Ky_z.zero();
         Kz_x.zero();
         Kz_y.zero();
-        Kz_z.zero();
 
         // mass_matrix(MUVx, Ux.basis, x.basis);
         // mass_matrix(MUVy, Uy.basis, y.basis);
@@ -235,16 +228,19 @@ private:
         gram_matrix_1d(MUy, Uy.basis);
         gram_matrix_1d(MUz, Uz.basis);
 
+        // Kx_x = Bx' Ax^-1 Bx
+        Kx_x.factorize(Bx, Ax);
+
+        // Ky_y = By' Ay^-1 By
+        Ky_y.factorize(By, Ay);
+
+        // K_z = Bz' Az^-1 Bz
+        Kz_z.factorize(Bz, Az);
+
         lin::factorize(Ax, Ax_ctx);
         lin::factorize(Ay, Ay_ctx);
         lin::factorize(Az, Az_ctx);
 
-        // TODO: fill
-        // Kx_x = Bx' Ax^-1 Bx
-        to_dense(Bx, Tx);
-        solve_with_factorized(Ax, Tx, Ax_ctx);
-        multiply(Bx, Tx, Kx_x, "T");
-
         // Kx_y = MUVy' MVy^-1 MUVy
         // to_dense(MUy, Ty);
         // solve_with_factorized(Uy.M, Ty, Uy.ctx);
@@ -257,35 +253,22 @@ private:
         // multiply(MUx, Tx, Ky_x, "T");
         // to_dense(MUx, Ky_x);
 
-        // Ky_y = By' Ay^-1 By
-        to_dense(By, Ty);
-        solve_with_factorized(Ay, Ty, Ay_ctx);
-        multiply(By, Ty, Ky_y, "T");
-
-        // K_z = Bz' Az^-1 Bz
-        to_dense(Bz, Tz);
-        solve_with_factorized(Az, Tz, Az_ctx);
-        multiply(Bz, Tz, Kz_z, "T");
-
-        to_dense(MUx, Ky_x);
-        to_dense(MUx, Kz_x);
-        to_dense(MUy, Kx_y);
-        to_dense(MUy, Kz_y);
-        to_dense(MUz, Kx_z);
-        to_dense(MUz, Ky_z);
+        Ky_x = MUx;
+        Kz_x = MUx;
+        Kx_y = MUy;
+        Kz_y = MUy;
+        Kx_z = MUz;
+        Ky_z = MUz;
 
         // lin::factorize(MUx, MUx_ctx);
         // lin::factorize(MUy, MUy_ctx);
 
-        lin::factorize(Kx_x, Kxx_ctx);
         lin::factorize(Kx_y, Kxy_ctx);
         lin::factorize(Kx_z, Kxz_ctx);
         lin::factorize(Ky_x, Kyx_ctx);
-        lin::factorize(Ky_y, Kyy_ctx);
         lin::factorize(Ky_z, Kyz_ctx);
         lin::factorize(Kz_x, Kzx_ctx);
         lin::factorize(Kz_y, Kzy_ctx);
-        lin::factorize(Kz_z, Kzz_ctx);
     }
 
     void prepare_matrices() {
@@ -341,9 +324,9 @@ private:
         lin::cyclic_transpose(u_tt, u);
 
         {
-            // ads_solve(u, u_buffer, dim_data{Kx_x, Kxx_ctx}, dim_data{Kx_y, Kxy_ctx},
+            // ads_solve(u, u_buffer, Kx_x, dim_data{Kx_y, Kxy_ctx},
             // dim_cata{Kx_z, Kxz_ctx});
-            lin::solve_with_factorized(Kx_x, u, Kxx_ctx);
+            Kx_x(u);
             auto F = lin::cyclic_transpose(u, u_buffer.data());
             lin::solve_with_factorized(Kx_y, F, Kxy_ctx);
             auto F2 = lin::cyclic_transpose(F, u_buffer.data());
@@ -368,11 +351,11 @@ private:
         lin::cyclic_transpose(u_tt, u);
 
         {
-            // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, dim_data{Ky_y, Kyy_ctx},
+            // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, Ky_y,
             // dim_data{Ky_z, Kyz_ctx});
             lin::solve_with_factorized(Ky_x, u, Kyx_ctx);
             auto F = lin::cyclic_transpose(u, u_buffer.data());
-            lin::solve_with_factorized(Ky_y, F, Kyy_ctx);
+            Ky_y(F);
             auto F2 = lin::cyclic_transpose(F, u_buffer.data());
             lin::solve_with_factorized(Ky_z, F2, Kyz_ctx);
             lin::cyclic_transpose(F2, u);
@@ -398,13 +381,13 @@ private:
         lin::cyclic_transpose(u_tt, u);
 
         {
-            // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, dim_data{Ky_y, Kyy_ctx},
+            // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, Ky_y,
             // dim_data{Ky_z, Kyz_ctx});
             lin::solve_with_factorized(Kz_x, u, Kzx_ctx);
             auto F = lin::cyclic_transpose(u, u_buffer.data());
             lin::solve_with_factorized(Kz_y, F, Kzy_ctx);
             auto F2 = lin::cyclic_transpose(F, u_buffer.data());
-            lin::solve_with_factorized(Kz_z, F2, Kzz_ctx);
+            Kz_z(F2);
             lin::cyclic_transpose(F2, u);
         }
     }
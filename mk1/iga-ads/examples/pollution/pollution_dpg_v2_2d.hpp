@@ -4,6 +4,7 @@
 #ifndef POLLUTION_POLLUTION_DPG_V2_2D_HPP
 #define POLLUTION_POLLUTION_DPG_V2_2D_HPP
 
+#include "../common/banded_schur_operator.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/lin/dense_matrix.hpp"
 #include "ads/lin/dense_solve.hpp"
@@ -21,24 +22,42 @@ private:
     dimension Ux, Uy;
     dimension& Vx;
     dimension& Vy;
-    lin::dense_matrix Kx_x, Kx_y, Ky_x, Ky_y;
-
-    lin::dense_matrix Kx_x_nf, Kx_y_nf, Ky_x_nf, Ky_y_nf;  // non-factorized copies
-
-    lin::solver_ctx Kxx_ctx, Kxy_ctx, Kyx_ctx, Kyy_ctx;
+    // Kx_x = Bx' Ax^-1 Bx and Ky_y = By' Ay^-1 By, applied and solved without forming them
+    banded_schur_operator Kx_x, Ky_y;
+    lin::band_matrix Kx_y, Ky_x;
+    lin::solver_ctx Kxy_ctx, Kyx_ctx;
 
     lin::band_matrix Ax, Ay;
     lin::solver_ctx Ax_ctx, Ay_ctx;
     lin::band_matrix MUx, MUy;
 
     lin::band_matrix MUVx, MUVy;
-    // lin::band_matrix Bx, By;
-    lin::dense_matrix Bx, By;
-    lin::dense_matrix Tx, Ty;
+    row_band_matrix Bx, By;
+
+    // Dirichlet rows of the right-hand side of a substep, K applied to the
+    // boundary values
+    struct boundary_rows {
+        lin::vector bottom, top;  // u(i, 0), u(i, Uy.dofs() - 1)
+        lin::vector left, right;  // u(0, j), u(Ux.dofs() - 1, j)
+
+        boundary_rows(int nx, int ny)
+        : bottom{{nx}}
+        , top{{nx}}
+        , left{{ny}}
+        , right{{ny}} { }
+    };
+
+    boundary_rows bc_x, bc_y;
 
     vector_type u, u_prev;
     vector_type u_buffer;
     vector_type rhs1, rhs2;
+    vector_type rhsx1, rhsx1_t, rhsx2, rhsx2_t, u_t;
+
+    // Integrals of u_prev, reduced while assembling rhs1 on steps that are
+    // saved and analyzed
+    double total = 0.0;
+    double emission_rate = 0.0;
 
     int save_every = 10;
 
@@ -66,18 +85,12 @@ public:
     , Uy{config.y, config.derivatives}
     , Vx{x}
     , Vy{y}
-    , Kx_x{Ux.dofs(), Ux.dofs()}
-    , Kx_y{Uy.dofs(), Uy.dofs()}
-    , Ky_x{Ux.dofs(), Ux.dofs()}
-    , Ky_y{Uy.dofs(), Uy.dofs()}
-    , Kx_x_nf{Ux.dofs(), Ux.dofs()}
-    , Kx_y_nf{Uy.dofs(), Uy.dofs()}
-    , Ky_x_nf{Ux.dofs(), Ux.dofs()}
-    , Ky_y_nf{Uy.dofs(), Uy.dofs()}
-    , Kxx_ctx{Kx_x}
+    , Kx_x{Vx, Ux}
+    , Ky_y{Vy, Uy}
+    , Kx_y{Uy.p, Uy.p, Uy.dofs()}
+    , Ky_x{Ux.p, Ux.p, Ux.dofs()}
     , Kxy_ctx{Kx_y}
     , Kyx_ctx{Ky_x}
-    , Kyy_ctx{Ky_y}
     , Ax{Vx.p, Vx.p, Vx.dofs()}
     , Ay{y.p, Vy.p, Vy.dofs()}
     , Ax_ctx{Ax}
@@ -86,15 +99,20 @@ public:
     , MUy{Uy.p, Uy.p, Uy.dofs(), Uy.dofs(), 0}
     , MUVx{Vx.p, Ux.p, Vx.dofs(), Ux.dofs()}
     , MUVy{Vy.p, Uy.p, Vy.dofs(), Uy.dofs()}
-    , Bx{Vx.dofs(), Ux.dofs()}
-    , By{Vy.dofs(), Uy.dofs()}
-    , Tx{Vx.dofs(), Ux.dofs()}
-    , Ty{Vy.dofs(), Uy.dofs()}
+    , Bx{Vx, Ux}
+    , By{Vy, Uy}
+    , bc_x{Ux.dofs(), Uy.dofs()}
+    , bc_y{Ux.dofs(), Uy.dofs()}
     , u{{Ux.dofs(), Uy.dofs()}}
     , u_prev{{Ux.dofs(), Uy.dofs()}}
     , u_buffer{{Ux.dofs(), Uy.dofs()}}
     , rhs1{{Vx.dofs(), Uy.dofs()}}
     , rhs2{{Ux.dofs(), Vy.dofs()}}
+    , rhsx1{{Ux.dofs(), Uy.dofs()}}
+    , rhsx1_t{{Uy.dofs(), Ux.dofs()}}
+    , rhsx2{{Ux.dofs(), Vy.dofs()}}
+    , rhsx2_t{{Vy.dofs(), Ux.dofs()}}
+    , u_t{{Uy.dofs(), Ux.dofs()}}
     , output{Ux.B, Uy.B, 400} { }
 
 private:
@@ -152,7 +170,7 @@ private:
         }
     }
 
-    void mass_matrix(lin::dense_matrix& M, const basis_data& bU, const basis_data& bV) {
+    void mass_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
                 for (int a = 0; a + bV.first_dof(e) <= bV.last_dof(e); ++a) {
@@ -169,7 +187,7 @@ private:
         }
     }
 
-    void diffusion_matrix(lin::dense_matrix& M, const basis_data& bU, const basis_data& bV,
+    void diffusion_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV,
                           double h, double diffusion) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
@@ -187,7 +205,7 @@ private:
         }
     }
 
-    void advection_matrix(lin::dense_matrix& M, const basis_data& bU, const basis_data& bV,
+    void advection_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV,
                           double h, double advection) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
@@ -205,7 +223,7 @@ private:
         }
     }
 
-    void fix_dof(int k, const dimension& dim, lin::dense_matrix& K) {
+    void fix_dof(int k, const dimension& dim, lin::band_matrix& K) {
         int last = dim.dofs() - 1;
         for (int i = clamp(k - dim.p, 0, last); i <= clamp(k + dim.p, 0, last); ++i) {
             K(k, i) = 0;
@@ -213,7 +231,7 @@ private:
         K(k, k) = 1;
     }
 
-    void matrix(lin::dense_matrix& B, const basis_data& bU, const basis_data& bV, double h,
+    void matrix(row_band_matrix& B, const basis_data& bU, const basis_data& bV, double h,
                 double diffusion, double advection) {
         mass_matrix(B, bU, bV);
         diffusion_matrix(B, bU, bV, h, diffusion);
@@ -237,10 +255,8 @@ private:
         Ay.zero();
         MUx.zero();
         MUy.zero();
-        Kx_x.zero();
         Kx_y.zero();
         Ky_x.zero();
-        Ky_y.zero();
 
         // mass_matrix(MUVx, Ux.basis, x.basis);
         // mass_matrix(MUVy, Uy.basis, y.basis);
@@ -253,56 +269,97 @@ private:
         gram_matrix_1d(MUx, Ux.basis);
         gram_matrix_1d(MUy, Uy.basis);
 
+        // Kx_x = Bx' Ax^-1 Bx
+        Kx_x.factorize(Bx, Ax, {0, Ux.dofs() - 1});
+
+        // Ky_y = By' Ay^-1 By
+        Ky_y.factorize(By, Ay, {0, Uy.dofs() - 1});
+
         lin::factorize(Ax, Ax_ctx);
         lin::factorize(Ay, Ay_ctx);
 
-        // TODO: fill
-        // Kx_x = Bx' Ax^-1 Bx
-        // to_dense(Bx, Tx);
-        Tx = Bx;
-        solve_with_factorized(Ax, Tx, Ax_ctx);
-        multiply(Bx, Tx, Kx_x, "T");
-
         // Kx_y = MUVy' MVy^-1 MUVy
         // to_dense(MUy, Ty);
         // solve_with_factorized(Uy.M, Ty, Uy.ctx);
         // multiply(MUy, Ty, Kx_y, "T");
-        to_dense(MUy, Kx_y);
+        Kx_y = MUy;
 
         // Ky_x = MUVx' MVx^-1 MUVx
         // to_dense(MUx, Tx);
         // solve_with_factorized(Ux.M, Tx, Ux.ctx);
         // multiply(MUx, Tx, Ky_x, "T");
-        to_dense(MUx, Ky_x);
-
-        // Ky_y = By' Ay^-1 By
-        // to_dense(By, Ty);
-        Ty = By;
-        solve_with_factorized(Ay, Ty, Ay_ctx);
-        multiply(By, Ty, Ky_y, "T");
-
-        // lin::factorize(MUx, MUx_ctx);
-        // lin::factorize(MUy, MUy_ctx);
+        Ky_x = MUx;
 
         fix_dof(0, Uy, Kx_y);
-        fix_dof(0, Uy, Ky_y);
         fix_dof(Uy.dofs() - 1, Uy, Kx_y);
-        fix_dof(Uy.dofs() - 1, Uy, Ky_y);
 
         fix_dof(0, Ux, Ky_x);
-        fix_dof(0, Ux, Kx_x);
         fix_dof(Ux.dofs() - 1, Ux, Ky_x);
-        fix_dof(Ux.dofs() - 1, Ux, Kx_x);
 
-        Kx_x_nf = Kx_x;
-        Kx_y_nf = Kx_y;
-        Ky_x_nf = Ky_x;
-        Ky_y_nf = Ky_y;
+        // Needs Kx_y and Ky_x before factorization
+        prepare_boundary_rows();
 
-        lin::factorize(Kx_x, Kxx_ctx);
         lin::factorize(Kx_y, Kxy_ctx);
         lin::factorize(Ky_x, Kyx_ctx);
-        lin::factorize(Ky_y, Kyy_ctx);
+    }
+
+    // Projects the Dirichlet data on the boundary and applies the operators of
+    // both substeps to it. The data does not depend on time, so this is done
+    // once, together with the factorization.
+    void prepare_boundary_rows() {
+        lin::vector buf_y0{{Ux.dofs()}};
+        compute_projection(buf_y0, Ux.basis, [&](double /*t*/) {
+            // return std::sin(t * M_PI);
+            // return 1 - t;
+            return 1;
+        });
+        lin::solve_with_factorized(Ux.M, buf_y0, Ux.ctx);
+
+        lin::vector buf_y1{{Ux.dofs()}};
+        compute_projection(buf_y1, Ux.basis, [&](double /*t*/) {
+            // auto a =  std::sin(t * 3 * M_PI);
+            // return a * a;
+            return 0;
+        });
+        lin::solve_with_factorized(Ux.M, buf_y1, Ux.ctx);
+
+        lin::vector buf_x0{{Uy.dofs()}};
+        compute_projection(buf_x0, Uy.basis, [&](double t) {
+            // auto a =  std::sin(t * 4 * M_PI);
+            // return a * a;
+            return t < 0.5 ? 1 : 0;
+            // return t < 0.5 ? 1 - 2*t : 0;
+        });
+        lin::solve_with_factorized(Uy.M, buf_x0, Uy.ctx);
+
+        lin::vector buf_x1{{Uy.dofs()}};
+        compute_projection(buf_x1, Uy.basis, [&](double /*t*/) {
+            // auto a =  std::sin(t * 2 * M_PI);
+            // return a * a;
+            return 0;
+        });
+        lin::solve_with_factorized(Uy.M, buf_x1, Uy.ctx);
+
+        apply(Kx_x, buf_y0, bc_x.bottom);
+        apply(Kx_x, buf_y1, bc_x.top);
+        apply(Kx_y, buf_x0, bc_x.left);
+        apply(Kx_y, buf_x1, bc_x.right);
+
+        apply(Ky_x, buf_y0, bc_y.bottom);
+        apply(Ky_x, buf_y1, bc_y.top);
+        apply(Ky_y, buf_x0, bc_y.left);
+        apply(Ky_y, buf_x1, bc_y.right);
+    }
+
+    void set_boundary_rows(vector_type& v, const boundary_rows& bc) const {
+        for (int i = 0; i < Ux.dofs(); ++i) {
+            v(i, 0) = bc.bottom(i);
+            v(i, Uy.dofs() - 1) = bc.top(i);
+        }
+        for (int i = 0; i < Uy.dofs(); ++i) {
+            v(0, i) = bc.left(i);
+            v(Ux.dofs() - 1, i) = bc.right(i);
+        }
     }
 
     void prepare_matrices() {
@@ -329,15 +386,10 @@ private:
         swap(u, u_prev);
     }
 
-    void step(int /*iter*/, double /*t*/) override {
-        compute_rhs_x();
+    void step(int iter, double /*t*/) override {
+        compute_rhs_x(is_saved(iter));
         ads_solve(rhs1, buffer, dim_data{Ax, Ax_ctx}, Uy.data());
 
-        vector_type rhsx1{{Ux.dofs(), Uy.dofs()}};
-        vector_type rhsx1_t{{Uy.dofs(), Ux.dofs()}};
-
-        vector_type u_t{{Uy.dofs(), Ux.dofs()}};
-
         // u = (Bx * MUVy)' rhs
         // =>
         // u = (Bx' (MUVy' rhs)')'
@@ -350,88 +402,14 @@ private:
         multiply(MUy, rhsx1_t, u_t, Ux.dofs(), "T");
         lin::cyclic_transpose(u_t, u);
 
-        lin::band_matrix MUx_loc{Ux.p, Ux.p, Ux.dofs()};
-        gram_matrix_1d(MUx_loc, Ux.basis);
-        lin::solver_ctx ctx_x{MUx_loc};
-        lin::factorize(MUx_loc, ctx_x);
-
-        lin::band_matrix MUy_loc{Uy.p, Uy.p, Uy.dofs()};
-        gram_matrix_1d(MUy_loc, Uy.basis);
-        lin::solver_ctx ctx_y{MUy_loc};
-        lin::factorize(MUy_loc, ctx_y);
-
-        lin::vector buf_y0{{Ux.dofs()}};
-        compute_projection(buf_y0, Ux.basis, [&](double /*t*/) {
-            // return std::sin(t * M_PI);
-            // return 1 - t;
-            return 1;
-        });
-        lin::solve_with_factorized(MUx_loc, buf_y0, ctx_x);
-
-        lin::vector buf_y1{{Ux.dofs()}};
-        compute_projection(buf_y1, Ux.basis, [&](double /*t*/) {
-            // auto a =  std::sin(t * 3 * M_PI);
-            // return a * a;
-            return 0;
-        });
-        lin::solve_with_factorized(MUx_loc, buf_y1, ctx_x);
-
-        lin::vector buf_x0{{Uy.dofs()}};
-        compute_projection(buf_x0, Uy.basis, [&](double t) {
-            // auto a =  std::sin(t * 4 * M_PI);
-            // return a * a;
-            return t < 0.5 ? 1 : 0;
-            // return t < 0.5 ? 1 - 2*t : 0;
-        });
-        lin::solve_with_factorized(MUy_loc, buf_x0, ctx_y);
-
-        lin::vector buf_x1{{Uy.dofs()}};
-        compute_projection(buf_x1, Uy.basis, [&](double /*t*/) {
-            // auto a =  std::sin(t * 2 * M_PI);
-            // return a * a;
-            return 0;
-        });
-        lin::solve_with_factorized(MUy_loc, buf_x1, ctx_y);
-
-        for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += buf_y0(j) * Kx_x_nf(i, j);
-            }
-            u(i, 0) = val;
-        }
-
-        for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += buf_y1(j) * Kx_x_nf(i, j);
-            }
-            u(i, Uy.dofs() - 1) = val;
-        }
-
-        for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += buf_x0(j) * Kx_y_nf(i, j);
-            }
-            u(0, i) = val;
-        }
-
-        for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += buf_x1(j) * Kx_y_nf(i, j);
-            }
-            u(Ux.dofs() - 1, i) = val;
-        }
-
+        set_boundary_rows(u, bc_x);
         u(0, 0) = 1;
         u(Ux.dofs() - 1, 0) = 1;
         u(Ux.dofs() - 1, Uy.dofs() - 1) = 0;
         u(0, Uy.dofs() - 1) = 0;
 
-        // ads_solve(u, u_buffer, dim_data{Kx_x, Kxx_ctx}, dim_data{Kx_y, Kxy_ctx});
-        lin::solve_with_factorized(Kx_x, u, Kxx_ctx);
+        // ads_solve(u, u_buffer, Kx_x, dim_data{Kx_y, Kxy_ctx});
+        Kx_x(u);
         auto F = lin::cyclic_transpose(u, u_buffer.data());
         lin::solve_with_factorized(Kx_y, F, Kxy_ctx);
         lin::cyclic_transpose(F, u);
@@ -442,8 +420,6 @@ private:
         compute_rhs_y();
         ads_solve(rhs2, buffer, Ux.data(), dim_data{Ay, Ay_ctx});
 
-        vector_type rhsx2{{Ux.dofs(), Vy.dofs()}};
-        vector_type rhsx2_t{{Vy.dofs(), Ux.dofs()}};
         // u = (MUVx * By)' rhs
 
         multiply(MUx, rhs2, rhsx2, Vy.dofs(), "T");
@@ -451,50 +427,21 @@ private:
         multiply(By, rhsx2_t, u_t, Ux.dofs(), "T");
         lin::cyclic_transpose(u_t, u);
 
-        for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += buf_y0(j) * Ky_x_nf(i, j);
-            }
-            u(i, 0) = val;
-        }
-
-        for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += buf_y1(j) * Ky_x_nf(i, j);
-            }
-            u(i, Uy.dofs() - 1) = val;
-        }
-
-        for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += buf_x0(j) * Ky_y_nf(i, j);
-            }
-            u(0, i) = val;
-        }
-
-        for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += buf_x1(j) * Ky_y_nf(i, j);
-            }
-            u(Ux.dofs() - 1, i) = val;
-        }
+        set_boundary_rows(u, bc_y);
 
-        // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, dim_data{Ky_y, Kyy_ctx});
+        // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, Ky_y);
         lin::solve_with_factorized(Ky_x, u, Kyx_ctx);
         auto F2 = lin::cyclic_transpose(u, u_buffer.data());
-        lin::solve_with_factorized(Ky_y, F2, Kyy_ctx);
+        Ky_y(F2);
         lin::cyclic_transpose(F2, u);
     }
 
-    void after_step(int iter, double /*t*/) override {
-        if ((iter + 1) % save_every == 0) {
-            std::cout << "Step " << (iter + 1) << std::endl;
+    bool is_saved(int iter) const { return (iter + 1) % save_every == 0; }
+
+    void after_step(int iter, double t) override {
+        if (is_saved(iter)) {
             output.to_file(u, "out_%d.data", (iter + 1) / save_every);
-            //     analyze(iter, t + 0.5 * steps.dt);
+            analyze(iter, t);
         }
 
         // auto s = t / 150;
@@ -502,7 +449,7 @@ private:
         // wind_angle = M_PI / 3 * phase + 1.5 * M_PI / 4;
 
         // wind = { wind_speed * cos(wind_angle), wind_speed * sin(wind_angle) };
-        prepare_implicit_matrices();
+        // prepare_implicit_matrices();  // only needed when the wind changes
     }
 
     double grad_dot(point_type a, value_type u) const { return a[0] * u.dx + a[1] * u.dy; }
@@ -568,12 +515,17 @@ private:
         }
     }
 
-    void compute_rhs_x() {
+    // With reduce, also computes the integrals reported by analyze
+    void compute_rhs_x(bool reduce) {
         zero(rhs1);
+        total = 0.0;
+        emission_rate = 0.0;
 
         executor.for_each(elements(Vx, Uy), [&](index_type e) {
             auto U = vector_type{{Vx.basis.dofs_per_element(), Uy.basis.dofs_per_element()}};
             auto h = 0.5 * steps.dt;
+            double total_loc = 0.0;
+            double emission_loc = 0.0;
 
             double J = jacobian(e);
             for (auto q : quad_points(Vx, Uy)) {
@@ -581,6 +533,11 @@ private:
                 auto x = point(e, q);
                 value_type u = eval(u_prev, e, q, Ux, Uy);
 
+                if (reduce) {
+                    total_loc += u.val * w * J;
+                    emission_loc += emission(x[0], x[1], u.val) * w * J;
+                }
+
                 for (auto a : dofs_on_element(e, Vx, Uy)) {
                     auto aa = dof_global_to_local(e, a, Vx, Uy);
                     value_type v = eval_basis(e, q, a, Vx, Uy);
@@ -594,7 +551,13 @@ private:
                     U(aa[0], aa[1]) += val * w * J;
                 }
             }
-            executor.synchronized([&]() { update_global_rhs(rhs1, U, e, Vx, Uy); });
+            executor.synchronized([&]() {
+                update_global_rhs(rhs1, U, e, Vx, Uy);
+                if (reduce) {
+                    total += total_loc;
+                    emission_rate += emission_loc;
+                }
+            });
         });
     }
 
@@ -627,35 +590,23 @@ private:
         });
     }
 
+    // Reports the integrals computed by the last compute_rhs_x, i.e. of the
+    // solution at the beginning of the step, at time t
     void analyze(int iter, double t) {
-        double total = 0.0;
-        double emission_rate = 0.0;
-        for (auto e : elements(Ux, Ux)) {
-            double J = jacobian(e);
-            for (auto q : quad_points(Ux, Ux)) {
-                double w = weight(q);
-                auto x = point(e, q);
-                value_type u = eval(u_prev, e, q, Ux, Uy);
-
-                total += u.val * w * J;
-                emission_rate += emission(x[0], x[1], u.val) * w * J;
-            }
-        }
-
         using std::setw, std::setprecision;
 
-        total /= 1000;          // g -> kg
-        emission_rate /= 1000;  // g -> kg
+        auto total_kg = total / 1000;                  // g -> kg
+        auto emission_rate_kg = emission_rate / 1000;  // g -> kg
 
-        auto emitted = t * emission_rate;      // kg
+        auto emitted = t * emission_rate_kg;   // kg
         auto area = 5000.0 * 5000.0;           // m^2
         auto initial = area * ambient / 1000;  // kg
         auto absorbed_kg = absorbed / 1000;
-        auto loss = initial + emitted - total - absorbed_kg;
+        auto loss = initial + emitted - total_kg - absorbed_kg;
         auto loss_percent = 100 * loss / emitted;
 
         std::cout << "Step " << (iter + 1) << ":"
-                  << "  total " << setw(8) << setprecision(5) << total << " kg "
+                  << "  total " << setw(8) << setprecision(5) << total_kg << " kg "
                   << "  absorbed " << setw(8) << setprecision(5) << absorbed_kg << " kg "
                   << "  (loss " << setw(6) << loss << " kg,  " << setw(5) << loss_percent << "%)"
                   << std::endl;
@@ -1,14 +1,68 @@
 // SPDX-FileCopyrightText: 2015 - 2021 Marcin Łoś <marcin.los.91@gmail.com>
 // SPDX-License-Identifier: MIT
 
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
 #include "polution.hpp"
 
-int main() {
-    ads::dim_config dim{2, 40};
-    ads::timesteps_config steps{iterations, 1e-5};
+int main(int argc, char* argv[]) {
+    if (argc > 3) {
+        std::cerr << "Usage: pollution_mk2 [refinement [phases]]" << std::endl;
+        std::exit(1);
+    }
+    // Elements around the sources and around the part of the cannon front
+    // passed during a phase are split into this many elements. The run is
+    // split into phases, each on a mesh refined around the front only for
+    // its own time, with the solution projected from one mesh to the next.
+    int refinement = argc > 1 ? std::atoi(argv[1]) : 1;
+    int phases = argc > 2 ? std::atoi(argv[2]) : 10;
+    if (refinement < 1 || phases < 1 || phases > iterations) {
+        std::cerr << "Refinement and phases need to be positive, with at most " << iterations
+                  << " phases" << std::endl;
+        std::exit(1);
+    }
+
+    int p = 2;
+    int quad = p + 1;
+    double dt = 1e-5;
     int ders = 1;
 
-    ads::config_2d c{dim, dim, steps, ders};
-    ads::problems::heat_2d sim{c};
-    sim.run();
+    using ads::problems::heat_2d;
+    auto points = ads::uniform_points(0, 1, 40);
+
+    std::unique_ptr<heat_2d> previous;
+    for (int phase = 0; phase < phases; ++phase) {
+        int first = static_cast<long>(iterations) * phase / phases;
+        int last = static_cast<long>(iterations) * (phase + 1) / phases;
+
+        // Cannon origin and the front in x, ground emission layer, the jump of
+        // dTy and the front in y
+        auto regions_x = std::vector<ads::mesh_region>{ads::around(0.5, 0.1)};
+        auto regions_y = std::vector<ads::mesh_region>{{0, 0.125}, ads::around(0.8, 0.025)};
+        for (auto const& front : heat_2d::cannon_front(first, last - 1)) {
+            regions_x.push_back(front[0]);
+            regions_y.push_back(front[1]);
+        }
+        auto points_x = ads::refine_points(points, regions_x, refinement);
+        auto points_y = ads::refine_points(points, regions_y, refinement);
+
+        auto dim_x = ads::dimension{ads::basis_from_points(points_x, p, 0), quad, ders};
+        auto dim_y = ads::dimension{ads::basis_from_points(points_y, p, 0), quad, ders};
+
+        // Explicit steps on the refined mesh need to be shorter
+        int substeps = heat_2d::stable_substeps(dim_x, dim_y, dt);
+        auto steps = ads::timesteps_config{(last - first) * substeps, dt / substeps};
+
+        std::cout << "\nphase " << phase << ", iterations " << first << " - " << last
+                  << ", dofs: " << dim_x.dofs() << " x " << dim_y.dofs()
+                  << ", substeps: " << substeps << std::endl;
+
+        auto sim = std::make_unique<heat_2d>(dim_x, dim_y, steps, first, substeps, previous.get());
+        sim->run();
+        previous = std::move(sim);
+    }
 }
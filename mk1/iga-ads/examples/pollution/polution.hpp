@@ -5,8 +5,16 @@
 #define HEAT_HEAT_2D_HPP
 
 #include <galois/Timer.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
 #include <iostream>
+#include <vector>
 
+#include "../common/fast_diagonalization.hpp"
+#include "../common/mesh_points.hpp"
+#include "../common/point_eval.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
 
@@ -18,6 +26,18 @@ private:
     using Base = simulation_2d;
     vector_type u, u_prev;
 
+    // Mesh points, the source terms are evaluated at element corners
+    std::vector<double> px, py;
+
+    // Time steps of the model are iterations first_iter, first_iter + 1, ...,
+    // each made of substeps explicit steps of the simulation
+    int first_iter = 0;
+    int substeps = 1;
+
+    // Simulation of the previous part of the run, its final solution is the
+    // initial state. Used only in before().
+    const heat_2d* previous = nullptr;
+
     output_manager<2> output;
 
 public:
@@ -25,8 +45,56 @@ public:
     : Base{config}
     , u{shape()}
     , u_prev{shape()}
+    , px{mesh_points(x.B)}
+    , py{mesh_points(y.B)}
+    , output{x.B, y.B, 200} { }
+
+    // Non-uniform, e.g. locally refined, meshes of the unit square
+    heat_2d(const dimension& dim_x, const dimension& dim_y, const timesteps_config& steps)
+    : Base{dim_x, dim_y, steps}
+    , u{shape()}
+    , u_prev{shape()}
+    , px{mesh_points(x.B)}
+    , py{mesh_points(y.B)}
     , output{x.B, y.B, 200} { }
 
+    // Part of a run on its own mesh - iterations [first_iter, first_iter +
+    // steps.step_count / substeps), starting from the final state of previous,
+    // which needs to live until run() is called
+    heat_2d(const dimension& dim_x, const dimension& dim_y, const timesteps_config& steps,
+            int first_iter, int substeps, const heat_2d* previous)
+    : heat_2d{dim_x, dim_y, steps} {
+        this->first_iter = first_iter;
+        this->substeps = substeps;
+        this->previous = previous;
+    }
+
+    // Parts of the unit square in x and y passed by the cannon front during
+    // iterations [first, last] - the width of the cone at the farthest position
+    // of the front in x, and the band swept by the front in y. Empty before
+    // the shot and after the front has left the domain.
+    static std::vector<std::array<mesh_region, 2>> cannon_front(int first, int last) {
+        double const r0 = std::max(cannon_time(first), 0.0);
+        double const r1 = std::max(cannon_time(last), 0.0);
+        if (r1 <= 0 || r0 * std::cos(max_alpha) >= grid_size) {
+            return {};
+        }
+        double const half_width = r1 * std::sin(max_alpha);
+        auto const x = mesh_region{(cannon_x_loc - half_width) / grid_size,
+                                   (cannon_x_loc + half_width) / grid_size};
+        auto const y = mesh_region{r0 * std::cos(max_alpha) / grid_size, r1 / grid_size};
+        return {{x, y}};
+    }
+
+    // Number of substeps of length dt / substeps making the explicit step
+    // stable on the given meshes. The bound on the diffusion part, dt times
+    // the largest eigenvalue of M^-1 K, is 2 for the Euler method; half of it
+    // is left for the transport terms.
+    static int stable_substeps(const dimension& dim_x, const dimension& dim_y, double dt) {
+        double const rate = k_x * max_eigenvalue(dim_x) + k_y * max_eigenvalue(dim_y);
+        return std::max(1, static_cast<int>(std::ceil(dt * rate)));
+    }
+
     double init_state(double /*x*/, double /*y*/) {
         return 0;
         // double dx = x - 0.5;
@@ -36,7 +104,7 @@ public:
     };
 
 private:
-    const double pi = 3.14159265358979;
+    static constexpr double pi = 3.14159265358979;
 
     void prepare_matrices() {
         y.fix_left();
@@ -44,34 +112,100 @@ private:
         Base::prepare_matrices();
     }
 
+    // Largest eigenvalue of M^-1 K in one direction
+    static double max_eigenvalue(const dimension& dim) {
+        const auto& d = dim.basis;
+        auto M = lin::band_matrix{dim.p, dim.p, dim.B.dofs()};
+        auto K = lin::band_matrix{dim.p, dim.p, dim.B.dofs()};
+        for (element_id e = 0; e < d.elements; ++e) {
+            for (int q = 0; q < d.quad_order; ++q) {
+                int first = d.first_dof(e);
+                int last = d.last_dof(e);
+                for (int a = 0; a + first <= last; ++a) {
+                    for (int b = 0; b + first <= last; ++b) {
+                        auto va = d.b[e][q][0][a];
+                        auto vb = d.b[e][q][0][b];
+                        auto da = d.b[e][q][1][a];
+                        auto db = d.b[e][q][1][b];
+                        M(a + first, b + first) += va * vb * d.w[q] * d.J[e];
+                        K(a + first, b + first) += da * db * d.w[q] * d.J[e];
+                    }
+                }
+            }
+        }
+        auto const F = fdm_direction{M, K};
+        return F.eigenvalue(F.size() - 1);
+    }
+
+    // L2 projection of the final state of previous onto this mesh. Values of
+    // the old solution at all the quadrature points are evaluated in one batch.
+    void project_previous() {
+        auto points = std::vector<batch_evaluator<2>::point_type>{};
+        for (auto e : elements()) {
+            for (auto q : quad_points()) {
+                auto x = point(e, q);
+                points.push_back({x[0], x[1]});
+            }
+        }
+        auto sampler = batch_evaluator<2>{previous->x.B, previous->y.B};
+        sampler.set_points(points);
+        auto const values = sampler.values(previous->u);
+
+        zero(u);
+        std::size_t i = 0;
+        for (auto e : elements()) {
+            double J = jacobian(e);
+            for (auto q : quad_points()) {
+                double w = weight(q);
+                double val = values[i++][0];
+                for (auto a : dofs_on_element(e)) {
+                    value_type v = eval_basis(e, q, a);
+                    u(a[0], a[1]) += val * v.val * w * J;
+                }
+            }
+        }
+        solve(u);
+    }
+
     void before() override {
         prepare_matrices();
 
-        auto init = [this](double x, double y) { return init_state(x, y); };
-        projection(u, init);
-        solve(u);
+        if (previous) {
+            project_previous();
+            previous = nullptr;
+        } else {
+            auto init = [this](double x, double y) { return init_state(x, y); };
+            projection(u, init);
+            solve(u);
+        }
 
-        output.to_file(u, "init.data");
+        if (first_iter == 0) {
+            output.to_file(u, "init.data");
+        }
     }
 
+    int model_iter(int iter) const { return first_iter + iter / substeps; }
+
     double s;
     void before_step(int iter, double /*t*/) override {
         using std::swap;
         swap(u, u_prev);
         const double d = 0.7;
         const double c = 10000;
-        s = std::max(((cos(iter * pi / c) - d) * 1 / (1-d)), 0.);
-        std::cout << "\r" << iter << "/" << iterations << " (s=" << s << ")                          \r";
+        s = std::max(((cos(model_iter(iter) * pi / c) - d) * 1 / (1-d)), 0.);
+        std::cout << "\r" << model_iter(iter) << "/" << iterations << " (s=" << s
+                  << ")                          \r";
     }
 
     void step(int iter, double /*t*/) override {
-        compute_rhs(iter);
+        compute_rhs(model_iter(iter));
         solve(u);
     }
 
     void after_step(int iter, double /*t*/) override {
-        if (iter % 100 == 0) {
-            output.to_file(u, "out_%d.data", iter);
+        bool const last_substep = (iter + 1) % substeps == 0;
+        if (last_substep && model_iter(iter) % 100 == 0) {
+            output.to_file(u, "out_%d.data", model_iter(iter));
         }
     }
 
@@ -80,42 +214,46 @@ private:
         return 0;
     }
 
-    double e2h(double e) {
-        return e / 40;
-    }
-
     double dTy(double h) {
       if (h >= 0.8) return 0;
       return -5.2;
     }
 
-    const int grid_size = 40; // as defined in polution.cpp
-    const int cannon_x_loc = grid_size / 2;
-    const int cannon_shot_time = 6'000;
-    const int cannon_strength_x = 45;
-    const int cannon_strength_y = 30;
-    const double cone_limiter = 6.0;
-    const double max_alpha = pi / cone_limiter;
-    const double wave_speed = 2.0;
-
-    double cannon(int x, int y, int iter) {
-        if (iter <= cannon_shot_time)
-            return 0.0;
-
+    // Cannon coordinates are in the units of the coarse grid, as defined in polution.cpp
+    static constexpr int grid_size = 40;
+    static constexpr int cannon_x_loc = grid_size / 2;
+    static constexpr int cannon_shot_time = 6'000;
+    static constexpr int cannon_strength_x = 45;
+    static constexpr int cannon_strength_y = 30;
+    static constexpr double cone_limiter = 6.0;
+    static constexpr double max_alpha = pi / cone_limiter;
+    static constexpr double wave_speed = 2.0;
+
+    // Distance travelled by the front since the shot, in coarse grid units
+    static double cannon_time(int iter) {
         double i_denom = (iterations / wave_speed) - cannon_shot_time;
         // iteration denominator
 
         if (i_denom <= 0)
             return 0.0;
 
-        double time = (iter - cannon_shot_time) * grid_size / i_denom;
+        return (iter - cannon_shot_time) * grid_size / i_denom;
         // time proportion where 0 is canon shot time
         // and 1 is last frame multiplayed by grid_size
+    }
+
+    double cannon(double x, double y, int iter) {
+        if (iter <= cannon_shot_time)
+            return 0.0;
+
+        double time = cannon_time(iter);
+        if (time <= 0)
+            return 0.0;
 
         if (y > time)
             return 0.0;
 
-        int x_prim = std::abs(cannon_x_loc - x);
+        double x_prim = std::abs(cannon_x_loc - x);
         double alpha_rad = std::atan(x_prim / time);
 
         if (alpha_rad >= max_alpha)
@@ -129,24 +267,31 @@ private:
         return (y_prim - y) * std::cos(alpha_rad * cone_limiter * 0.5);
     }
 
-    const double k_x = 1.0, k_y = 0.1;
+    static constexpr double k_x = 1.0, k_y = 0.1;
     void compute_rhs(int iter) {
         auto& rhs = u;
 
         zero(rhs);
         for (auto e : elements()) {
             double J = jacobian(e);
+
+            // Differences over the element, scaled to one coarse cell
+            double ex = px[e[0]] * grid_size;
+            double ey = py[e[1]] * grid_size;
+            double hx = (px[e[0] + 1] - px[e[0]]) * grid_size;
+            double hy = (py[e[1] + 1] - py[e[1]]) * grid_size;
+            double b = cannon(ex, ey, iter);
+            double bx = (cannon(ex - hx, ey, iter) - b) / hx * cannon_strength_x;
+            double by = (cannon(ex, ey - hy, iter) - b) / hy * cannon_strength_y;
+            double h = py[e[1]];
+
             for (auto q : quad_points()) {
                 double w = weight(q);
                 for (auto a : dofs_on_element(e)) {
                     value_type v = eval_basis(e, q, a);
                     value_type u = eval_fun(u_prev, e, q);
 
-                    double b = cannon(e[0], e[1], iter);
-                    double bx = (cannon(e[0] - 1, e[1], iter) - b) * cannon_strength_x;
-                    double by = (cannon(e[0], e[1] - 1, iter) - b) * cannon_strength_y;
                     double gradient_prod = k_x * u.dx * v.dx + k_y * u.dy * v.dy;
-                    double h = e2h(e[1]);
                     double val =
                         u.val * v.val
                         - steps.dt * gradient_prod
@@ -6,6 +6,7 @@
 
 #include <galois/Timer.h>
 
+#include "../common/coupled_assembly.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
@@ -326,122 +327,44 @@ public:
         // u = (ux, uy, p)
         // v = (vx, vy, q)
 
-        // vx, ux -> (\/vx, \/ux)
-        for (auto i : dofs(test.U1x, test.U1y)) {
-            for (auto j : dofs(trial.U1x, trial.U1y)) {
-                if (!overlap(i, test.U1x, test.U1y, j, trial.U1x, trial.U1y))
-                    continue;
-
-                int ii = linear_index(i, test.U1x, test.U1y) + 1;
-                int jj = linear_index(j, trial.U1x, trial.U1y) + 1;
-
-                bool bd_i = is_boundary(i, test.U1x, test.U1y);
-                bool bd_j = is_boundary(j, trial.U1x, trial.U1y);
-
-                auto eval = [&](auto form) {
-                    return integrate(i, j, test.U1x, test.U1y, trial.U1x, trial.U1y, form);
-                };
-                double value = eval([](auto v, auto u) { return v.dx * u.dx + v.dy * u.dy; });
+        // Block of B with test functions from V = Vx x Vy and trial functions
+        // from U = Ux x Uy, rows fixed at pressure / boundary dofs
+        auto block = [&](const dimension& Vx, const dimension& Vy, const dimension& Ux,
+                         const dimension& Uy, int si, int sj, bool pressure_i, bool pressure_j,
+                         auto form) {
+            auto value = [&](index_type i, index_type j) {
+                return integrate(i, j, Vx, Vy, Ux, Uy, form);
+            };
+            auto emit = [&](index_type i, index_type j, double val) {
+                int ii = linear_index(i, Vx, Vy) + 1;
+                int jj = linear_index(j, Ux, Uy) + 1;
+
+                bool fixed_i = pressure_i ? is_pressure_fixed(i) : is_boundary(i, Vx, Vy);
+                bool fixed_j = pressure_j ? is_pressure_fixed(j) : is_boundary(j, Ux, Uy);
+
+                put(ii, jj, si, sj, val, fixed_i, fixed_j);
+            };
+            assemble_coupled_block(Vx, Vy, Ux, Uy, executor, value, emit);
+        };
 
-                put(ii, jj, 0, 0, value, bd_i, bd_j);
-            }
-        }
+        // vx, ux -> (\/vx, \/ux)
+        block(test.U1x, test.U1y, trial.U1x, trial.U1y, 0, 0, false, false,
+              [](auto v, auto u) { return v.dx * u.dx + v.dy * u.dy; });
         // vy, uy -> (\/vy, \/uy)
-        for (auto i : dofs(test.U2x, test.U2y)) {
-            for (auto j : dofs(trial.U2x, trial.U2y)) {
-                if (!overlap(i, test.U2x, test.U2y, j, trial.U2x, trial.U2y))
-                    continue;
-
-                int ii = linear_index(i, test.U2x, test.U2y) + 1;
-                int jj = linear_index(j, trial.U2x, trial.U2y) + 1;
-
-                bool bd_i = is_boundary(i, test.U2x, test.U2y);
-                bool bd_j = is_boundary(j, trial.U2x, trial.U2y);
-
-                auto eval = [&](auto form) {
-                    return integrate(i, j, test.U2x, test.U2y, trial.U2x, trial.U2y, form);
-                };
-                double value = eval([](auto v, auto u) { return v.dx * u.dx + v.dy * u.dy; });
-
-                put(ii, jj, DU1, dU1, value, bd_i, bd_j);
-            }
-        }
+        block(test.U2x, test.U2y, trial.U2x, trial.U2y, DU1, dU1, false, false,
+              [](auto v, auto u) { return v.dx * u.dx + v.dy * u.dy; });
         // q, ux -> (q, ux,x)
-        for (auto i : dofs(test.Px, test.Py)) {
-            for (auto j : dofs(trial.U1x, trial.U1y)) {
-                if (!overlap(i, test.Px, test.Py, j, trial.U1x, trial.U1y))
-                    continue;
-
-                int ii = linear_index(i, test.Px, test.Py) + 1;
-                int jj = linear_index(j, trial.U1x, trial.U1y) + 1;
-
-                bool fixed_i = is_pressure_fixed(i);
-                bool bd_j = is_boundary(j, trial.U1x, trial.U1y);
-
-                auto eval = [&](auto form) {
-                    return integrate(i, j, test.Px, test.Py, trial.U1x, trial.U1y, form);
-                };
-                double value = eval([](auto q, auto u) { return q.val * u.dx; });
-                put(ii, jj, DU1 + DU2, 0, value, fixed_i, bd_j);
-            }
-        }
+        block(test.Px, test.Py, trial.U1x, trial.U1y, DU1 + DU2, 0, true, false,
+              [](auto q, auto u) { return q.val * u.dx; });
         // q, uy -> (q, uy,y)
-        for (auto i : dofs(test.Px, test.Py)) {
-            for (auto j : dofs(trial.U2x, trial.U2y)) {
-                if (!overlap(i, test.Px, test.Py, j, trial.U2x, trial.U2y))
-                    continue;
-
-                int ii = linear_index(i, test.Px, test.Py) + 1;
-                int jj = linear_index(j, trial.U2x, trial.U2y) + 1;
-
-                bool fixed_i = is_pressure_fixed(i);
-                bool bd_j = is_boundary(j, trial.U2x, trial.U2y);
-
-                auto eval = [&](auto form) {
-                    return integrate(i, j, test.Px, test.Py, trial.U2x, trial.U2y, form);
-                };
-                double value = eval([](auto q, auto u) { return q.val * u.dy; });
-                put(ii, jj, DU1 + DU2, dU1, value, fixed_i, bd_j);
-            }
-        }
+        block(test.Px, test.Py, trial.U2x, trial.U2y, DU1 + DU2, dU1, true, false,
+              [](auto q, auto u) { return q.val * u.dy; });
         // vx, p -> - (vx,x, p)
-        for (auto i : dofs(test.U1x, test.U1y)) {
-            for (auto j : dofs(trial.Px, trial.Py)) {
-                if (!overlap(i, test.U1x, test.U1y, j, trial.Px, trial.Py))
-                    continue;
-
-                int ii = linear_index(i, test.U1x, test.U1y) + 1;
-                int jj = linear_index(j, trial.Px, trial.Py) + 1;
-
-                bool bd_i = is_boundary(i, test.U1x, test.U1y);
-                bool fixed_j = is_pressure_fixed(j);
-
-                auto eval = [&](auto form) {
-                    return integrate(i, j, test.U1x, test.U1y, trial.Px, trial.Py, form);
-                };
-                double value = eval([](auto v, auto p) { return -v.dx * p.val; });
-                put(ii, jj, 0, dU1 + dU2, value, bd_i, fixed_j);
-            }
-        }
+        block(test.U1x, test.U1y, trial.Px, trial.Py, 0, dU1 + dU2, false, true,
+              [](auto v, auto p) { return -v.dx * p.val; });
         // vy, p ->  - (vy,y, p)
-        for (auto i : dofs(test.U2x, test.U2y)) {
-            for (auto j : dofs(trial.Px, trial.Py)) {
-                if (!overlap(i, test.U2x, test.U2y, j, trial.Px, trial.Py))
-                    continue;
-
-                int ii = linear_index(i, test.U2x, test.U2y) + 1;
-                int jj = linear_index(j, trial.Px, trial.Py) + 1;
-
-                bool bd_i = is_boundary(i, test.U2x, test.U2y);
-                bool fixed_j = is_pressure_fixed(j);
-
-                auto eval = [&](auto form) {
-                    return integrate(i, j, test.U2x, test.U2y, trial.Px, trial.Py, form);
-                };
-                double value = eval([](auto v, auto p) { return -v.dy * p.val; });
-                put(ii, jj, DU1, dU1 + dU2, value, bd_i, fixed_j);
-            }
-        }
+        block(test.U2x, test.U2y, trial.Px, trial.Py, DU1, dU1 + dU2, false, true,
+              [](auto v, auto p) { return -v.dy * p.val; });
 
         // Dirichlet BC - trial space
         for_boundary_dofs(trial.U1x, trial.U1y, [&](index_type dof) {
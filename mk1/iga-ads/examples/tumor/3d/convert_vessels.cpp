@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+#include "ads/executor/galois.hpp"
+#include "vasculature_parser.hpp"
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: tumor_3d_convert_vessels input.vtk output.bin [threads]" << std::endl;
+        std::exit(1);
+    }
+    int threads = argc > 3 ? std::atoi(argv[3]) : 1;
+    try {
+        auto executor = ads::galois_executor{threads};
+        auto net = tumor::load_vessel_network(argv[1], executor);
+        tumor::save_vessel_network_binary(net, argv[2]);
+        std::cout << net.points.size() << " nodes, " << net.segments.size() << " segments"
+                  << std::endl;
+    } catch (std::exception const& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::exit(1);
+    }
+}
@@ -3,14 +3,16 @@
 
 #include <cstdlib>
 
+#include "../../common/runge_kutta.hpp"
 #include "../vasculature.hpp"
+#include "ads/executor/galois.hpp"
 #include "ads/simulation.hpp"
 #include "tumor_3d.hpp"
 #include "vasculature_parser.hpp"
 
 int main(int argc, char* argv[]) {
-    if (argc < 5) {
-        std::cerr << "Usage: tumor_3d threads p n vasc_size steps" << std::endl;
+    if (argc < 6) {
+        std::cerr << "Usage: tumor_3d threads p n vasc_size steps [scheme [vessels]]" << std::endl;
         std::exit(1);
     }
     int threads = std::atoi(argv[1]);
@@ -18,8 +20,16 @@ int main(int argc, char* argv[]) {
     int n = std::atoi(argv[3]);
     int vasc_size = std::atoi(argv[4]);  // 300; //16 * 3;
     int nsteps = std::atoi(argv[5]);
-
-    auto vessels = tumor::parse_vessels(std::cin);
+    auto scheme = ads::tableau_by_name(argc > 6 ? argv[6] : "rk4");
+
+    // Vessel network file in text or binary format, stdin (text) if not given. Only one Galois
+    // runtime can exist at a time, so the executor used for parsing is destroyed before the
+    // simulation creates its own.
+    auto vessels = [&] {
+        auto executor = ads::galois_executor{threads};
+        return argc > 7 ? tumor::make_vessels(tumor::load_vessel_network(argv[7], executor))
+                        : tumor::parse_vessels(std::cin, executor);
+    }();
     // auto vessels = tumor::vessels{};
 
     auto vasc = tumor::vasculature{vasc_size, vasc_size, vasc_size, std::move(vessels)};
@@ -34,6 +44,6 @@ int main(int argc, char* argv[]) {
 
     tumor::params par;
 
-    tumor::tumor_3d sim{c, par, std::move(vasc), threads};
+    tumor::tumor_3d sim{c, par, std::move(vasc), threads, std::move(scheme)};
     sim.run();
 }
@@ -5,9 +5,16 @@
 #define TUMOR_3D_TUMOR_3D_HPP
 
 #include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include <galois/Timer.h>
 
+#include "../../common/dirichlet_bc.hpp"
+#include "../../common/parallel_ads.hpp"
+#include "../../common/point_eval.hpp"
+#include "../../common/runge_kutta.hpp"
 #include "../params.hpp"
 #include "../skin.hpp"
 #include "../state.hpp"
@@ -24,45 +31,48 @@ private:
     static constexpr std::size_t Dim = 3;
     using Base = ads::simulation_3d;
 
-    state<Dim> now, prev;
-    state<Dim> k1, k2, k3, k4;
+    state<Dim> now, prev, trial;
+    ads::explicit_rk<state<Dim>> rk;
+
+    // size of the next substep and counts of the last step, for embedded pairs
+    double substep = 0;
+    int accepted = 0;
+    int rejected = 0;
+
     params p;
     vasculature vasc;
 
-    ads::bspline::eval_ctx xctx;
-    ads::bspline::eval_ctx yctx;
-    ads::bspline::eval_ctx zctx;
+    ads::dirichlet_bc<Dim> homogeneous_bc;
+    ads::dirichlet_bc<Dim> ecm_bc;
 
-    ads::bspline::eval_ders_ctx xdctx;
-    ads::bspline::eval_ders_ctx ydctx;
-    ads::bspline::eval_ders_ctx zdctx;
+    ads::batch_evaluator<Dim> sampler;
 
     ads::output_manager<3> output;
 
     ads::galois_executor executor;
 
+    ads::direction_solver Mx, My, Mz;
+
     galois::StatTimer timer{"total"};
     galois::StatTimer integration_timer{"integration"};
     galois::StatTimer bc_timer{"bc"};
     galois::StatTimer init_timer{"init"};
 
 public:
-    tumor_3d(const ads::config_3d& config, const params& params, vasculature&& vasc, int threads)
+    tumor_3d(const ads::config_3d& config, const params& params, vasculature&& vasc, int threads,
+             ads::butcher_tableau scheme = ads::rk4_tableau())
     : Base{config}
     , now{shape()}
     , prev{shape()}
-    , k1{shape()}
-    , k2{shape()}
-    , k3{shape()}
-    , k4{shape()}
+    , trial{shape()}
+    , rk{std::move(scheme), now}
     , p{params}
     , vasc{std::move(vasc)}
-    , xctx{x.B.degree}
-    , yctx{y.B.degree}
-    , zctx{z.B.degree}
-    , xdctx{x.B.degree, 1}
-    , ydctx{y.B.degree, 1}
-    , zdctx{z.B.degree, 1}
+    , homogeneous_bc{x, y, z}
+    , ecm_bc{x, y, z,
+             [this](double x, double y, double z, double) { return p.skin.init_M(x, y, z); },
+             false}
+    , sampler{x.B, y.B, z.B}
     , output{x.B, y.B, z.B, 50}
     , executor{threads} { }
 
@@ -80,176 +90,11 @@ private:
         z.fix_right();
     }
 
-    void zero_bc(vector_type& v) {
-        for (int i = 0; i < x.dofs(); ++i) {
-            for (int j = 0; j < y.dofs(); ++j) {
-                v(i, j, 0) = 0;
-                v(i, j, z.dofs() - 1) = 0;
-            }
-        }
-        for (int i = 0; i < y.dofs(); ++i) {
-            for (int j = 0; j < z.dofs(); ++j) {
-                v(0, i, j) = 0;
-                v(x.dofs() - 1, i, j) = 0;
-            }
-        }
-        for (int i = 0; i < x.dofs(); ++i) {
-            for (int j = 0; j < z.dofs(); ++j) {
-                v(i, 0, j) = 0;
-                v(i, y.dofs() - 1, j) = 0;
-            }
-        }
-    }
-
-    template <typename Function>
-    void apply_bc(vector_type& v, Function f) const {
-        using side_type = ads::lin::tensor<double, 2>;
-        side_type xy{{x.dofs(), y.dofs()}};
-
-        ads::compute_projection(xy, x.basis, y.basis,
-                                [&](double x, double y) { return f(x, y, z.a); });
-        for (int i = 0; i < x.dofs(); ++i) {
-            for (int j = 0; j < y.dofs(); ++j) {
-                v(i, j, 0) = xy(i, j);
-            }
-        }
-
-        zero(xy);
-        ads::compute_projection(xy, x.basis, y.basis,
-                                [&](double x, double y) { return f(x, y, z.b); });
-        for (int i = 0; i < x.dofs(); ++i) {
-            for (int j = 0; j < y.dofs(); ++j) {
-                v(i, j, z.dofs() - 1) = xy(i, j);
-            }
-        }
-
-        side_type yz{{y.dofs(), z.dofs()}};
-
-        ads::compute_projection(yz, y.basis, z.basis,
-                                [&](double y, double z) { return f(x.a, y, z); });
-        for (int i = 0; i < y.dofs(); ++i) {
-            for (int j = 0; j < z.dofs(); ++j) {
-                v(0, i, j) = yz(i, j);
-            }
-        }
-
-        zero(yz);
-        ads::compute_projection(yz, y.basis, z.basis,
-                                [&](double y, double z) { return f(x.b, y, z); });
-        for (int i = 0; i < y.dofs(); ++i) {
-            for (int j = 0; j < z.dofs(); ++j) {
-                v(x.dofs() - 1, i, j) = yz(i, j);
-            }
-        }
-
-        side_type xz{{x.dofs(), z.dofs()}};
-
-        ads::compute_projection(xz, x.basis, z.basis,
-                                [&](double x, double z) { return f(x, y.a, z); });
-        for (int i = 0; i < x.dofs(); ++i) {
-            for (int j = 0; j < z.dofs(); ++j) {
-                v(i, 0, j) = yz(i, j);
-            }
-        }
-
-        zero(xz);
-        ads::compute_projection(xz, x.basis, z.basis,
-                                [&](double x, double z) { return f(x, y.b, z); });
-        for (int i = 0; i < x.dofs(); ++i) {
-            for (int j = 0; j < z.dofs(); ++j) {
-                v(i, y.dofs() - 1, j) = yz(i, j);
-            }
-        }
-
-        using edge_type = ads::lin::tensor<double, 1>;
-        auto ex = edge_type{{x.dofs()}};
-        auto ey = edge_type{{y.dofs()}};
-        auto ez = edge_type{{z.dofs()}};
-
-        ads::compute_projection(ex, x.basis, [&](double t) { return f(t, y.a, z.a); });
-        for (int i = 0; i < x.dofs(); ++i) {
-            v(i, 0, 0) = ex(i);
-        }
-        zero(ex);
-
-        ads::compute_projection(ex, x.basis, [&](double t) { return f(t, y.b, z.a); });
-        for (int i = 0; i < x.dofs(); ++i) {
-            v(i, y.dofs() - 1, 0) = ex(i);
-        }
-        zero(ex);
-
-        ads::compute_projection(ex, x.basis, [&](double t) { return f(t, y.a, z.b); });
-        for (int i = 0; i < x.dofs(); ++i) {
-            v(i, 0, z.dofs() - 1) = ex(i);
-        }
-        zero(ex);
-
-        ads::compute_projection(ex, x.basis, [&](double t) { return f(t, y.b, z.b); });
-        for (int i = 0; i < x.dofs(); ++i) {
-            v(i, y.dofs() - 1, z.dofs() - 1) = ex(i);
-        }
-        zero(ex);
-
-        ads::compute_projection(ey, y.basis, [&](double t) { return f(x.a, t, z.a); });
-        for (int i = 0; i < y.dofs(); ++i) {
-            v(0, i, 0) = ey(i);
-        }
-        zero(ey);
-
-        ads::compute_projection(ey, y.basis, [&](double t) { return f(x.b, t, z.a); });
-        for (int i = 0; i < y.dofs(); ++i) {
-            v(x.dofs() - 1, i, 0) = ey(i);
-        }
-        zero(ey);
-
-        ads::compute_projection(ey, y.basis, [&](double t) { return f(x.a, t, z.b); });
-        for (int i = 0; i < y.dofs(); ++i) {
-            v(0, i, z.dofs() - 1) = ey(i);
-        }
-        zero(ey);
-
-        ads::compute_projection(ey, y.basis, [&](double t) { return f(x.b, t, z.b); });
-        for (int i = 0; i < y.dofs(); ++i) {
-            v(x.dofs() - 1, i, z.dofs() - 1) = ey(i);
-        }
-        zero(ey);
-
-        ads::compute_projection(ez, z.basis, [&](double t) { return f(x.a, y.a, t); });
-        for (int i = 0; i < z.dofs(); ++i) {
-            v(0, 0, i) = ez(i);
-        }
-        zero(ez);
-
-        ads::compute_projection(ez, z.basis, [&](double t) { return f(x.b, y.a, t); });
-        for (int i = 0; i < z.dofs(); ++i) {
-            v(x.dofs() - 1, 0, i) = ez(i);
-        }
-        zero(ez);
-
-        ads::compute_projection(ez, z.basis, [&](double t) { return f(x.a, y.b, t); });
-        for (int i = 0; i < z.dofs(); ++i) {
-            v(0, y.dofs() - 1, i) = ez(i);
-        }
-        zero(ez);
-
-        ads::compute_projection(ez, z.basis, [&](double t) { return f(x.b, y.b, t); });
-        for (int i = 0; i < z.dofs(); ++i) {
-            v(x.dofs() - 1, y.dofs() - 1, i) = ez(i);
-        }
-        zero(ez);
-
-        v(0, 0, 0) = f(x.a, y.a, z.a);
-        v(0, 0, z.dofs() - 1) = f(x.a, y.a, z.b);
-        v(0, y.dofs() - 1, 0) = f(x.a, y.b, z.a);
-        v(0, y.dofs() - 1, z.dofs() - 1) = f(x.a, y.b, z.b);
-        v(x.dofs() - 1, 0, 0) = f(x.b, y.a, z.a);
-        v(x.dofs() - 1, 0, z.dofs() - 1) = f(x.b, y.a, z.b);
-        v(x.dofs() - 1, y.dofs() - 1, 0) = f(x.b, y.b, z.a);
-        v(x.dofs() - 1, y.dofs() - 1, z.dofs() - 1) = f(x.b, y.b, z.b);
-    }
-
     void prepare_matrices() {
         dirichlet();
+        Mx = ads::mass_solver(x);
+        My = ads::mass_solver(y);
+        Mz = ads::mass_solver(z);
         Base::prepare_matrices();
     }
 
@@ -275,77 +120,110 @@ private:
         solve_all(now);
 
         save_to_file(0);
+        substep = steps.dt;
         init_timer.stop();
     }
 
     void before_step(int /*iter*/, double /*t*/) override {
         using std::swap;
         swap(now, prev);
-
-        now.clear();
     }
 
-    void step(int iter, double /*t*/) override {
+    void step(int iter, double t) override {
         timer.start();
 
-        double h = steps.dt;
         integration_timer.start();
-        rk_step(prev, k1, h / 2);
-        rk_step(k1, k2, h / 2);
-        rk_step(k2, k3, h);
-        rk_step(k3, k4, -h / 2);
-        integration_timer.stop();
-
-        for (int i = 0; i < x.dofs(); ++i) {
-            for (int j = 0; j < y.dofs(); ++j) {
-                for (int k = 0; k < z.dofs(); ++k) {
-                    now.b(i, j, k) =
-                        1.0 / 3
-                        * (k1.b(i, j, k) + 2 * k2.b(i, j, k) + k3.b(i, j, k) - k4.b(i, j, k));
-                    now.c(i, j, k) =
-                        1.0 / 3
-                        * (k1.c(i, j, k) + 2 * k2.c(i, j, k) + k3.c(i, j, k) - k4.c(i, j, k));
-                    now.o(i, j, k) =
-                        1.0 / 3
-                        * (k1.o(i, j, k) + 2 * k2.o(i, j, k) + k3.o(i, j, k) - k4.o(i, j, k));
-                    now.M(i, j, k) =
-                        1.0 / 3
-                        * (k1.M(i, j, k) + 2 * k2.M(i, j, k) + k3.M(i, j, k) - k4.M(i, j, k));
-                    now.A(i, j, k) =
-                        1.0 / 3
-                        * (k1.A(i, j, k) + 2 * k2.A(i, j, k) + k3.A(i, j, k) - k4.A(i, j, k));
-                }
-            }
+        if (rk.tableau().embedded()) {
+            adaptive_step(t, steps.dt);
+        } else {
+            rk.step(prev, now, t, steps.dt, rhs(), executor);
         }
+        integration_timer.stop();
 
         update_vasculature(iter);
 
         timer.stop();
     }
 
-    void rk_step(const state<Dim>& prev, state<Dim>& next, double h) {
-        next.clear();
+    auto rhs() {
+        return [this](const state<Dim>& s, state<Dim>& dsdt, double) { rate(s, dsdt); };
+    }
+
+    // Advances prev over [t, t + dt] in substeps controlled by the error estimate
+    // of the embedded pair. Substeps with error above the tolerance are rejected
+    // and repeated with the size proposed by suggest_step. The last proposed
+    // size carries over to the next time step.
+    void adaptive_step(double t, double dt) {
+        double const end = t + dt;
+        double const min_step = 1e-10 * dt;
+
+        now = prev;
+        accepted = 0;
+        rejected = 0;
+        while (end - t > min_step) {
+            double const h = std::min(substep, end - t);
+            double const err = rk.step(now, trial, t, h, rhs(), executor);
+            double const next = ads::suggest_step(rk.tableau(), h, err);
+
+            // written so that a NaN estimate is a rejection
+            bool const accept = err <= 1;
+            if (accept) {
+                using std::swap;
+                swap(now, trial);
+                t += h;
+                ++accepted;
+            } else {
+                ++rejected;
+            }
+            // substep shortened to hit the end of the step does not limit the next one
+            substep = (!accept || h == substep) ? next : std::min(substep, next);
+
+            if (substep < min_step) {
+                throw std::runtime_error{"Runge-Kutta step size underflow"};
+            }
+        }
+    }
+
+    // Computes the time derivative of s. Boundary values are fixed in time, so
+    // the derivative vanishes on the boundary.
+    void rate(const state<Dim>& s, state<Dim>& dsdt) {
+        dsdt.clear();
         executor.for_each(elements(), [&](index_type e) {
-            auto local = local_contribution(prev, e, h);
-            executor.synchronized([&] { apply_local_contribution(next, local, e); });
+            auto local = local_contribution(s, e);
+            executor.synchronized([&] { apply_local_contribution(dsdt, local, e); });
         });
-        solve_all(next);
+
+        bc_timer.start();
+        for (auto* field : dsdt.fields()) {
+            homogeneous_bc.apply(*field);
+        }
+        bc_timer.stop();
+
+        for (auto* field : dsdt.fields()) {
+            solve(*field);
+        }
     }
 
     void after_step(int iter, double /*t*/) override {
-        std::cout << "Iter " << iter << " done" << std::endl;
+        std::cout << "Iter " << iter << " done";
+        if (rk.tableau().embedded()) {
+            std::cout << ", substeps: " << accepted << " accepted, " << rejected << " rejected";
+        }
+        std::cout << std::endl;
         if ((iter + 1) % 100 == 0) {
             save_to_file(iter + 1);
         }
     }
 
+    void solve(vector_type& v) { ads::parallel_ads_solve(v, buffer, executor, Mx, My, Mz); }
+
     void solve_all(state<Dim>& s) {
         bc_timer.start();
-        zero_bc(s.b);
-        zero_bc(s.c);
-        zero_bc(s.o);
-        apply_bc(s.M, [this](double x, double y, double z) { return p.skin.init_M(x, y, z); });
-        zero_bc(s.A);
+        homogeneous_bc.apply(s.b);
+        homogeneous_bc.apply(s.c);
+        homogeneous_bc.apply(s.o);
+        ecm_bc.apply(s.M);
+        homogeneous_bc.apply(s.A);
         bc_timer.stop();
 
         solve(s.b);
@@ -355,7 +233,7 @@ private:
         solve(s.A);
     }
 
-    state<Dim> local_contribution(const state<Dim>& s, index_type e, double h) const {
+    state<Dim> local_contribution(const state<Dim>& s, index_type e) const {
         auto local = state<Dim>{local_shape()};
 
         double J = jacobian(e);
@@ -407,23 +285,23 @@ private:
                 double divJv = D_b * b.val * (grad_Pv + p.r_b * grad_Av);
 
                 double bv = -divJv + (b_src + b_sink) * v.val;
-                ref(local.b, aa) += (b.val * v.val + bv * h) * wJ;
+                ref(local.b, aa) += bv * wJ;
 
                 // ECM evolution
                 double Mv = -p.beta_m * M.val * b.val * v.val;
-                ref(local.M, aa) += (M.val * v.val + Mv * h) * wJ;
+                ref(local.M, aa) += Mv * wJ;
 
                 double Av =
                     (p.gamma_a * M.val * b.val - p.gamma_oA * A.val) * v.val - p.chi_aA * grad_Av;
-                ref(local.A, aa) += (A.val * v.val + Av * h) * wJ;
+                ref(local.A, aa) += Av * wJ;
 
                 // TAF
                 double cv = -p.diff_c * grad_dot(c, v) + (c_src - p.cons_c * c.val * o.val) * v.val;
-                ref(local.c, aa) += (c.val * v.val + cv * h) * wJ;
+                ref(local.c, aa) += cv * wJ;
 
                 // oxygen
                 double ov = -p.alpha_0 * grad_dot(o, v) + o_rhs * v.val;
-                ref(local.o, aa) += (o.val * v.val + ov * h) * wJ;
+                ref(local.o, aa) += ov * wJ;
             }
         }
         return local;
@@ -463,22 +341,24 @@ private:
     }
 
     void update_vasculature(int iter) {
-        auto taf = [&, this](double px, double py, double pz) {
-            double xx = x.a + px * (x.b - x.a);
-            double yy = y.a + py * (y.b - y.a);
-            double zz = z.a + pz * (z.b - z.a);
-            return ads::bspline::eval_ders(xx, yy, zz, now.c, this->x.B, this->y.B, this->z.B,
-                                           xdctx, ydctx, zdctx);
-        };
+        auto sample = [this](const std::vector<vessels::point_type>& points) {
+            auto pts = std::vector<point_type>{};
+            pts.reserve(points.size());
+            for (const auto& p : points) {
+                pts.push_back({x.a + p.x * (x.b - x.a), y.a + p.y * (y.b - y.a),
+                               z.a + p.z * (z.b - z.a)});
+            }
+            sampler.set_points(pts);
+            auto vals = sampler.values_and_gradients(now.b, now.c);
 
-        auto tumor = [&, this](double px, double py, double pz) {
-            double xx = x.a + px * (x.b - x.a);
-            double yy = y.a + py * (y.b - y.a);
-            double zz = z.a + pz * (z.b - z.a);
-            return ads::bspline::eval(xx, yy, zz, now.b, this->x.B, this->y.B, this->z.B, xctx,
-                                      yctx, zctx);
+            auto samples = std::vector<vessels::field_sample>{};
+            samples.reserve(vals.size());
+            for (const auto& v : vals) {
+                samples.push_back({v[0].val, v[1]});
+            }
+            return samples;
         };
-        vasc.update(tumor, taf, iter, steps.dt);
+        vasc.update(sample, iter, steps.dt);
     }
 
     void after() override {
@@ -50,6 +50,12 @@ public:
         double inside_tumor;
     };
 
+    // Values of the fields driving the vessel evolution at a point
+    struct field_sample {
+        double tumor;
+        value_type taf;
+    };
+
 private:
     std::vector<node_ptr> roots_;
     tumor::vasc::config cfg;
@@ -89,10 +95,11 @@ public:
 
     const std::set<edge_ptr>& edges() const { return edges_; }
 
-    template <typename Tumor, typename TAF>
-    void update(Tumor&& tumor, TAF&& taf, int iter, double dt) {
+    // sample(points) returns field_sample for each of the points
+    template <typename Sample>
+    void update(Sample&& sample, int iter, double dt) {
         if (iter % 240 == 0) {
-            create_sprouts(tumor, taf, dt);
+            create_sprouts(sample, dt);
             for (edge_ptr s : edges_) {
                 // Vessel collapse
                 if (s->stability <= 0) {
@@ -103,9 +110,17 @@ public:
             }
         }
 
-        for (edge_ptr s : edges_) {
-            auto p = center(s);
-            double b = tumor(p.x, p.y, p.z);
+        auto edges = std::vector<edge_ptr>(begin(edges_), end(edges_));
+        auto centers = std::vector<point_type>{};
+        centers.reserve(edges.size());
+        for (edge_ptr s : edges) {
+            centers.push_back(center(s));
+        }
+        auto fields = sample(centers);
+
+        for (std::size_t i = 0; i < edges.size(); ++i) {
+            edge_ptr s = edges[i];
+            double b = fields[i].tumor;
             // Wall degradation
             if (b > 1) {
                 s->stability -= cfg.degeneration * dt;
@@ -113,7 +128,7 @@ public:
             }
             // Vessel dilatation
             if (s->inside_tumor > cfg.t_ec_switch && s->radius < cfg.r_max) {
-                double c = taf(p.x, p.y, p.z).val;
+                double c = fields[i].taf.val;
                 if (c > cfg.c_switch) {
                     s->radius += dt * cfg.dilatation;
                 }
@@ -136,12 +151,20 @@ public:
     }
 
 private:
-    template <typename Tumor, typename TAF>
-    void create_sprouts(Tumor&&, TAF&& taf, double dt) {
-        auto nodes_copy = nodes_;
+    template <typename Sample>
+    void create_sprouts(Sample&& sample, double dt) {
+        auto nodes_copy = std::vector<node_ptr>(begin(nodes_), end(nodes_));
+        auto positions = std::vector<point_type>{};
+        positions.reserve(nodes_copy.size());
         for (node_ptr n : nodes_copy) {
+            positions.push_back(n->pos);
+        }
+        auto fields = sample(positions);
+
+        for (std::size_t i = 0; i < nodes_copy.size(); ++i) {
+            node_ptr n = nodes_copy[i];
             auto p = n->pos;
-            value_type c = taf(p.x, p.y, p.z);
+            value_type c = fields[i].taf;
 
             if (c.val > cfg.c_min) {
                 // std::cout << "Maybe sprout" << std::endl;
@@ -245,9 +268,9 @@ public:
         output.print(os, grid, src);
     }
 
-    template <typename Tumor, typename TAF>
-    void update(Tumor&& tumor, TAF&& taf, int iter, double dt) {
-        vs.update(tumor, taf, iter, dt);
+    template <typename Sample>
+    void update(Sample&& sample, int iter, double dt) {
+        vs.update(sample, iter, dt);
         recompute();
     }
 
@@ -3,10 +3,238 @@
 
 #include "vasculature_parser.hpp"
 
-#include <tuple>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/range/counting_range.hpp>
+#include <fmt/core.h>
+
+#include "../../common/mapped_file.hpp"
 
 namespace tumor {
 
+namespace {
+
+// Binary vessel network layout (native byte order):
+//
+//   header           (32 bytes, see below)
+//   coordinates      double[3 * node_count]
+//   endpoints        uint32[2 * segment_count]
+//   radii            double[segment_count]
+//   types            uint8[segment_count]
+struct binary_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t node_count;
+    std::uint64_t segment_count;
+};
+
+static_assert(sizeof(binary_header) == 32);
+
+constexpr char binary_magic[8] = {'A', 'D', 'S', 'V', 'A', 'S', 'C', '\0'};
+constexpr std::uint32_t binary_version = 1;
+
+constexpr int vessel_type_count = 4;
+
+auto binary_size(std::uint64_t nodes, std::uint64_t segments) -> std::uint64_t {
+    return sizeof(binary_header) + 3 * nodes * sizeof(double)
+         + segments * (2 * sizeof(std::uint32_t) + sizeof(double) + sizeof(std::uint8_t));
+}
+
+auto is_binary(const std::byte* data, std::size_t size) -> bool {
+    return size >= sizeof(binary_magic)
+        && std::memcmp(data, binary_magic, sizeof(binary_magic)) == 0;
+}
+
+auto is_space(char c) -> bool {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+// Cursor over the text format, splitting it into keyword lines and blocks of
+// numeric data.
+class text_cursor {
+private:
+    std::string_view text;
+    std::size_t pos = 0;
+
+public:
+    explicit text_cursor(std::string_view text)
+    : text{text} { }
+
+    auto at_end() const -> bool { return pos >= text.size(); }
+
+    auto line() -> std::string_view {
+        auto end = text.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        auto result = text.substr(pos, end - pos);
+        pos = std::min(end + 1, text.size());
+        return result;
+    }
+
+    // Skips lines up to and including one starting with the keyword
+    auto keyword_line(std::string_view keyword) -> std::string_view {
+        while (!at_end()) {
+            auto l = line();
+            auto start = std::min(l.find_first_not_of(" \t\r"), l.size());
+            if (l.substr(start, keyword.size()) == keyword) {
+                return l.substr(start + keyword.size());
+            }
+        }
+        throw std::runtime_error{fmt::format("Missing {} section", keyword)};
+    }
+
+    // Skips lines that do not start with a number
+    void skip_to_data() {
+        while (!at_end() && !numeric_line()) {
+            line();
+        }
+    }
+
+    // Returns consecutive lines starting with a number
+    auto data_block() -> std::string_view {
+        auto begin = pos;
+        while (!at_end() && (numeric_line() || blank_line())) {
+            line();
+        }
+        return text.substr(begin, pos - begin);
+    }
+
+private:
+    auto first_char() const -> char {
+        auto p = pos;
+        while (p < text.size() && text[p] != '\n' && is_space(text[p])) {
+            ++p;
+        }
+        return p < text.size() ? text[p] : '\n';
+    }
+
+    auto numeric_line() const -> bool {
+        char c = first_char();
+        return std::isdigit(static_cast<unsigned char>(c)) != 0 || c == '-' || c == '+'
+            || c == '.';
+    }
+
+    auto blank_line() const -> bool { return first_char() == '\n'; }
+};
+
+template <typename T>
+auto parse_number(const char* first, const char* last, T& value) -> const char* {
+    if (first != last && *first == '+') {
+        ++first;
+    }
+    auto [ptr, ec] = std::from_chars(first, last, value);
+    if (ec != std::errc{}) {
+        throw std::runtime_error{
+            fmt::format("Invalid number: '{}'", std::string_view{first, std::size_t(last - first)}
+                                                      .substr(0, 20))};
+    }
+    return ptr;
+}
+
+template <typename T>
+void parse_chunk(std::string_view text, std::vector<T>& out) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (true) {
+        while (p != end && is_space(*p)) {
+            ++p;
+        }
+        if (p == end) {
+            break;
+        }
+        T value;
+        p = parse_number(p, end, value);
+        out.push_back(value);
+    }
+}
+
+// Parses whitespace-separated numbers, splitting the text into chunks at
+// whitespace boundaries and parsing them in parallel.
+template <typename T>
+auto parse_numbers(std::string_view text, std::size_t expected, ads::galois_executor& executor)
+    -> std::vector<T> {
+    constexpr std::size_t min_chunk = 1 << 20;
+
+    std::size_t chunk_count = std::max<std::size_t>(text.size() / min_chunk, 1);
+
+    std::vector<std::string_view> chunks;
+    std::size_t first = 0;
+    for (std::size_t i = 1; i <= chunk_count; ++i) {
+        std::size_t last = i == chunk_count ? text.size() : i * text.size() / chunk_count;
+        while (last < text.size() && !is_space(text[last])) {
+            ++last;
+        }
+        last = std::max(first, last);
+        chunks.push_back(text.substr(first, last - first));
+        first = last;
+    }
+
+    std::vector<std::vector<T>> parts(chunks.size());
+    std::vector<std::exception_ptr> errors(chunks.size());
+    auto const count = static_cast<int>(chunks.size());
+    executor.for_each(boost::counting_range(0, count), [&](int i) {
+        try {
+            parts[i].reserve(expected / chunks.size() + 1);
+            parse_chunk(chunks[i], parts[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    });
+    for (const auto& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+
+    std::vector<T> values;
+    values.reserve(expected);
+    for (const auto& part : parts) {
+        values.insert(values.end(), part.begin(), part.end());
+    }
+    if (values.size() != expected) {
+        throw std::runtime_error{
+            fmt::format("Expected {} values, found {}", expected, values.size())};
+    }
+    return values;
+}
+
+auto parse_count(std::string_view header) -> std::size_t {
+    std::vector<std::uint64_t> values;
+    auto first_word_end = std::min(header.find_first_of(" \t\r", header.find_first_not_of(" \t")),
+                                   header.size());
+    parse_chunk(header.substr(0, first_word_end), values);
+    if (values.size() != 1) {
+        throw std::runtime_error{fmt::format("Invalid section header: '{}'", header)};
+    }
+    return values[0];
+}
+
+auto to_vessel_type(long type) -> vessel_type {
+    if (type < 0 || type >= vessel_type_count) {
+        throw std::runtime_error{fmt::format("Invalid vessel type: {}", type)};
+    }
+    return static_cast<vessel_type>(type);
+}
+
+template <typename T>
+void copy_from(const std::byte*& src, T* dst, std::size_t count) {
+    std::memcpy(dst, src, count * sizeof(T));
+    src += count * sizeof(T);
+}
+
+}  // namespace
+
 void normalize_positions(std::vector<vessels::point_type>& points) {
     auto inf = std::numeric_limits<double>::infinity();
     double xmin = inf;
@@ -30,92 +258,200 @@ void normalize_positions(std::vector<vessels::point_type>& points) {
     }
 }
 
-vessels parse_vessels(std::istream& is) {
-    vessels vs;
+void validate(const vessel_network& net) {
+    auto segments = net.segments.size();
+    if (net.radii.size() != segments || net.types.size() != segments) {
+        throw std::runtime_error{
+            fmt::format("Inconsistent segment data: {} segments, {} radii, {} types", segments,
+                        net.radii.size(), net.types.size())};
+    }
+    for (std::size_t i = 0; i < net.points.size(); ++i) {
+        const auto& p = net.points[i];
+        if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) {
+            throw std::runtime_error{fmt::format("Node {} has non-finite coordinates", i)};
+        }
+    }
+    auto nodes = net.points.size();
+    for (std::size_t i = 0; i < segments; ++i) {
+        auto [a, b] = net.segments[i];
+        if (a >= nodes || b >= nodes) {
+            throw std::runtime_error{fmt::format(
+                "Segment {} references node {} outside [0, {}) range", i, std::max(a, b), nodes)};
+        }
+        if (!std::isfinite(net.radii[i]) || net.radii[i] < 0) {
+            throw std::runtime_error{
+                fmt::format("Segment {} has invalid radius {}", i, net.radii[i])};
+        }
+        auto type = static_cast<int>(net.types[i]);
+        if (type < 0 || type >= vessel_type_count) {
+            throw std::runtime_error{fmt::format("Segment {} has invalid type {}", i, type)};
+        }
+    }
+}
 
-    constexpr auto ALL = std::numeric_limits<std::streamsize>::max();
-    auto skip_lines = [&](int n = 1) {
-        for (int i = 0; i < n; ++i)
-            is.ignore(ALL, '\n');
-    };
-    auto skip_word = [&] { is.ignore(ALL, ' '); };
+vessel_network parse_vessel_network(std::string_view text, ads::galois_executor& executor) {
+    text_cursor cursor{text};
+    vessel_network net;
 
-    skip_lines(4);
+    auto point_count = parse_count(cursor.keyword_line("POINTS"));
+    auto coords = parse_numbers<double>(cursor.data_block(), 3 * point_count, executor);
 
-    skip_word();
-    int joint_count;
-    is >> joint_count;
-    skip_lines();
+    net.points.reserve(point_count);
+    for (std::size_t i = 0; i < point_count; ++i) {
+        net.points.push_back({coords[3 * i], coords[3 * i + 1], coords[3 * i + 2]});
+    }
 
-    using node_ptr = vessels::node_ptr;
-    using point = vessels::point_type;
+    auto line_count = parse_count(cursor.keyword_line("LINES"));
+    auto lines = parse_numbers<std::int64_t>(cursor.data_block(), 3 * line_count, executor);
+
+    net.segments.reserve(line_count);
+    for (std::size_t i = 0; i < line_count; ++i) {
+        if (lines[3 * i] != 2) {
+            throw std::runtime_error{fmt::format("Line {} is not a single segment", i)};
+        }
+        auto a = lines[3 * i + 1];
+        auto b = lines[3 * i + 2];
+        if (a < 0 || b < 0 || std::max(a, b) > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::runtime_error{fmt::format("Line {} has invalid endpoints", i)};
+        }
+        net.segments.push_back({static_cast<std::uint32_t>(a), static_cast<std::uint32_t>(b)});
+    }
+
+    cursor.skip_to_data();
+    net.radii = parse_numbers<double>(cursor.data_block(), line_count, executor);
 
-    std::vector<point> points;
-    points.reserve(joint_count);
+    cursor.skip_to_data();
+    auto types = parse_numbers<long>(cursor.data_block(), line_count, executor);
 
-    for (int i = 0; i < joint_count; ++i) {
-        double x;
-        double y;
-        double z;
-        is >> x >> y >> z;
-        points.push_back(point{x, y, z});
+    net.types.reserve(line_count);
+    for (auto type : types) {
+        net.types.push_back(to_vessel_type(type));
     }
-    normalize_positions(points);
 
-    std::vector<node_ptr> nodes;
-    nodes.reserve(joint_count);
+    validate(net);
+    return net;
+}
 
-    for (const auto& pos : points) {
-        auto* node = vs.make_node(pos);
-        nodes.push_back(node);
+vessel_network parse_vessel_network(std::istream& is, ads::galois_executor& executor) {
+    auto text = std::string{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+    return parse_vessel_network(text, executor);
+}
+
+vessel_network load_vessel_network_binary(const std::string& path) {
+    auto file = ads::mapped_file{path};
+    if (!is_binary(file.data(), file.size()) || file.size() < sizeof(binary_header)) {
+        throw std::runtime_error{fmt::format("{} is not a binary vessel network", path)};
+    }
+
+    binary_header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.version != binary_version) {
+        throw std::runtime_error{fmt::format("{}: unsupported version {}", path, header.version)};
+    }
+    auto expected = binary_size(header.node_count, header.segment_count);
+    if (header.node_count > std::numeric_limits<std::uint32_t>::max() || expected != file.size()) {
+        throw std::runtime_error{
+            fmt::format("{}: size {} does not match header ({} nodes, {} segments)", path,
+                        file.size(), header.node_count, header.segment_count)};
+    }
+
+    auto nodes = static_cast<std::size_t>(header.node_count);
+    auto segments = static_cast<std::size_t>(header.segment_count);
+    const auto* src = file.data() + sizeof(header);
+
+    vessel_network net;
+
+    std::vector<double> coords(3 * nodes);
+    copy_from(src, coords.data(), coords.size());
+    net.points.reserve(nodes);
+    for (std::size_t i = 0; i < nodes; ++i) {
+        net.points.push_back({coords[3 * i], coords[3 * i + 1], coords[3 * i + 2]});
     }
 
-    skip_word();
-    int line_count;
-    is >> line_count;
-    skip_lines();
+    net.segments.resize(segments);
+    copy_from(src, net.segments.data(), segments);
+
+    net.radii.resize(segments);
+    copy_from(src, net.radii.data(), segments);
+
+    std::vector<std::uint8_t> types(segments);
+    copy_from(src, types.data(), segments);
+    net.types.reserve(segments);
+    for (auto type : types) {
+        net.types.push_back(to_vessel_type(type));
+    }
+
+    validate(net);
+    return net;
+}
+
+void save_vessel_network_binary(const vessel_network& net, const std::string& path) {
+    validate(net);
 
-    std::vector<std::tuple<int, int>> lines;
-    lines.reserve(line_count);
+    binary_header header{};
+    std::memcpy(header.magic, binary_magic, sizeof(binary_magic));
+    header.version = binary_version;
+    header.node_count = net.points.size();
+    header.segment_count = net.segments.size();
 
-    for (int i = 0; i < line_count; ++i) {
-        skip_word();
-        int j;
-        int k;
-        is >> j >> k;
-        lines.emplace_back(j, k);
+    std::vector<double> coords;
+    coords.reserve(3 * net.points.size());
+    for (const auto& p : net.points) {
+        coords.insert(coords.end(), {p.x, p.y, p.z});
+    }
+    std::vector<std::uint8_t> types;
+    types.reserve(net.types.size());
+    for (auto type : net.types) {
+        types.push_back(static_cast<std::uint8_t>(type));
     }
 
-    skip_lines(4);
+    std::ofstream os;
+    os.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+    os.open(path, std::ios::binary);
 
-    std::vector<double> diameters;
-    diameters.reserve(line_count);
+    auto write = [&os](const auto* data, std::size_t count) {
+        os.write(reinterpret_cast<const char*>(data), count * sizeof(*data));
+    };
+    write(&header, 1);
+    write(coords.data(), coords.size());
+    write(net.segments.data(), net.segments.size());
+    write(net.radii.data(), net.radii.size());
+    write(types.data(), types.size());
+}
 
-    for (int i = 0; i < line_count; ++i) {
-        double d;
-        is >> d;
-        diameters.push_back(d);
+vessel_network load_vessel_network(const std::string& path, ads::galois_executor& executor) {
+    auto file = ads::mapped_file{path};
+    if (is_binary(file.data(), file.size())) {
+        return load_vessel_network_binary(path);
     }
+    const auto* text = reinterpret_cast<const char*>(file.data());
+    return parse_vessel_network(std::string_view{text, file.size()}, executor);
+}
+
+vessels make_vessels(vessel_network net) {
+    vessels vs;
 
-    skip_lines(2);
+    normalize_positions(net.points);
 
-    std::vector<vessel_type> types;
-    types.reserve(line_count);
+    using node_ptr = vessels::node_ptr;
+    std::vector<node_ptr> nodes;
+    nodes.reserve(net.points.size());
 
-    for (int i = 0; i < line_count; ++i) {
-        int type;
-        is >> type;
-        diameters.push_back(type);
+    for (const auto& pos : net.points) {
+        auto* node = vs.make_node(pos);
+        nodes.push_back(node);
     }
 
-    for (int i = 0; i < line_count; ++i) {
-        int j = std::get<0>(lines[i]);
-        int k = std::get<1>(lines[i]);
-        double d = diameters[i];
-        vs.connect(nodes[j], nodes[k], types[i], d);
+    for (std::size_t i = 0; i < net.segments.size(); ++i) {
+        auto [j, k] = net.segments[i];
+        vs.connect(nodes[j], nodes[k], net.types[i], net.radii[i]);
     }
 
     return vs;
 }
 
+vessels parse_vessels(std::istream& is, ads::galois_executor& executor) {
+    return make_vessels(parse_vessel_network(is, executor));
+}
+
 }  // namespace tumor
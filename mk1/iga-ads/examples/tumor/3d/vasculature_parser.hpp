@@ -4,16 +4,51 @@
 #ifndef TUMOR_3D_VASCULATURE_PARSER_HPP
 #define TUMOR_3D_VASCULATURE_PARSER_HPP
 
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "ads/executor/galois.hpp"
 #include "vasculature.hpp"
 
 namespace tumor {
 
+// Vessel network as stored in input files: node positions, segments given by
+// indices of their endpoints, and per-segment radius and type.
+struct vessel_network {
+    std::vector<vessels::point_type> points;
+    std::vector<std::array<std::uint32_t, 2>> segments;
+    std::vector<double> radii;
+    std::vector<vessel_type> types;
+};
+
 void normalize_positions(std::vector<vessels::point_type>& points);
 
-vessels parse_vessels(std::istream& is);
+// Throws std::runtime_error if the network is inconsistent (mismatched array
+// sizes, dangling endpoint indices, non-finite coordinates or radii).
+void validate(const vessel_network& net);
+
+// Legacy VTK polydata text format (POINTS, LINES and two cell scalars:
+// radius and type). Numeric sections are parsed in parallel.
+vessel_network parse_vessel_network(std::string_view text, ads::galois_executor& executor);
+
+vessel_network parse_vessel_network(std::istream& is, ads::galois_executor& executor);
+
+// Binary format, see vasculature_parser.cpp for the layout. The file is
+// memory-mapped and validated.
+vessel_network load_vessel_network_binary(const std::string& path);
+
+void save_vessel_network_binary(const vessel_network& net, const std::string& path);
+
+// Loads a network in either format, detected by the file header.
+vessel_network load_vessel_network(const std::string& path, ads::galois_executor& executor);
+
+vessels make_vessels(vessel_network net);
+
+vessels parse_vessels(std::istream& is, ads::galois_executor& executor);
 
 }  // namespace tumor
 
@@ -4,6 +4,8 @@
 #ifndef TUMOR_STATE_HPP
 #define TUMOR_STATE_HPP
 
+#include <array>
+
 #include "ads/lin/tensor.hpp"
 
 namespace tumor {
@@ -25,8 +27,12 @@ struct state {
     , M{shape}
     , A{shape} { }
 
+    std::array<field*, 5> fields() { return {&b, &c, &o, &M, &A}; }
+
+    std::array<const field*, 5> fields() const { return {&b, &c, &o, &M, &A}; }
+
     void clear() {
-        for (field* x : {&b, &c, &o, &M, &A}) {
+        for (field* x : fields()) {
             zero(*x);
         }
     }
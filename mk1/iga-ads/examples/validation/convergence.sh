@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+
+# Arguments: <p> <mesh> [ADS build dir]
+# Runs validation on meshes with 8, 16, ..., 128 elements and prints the
+# relative L2 and H1 errors (in %) with the observed convergence rates.
+# Mesh is given as for validation, e.g. uniform, shishkin:0.05:both,
+# bakhvalov:0.01:both, graded:1.1:both. Without the last argument, value of
+# ADS_BUILD env variable is used.
+#
+# The time scheme is explicit, so the time step is dt = 1 / (k n^2), with k
+# given by STEPS_FACTOR (default 100). Strongly graded meshes need larger k.
+
+p="$1"
+mesh="$2"
+k="${STEPS_FACTOR:-100}"
+
+export ADS_BUILD="${ADS_BUILD:-$3}"
+
+printf "%6s %14s %8s %14s %8s\n" n L2 rate H1 rate
+
+prev_l2=""
+prev_h1=""
+for n in 8 16 32 64 128; do
+    steps=$((k * n * n))
+    read -r l2 h1 < <("${ADS_BUILD}/examples/validation" "$p" "$n" "${steps}" "${mesh}")
+    if [[ -n "${prev_l2}" ]]; then
+        rates=$(python3 -c "import math; print(f'{math.log2(${prev_l2} / ${l2}):.2f}',
+                                              f'{math.log2(${prev_h1} / ${h1}):.2f}')")
+    else
+        rates="- -"
+    fi
+    read -r rate_l2 rate_h1 <<< "${rates}"
+    printf "%6d %14.6e %8s %14.6e %8s\n" "$n" "$l2" "${rate_l2}" "$h1" "${rate_h1}"
+    prev_l2="$l2"
+    prev_h1="$h1"
+done
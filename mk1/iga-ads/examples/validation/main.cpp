@@ -1,16 +1,28 @@
 // SPDX-FileCopyrightText: 2015 - 2023 Marcin Łoś <marcin.los.91@gmail.com>
 // SPDX-License-Identifier: MIT
 
+#include <string>
+
+#include "../common/mesh_points.hpp"
 #include "validation.hpp"
 
 int main(int argc, char* argv[]) {
     if (argc < 4) {
-        std::cerr << "Usage: validation <p> <n> <nsteps>" << std::endl;
+        std::cerr << "Usage: validation <p> <n> <nsteps> [mixed] [mesh]" << std::endl;
         return 0;
     }
     int p = std::atoi(argv[1]);
     int n = std::atoi(argv[2]);
     int nsteps = std::atoi(argv[3]);
+    bool mixed = false;
+    auto mesh = ads::mesh_config{};
+    for (int i = 4; i < argc; ++i) {
+        if (std::string{argv[i]} == "mixed") {
+            mixed = true;
+        } else {
+            mesh = ads::parse_mesh_config(argv[i]);
+        }
+    }
 
     if (n <= 0) {
         std::cerr << "Invalid value of n: " << argv[1] << std::endl;
@@ -21,11 +33,14 @@ int main(int argc, char* argv[]) {
     nsteps /= 10;
     // nsteps += 1;
 
-    ads::dim_config dim{p, n};
     ads::timesteps_config steps{nsteps, dt};
     int ders = 1;
+    int quad = p + 1;
+
+    // Same mesh in both directions, so that layers along the whole boundary can be resolved
+    auto points = ads::layer_points(mesh, 0, 1, n);
+    auto dim = ads::dimension{ads::basis_from_points(points, p, 0), quad, ders};
 
-    ads::config_2d c{dim, dim, steps, ders};
-    ads::problems::validation sim{c};
+    ads::problems::validation sim{dim, dim, steps, mixed};
     sim.run();
 }
@@ -4,6 +4,10 @@
 #ifndef VALIDATION_VALIDATION_HPP
 #define VALIDATION_VALIDATION_HPP
 
+#include <algorithm>
+
+#include "../common/dirichlet_bc.hpp"
+#include "../common/mixed_precision_ads.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/output_manager.hpp"
 #include "ads/simulation.hpp"
@@ -14,29 +18,55 @@ class validation : public simulation_2d {
 private:
     using Base = simulation_2d;
     vector_type u, u_prev;
+    vector_type u_ref, u_ref_prev;  // double precision solution, used in mixed mode
 
     output_manager<2> output;
     galois_executor executor{8};
+    ads::dirichlet_bc<2> bc;
+
+    bool mixed;
+    mixed_ads_solver mixed_solver{executor};
+    mixed_direction Mx, My;
+    refinement_report worst;
 
 public:
-    explicit validation(const config_2d& config)
+    explicit validation(const config_2d& config, bool mixed = false)
     : Base{config}
     , u{shape()}
     , u_prev{shape()}
-    , output{x.B, y.B, 200} { }
+    , u_ref{shape()}
+    , u_ref_prev{shape()}
+    , output{x.B, y.B, 200}
+    , bc{x, y}
+    , mixed{mixed} { }
+
+    validation(const dimension& dim_x, const dimension& dim_y, const timesteps_config& steps,
+               bool mixed = false)
+    : Base{dim_x, dim_y, steps}
+    , u{shape()}
+    , u_prev{shape()}
+    , u_ref{shape()}
+    , u_ref_prev{shape()}
+    , output{x.B, y.B, 200}
+    , bc{x, y}
+    , mixed{mixed} { }
 
     double init_state(double x, double y) { return fi(x, y) * sc(0); };
 
 private:
     void solve(vector_type& v) {
-        for (int i = 0; i < y.dofs(); ++i) {
-            v(0, i) = 0;
-            v(x.dofs() - 1, i) = 0;
-        }
-        for (int i = 0; i < x.dofs(); ++i) {
-            v(i, 0) = 0;
-            v(i, y.dofs() - 1) = 0;
+        bc.apply(v);
+        if (mixed) {
+            auto const report = mixed_solver(v, buffer, Mx, My);
+            worst.sweeps = std::max(worst.sweeps, report.sweeps);
+            worst.residual = std::max(worst.residual, report.residual);
+        } else {
+            Base::solve(v);
         }
+    }
+
+    void solve_reference(vector_type& v) {
+        bc.apply(v);
         Base::solve(v);
     }
 
@@ -59,6 +89,10 @@ private:
         x.fix_right();
         y.fix_left();
         y.fix_right();
+        if (mixed) {
+            Mx = mixed_direction{x.M};
+            My = mixed_direction{y.M};
+        }
         Base::prepare_matrices();
     }
 
@@ -67,22 +101,46 @@ private:
 
         auto init = [this](double x, double y) { return init_state(x, y); };
         projection(u, init);
+        if (mixed) {
+            u_ref = u;
+            solve_reference(u_ref);
+        }
         solve(u);
     }
 
     void before_step(int /*iter*/, double /*t*/) override {
         using std::swap;
         swap(u, u_prev);
+        if (mixed) {
+            swap(u_ref, u_ref_prev);
+        }
     }
 
     void step(int /*iter*/, double /*t*/) override {
-        compute_rhs();
+        compute_rhs(u, u_prev);
         solve(u);
+        if (mixed) {
+            compute_rhs(u_ref, u_ref_prev);
+            solve_reference(u_ref);
+        }
     }
 
+    // In mixed precision mode, the errors of the solution computed alongside
+    // in double precision and their differences follow the refinement report
     void after() override {
         double T = steps.dt * steps.step_count;
-        std::cout << errorL2(T) << "  " << errorH1(T) << std::endl;
+        double const L2 = errorL2(u, T);
+        double const H1 = errorH1(u, T);
+        std::cout << L2 << "  " << H1;
+        if (mixed) {
+            std::cout << "  " << worst.residual << "  " << worst.sweeps;
+
+            double const L2_ref = errorL2(u_ref, T);
+            double const H1_ref = errorH1(u_ref, T);
+            std::cout << "  " << L2_ref << "  " << H1_ref;
+            std::cout << "  " << L2 - L2_ref << "  " << H1 - H1_ref;
+        }
+        std::cout << std::endl;
     }
 
     void after_step(int /*iter*/, double /*t*/) override {
@@ -92,9 +150,7 @@ private:
         // }
     }
 
-    void compute_rhs() {
-        auto& rhs = u;
-
+    void compute_rhs(vector_type& rhs, const vector_type& prev) {
         zero(rhs);
 
         executor.for_each(elements(), [&](index_type e) {
@@ -103,7 +159,7 @@ private:
             double J = jacobian(e);
             for (auto q : quad_points()) {
                 double w = weight(q);
-                value_type u = eval_fun(u_prev, e, q);
+                value_type u = eval_fun(prev, e, q);
                 for (auto a : dofs_on_element(e)) {
                     auto aa = dof_global_to_local(e, a);
                     value_type v = eval_basis(e, q, a);
@@ -118,12 +174,12 @@ private:
         });
     }
 
-    double errorL2(double t) const {
+    double errorL2(const vector_type& u, double t) const {
         auto sol = [&](point_type x) { return solution(x[0], x[1], t); };
         return Base::errorL2(u, x, y, sol) / normL2(x, y, sol) * 100;
     }
 
-    double errorH1(double t) const {
+    double errorH1(const vector_type& u, double t) const {
         auto sol = [&](point_type x) { return solution(x[0], x[1], t); };
         return Base::errorH1(u, x, y, sol) / normH1(x, y, sol) * 100;
     }
@@ -3,36 +3,13 @@
 
 #include <cstdlib>
 
+#include "../common/mesh_points.hpp"
 #include "victor.hpp"
 
-ads::bspline::basis create_basis(double a, double b, int p, int elements, int repeated_nodes) {
-    int points = elements + 1;
-    int r = repeated_nodes + 1;
-    int knot_size = 2 * (p + 1) + (points - 2) * r;
-    ads::bspline::knot_vector knot(knot_size);
-
-    for (int i = 0; i <= p; ++i) {
-        knot[i] = a;
-        knot[knot_size - i - 1] = b;
-    }
-
-    auto x0 = 0.5;
-    auto y0 = 0.9;
-
-    for (int i = 1; i < points - 1; ++i) {
-        auto t = ads::lerp(i, elements, 0.0, 1.0);
-
-        auto s = t < x0 ? t / x0 * y0 : (t - x0) / (1 - x0) * (1 - y0) + y0;
-        for (int j = 0; j < r; ++j) {
-            knot[p + 1 + (i - 1) * r + j] = ads::lerp(s, a, b);
-        }
-    }
-    return {std::move(knot), p};
-}
-
 int main(int argc, char* argv[]) {
-    if (argc != 7) {
-        std::cerr << "Usage: victor <N> <p_trial> <C_trial> <p_test> <C_test> <steps>" << std::endl;
+    if (argc != 7 && argc != 8) {
+        std::cerr << "Usage: victor <N> <p_trial> <C_trial> <p_test> <C_test> <steps> [mesh]"
+                  << std::endl;
         std::exit(1);
     }
     int n = std::atoi(argv[1]);
@@ -46,10 +23,16 @@ int main(int argc, char* argv[]) {
     ads::timesteps_config steps{nsteps, 0.5 * 1e-2};
     int ders = 1;
 
-    auto trial_basis = create_basis(0, 1, p_trial, n, p_trial - 1 - C_trial);
+    // Half of the elements in the layer of width 0.1 at the right end by default
+    auto defaults = ads::mesh_config{ads::mesh_type::shishkin, 0.1};
+    auto const mesh = argc > 7 ? ads::parse_mesh_config(argv[7], defaults) : defaults;
+
+    auto trial_basis =
+        ads::basis_from_points(ads::layer_points(mesh, 0, 1, n), p_trial, p_trial - 1 - C_trial);
     auto dtrial = ads::dimension{trial_basis, quad, ders};
 
-    auto test_basis = create_basis(0, 1, p_test, n, p_test - 1 - C_test);
+    auto test_basis =
+        ads::basis_from_points(ads::layer_points(mesh, 0, 1, n), p_test, p_test - 1 - C_test);
     auto dtest = ads::dimension{test_basis, quad, ders};
 
     auto trial_dim = dtrial.B.dofs();
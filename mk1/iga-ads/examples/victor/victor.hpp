@@ -4,6 +4,7 @@
 #ifndef VICTOR_VICTOR_HPP
 #define VICTOR_VICTOR_HPP
 
+#include "../common/banded_schur_operator.hpp"
 #include "ads/executor/galois.hpp"
 #include "ads/lin/dense_matrix.hpp"
 #include "ads/lin/dense_solve.hpp"
@@ -21,19 +22,20 @@ private:
     dimension Ux, Uy;
     dimension& Vx;
     dimension& Vy;
-    lin::dense_matrix Kx_x, Kx_y, Ky_x, Ky_y;
+    // Kx_x = Bx' Ax^-1 Bx and Ky_y = By' Ay^-1 By, applied and solved without forming them
+    banded_schur_operator Kx_x, Ky_y;
+    lin::band_matrix Kx_y, Ky_x;
 
-    lin::dense_matrix Kx_x_nf, Kx_y_nf, Ky_x_nf, Ky_y_nf;  // non-factorized copies
+    lin::band_matrix Kx_y_nf, Ky_x_nf;  // non-factorized copies
 
-    lin::solver_ctx Kxx_ctx, Kxy_ctx, Kyx_ctx, Kyy_ctx;
+    lin::solver_ctx Kxy_ctx, Kyx_ctx;
 
     lin::band_matrix Ax, Ay;
     lin::solver_ctx Ax_ctx, Ay_ctx;
     lin::band_matrix MUx, MUy;
 
     lin::band_matrix MUVx, MUVy;
-    lin::dense_matrix Bx, By;
-    lin::dense_matrix Tx, Ty;
+    row_band_matrix Bx, By;
 
     vector_type u, u_prev;
     vector_type u_buffer;
@@ -61,18 +63,14 @@ public:
     , Uy{trial_y}
     , Vx{x}
     , Vy{y}
-    , Kx_x{Ux.dofs(), Ux.dofs()}
-    , Kx_y{Uy.dofs(), Uy.dofs()}
-    , Ky_x{Ux.dofs(), Ux.dofs()}
-    , Ky_y{Uy.dofs(), Uy.dofs()}
-    , Kx_x_nf{Ux.dofs(), Ux.dofs()}
-    , Kx_y_nf{Uy.dofs(), Uy.dofs()}
-    , Ky_x_nf{Ux.dofs(), Ux.dofs()}
-    , Ky_y_nf{Uy.dofs(), Uy.dofs()}
-    , Kxx_ctx{Kx_x}
+    , Kx_x{Vx, Ux}
+    , Ky_y{Vy, Uy}
+    , Kx_y{Uy.p, Uy.p, Uy.dofs()}
+    , Ky_x{Ux.p, Ux.p, Ux.dofs()}
+    , Kx_y_nf{Uy.p, Uy.p, Uy.dofs()}
+    , Ky_x_nf{Ux.p, Ux.p, Ux.dofs()}
     , Kxy_ctx{Kx_y}
     , Kyx_ctx{Ky_x}
-    , Kyy_ctx{Ky_y}
     , Ax{Vx.p, Vx.p, Vx.dofs()}
     , Ay{y.p, Vy.p, Vy.dofs()}
     , Ax_ctx{Ax}
@@ -81,10 +79,8 @@ public:
     , MUy{Uy.p, Uy.p, Uy.dofs(), Uy.dofs(), 0}
     , MUVx{Vx.p, Ux.p, Vx.dofs(), Ux.dofs()}
     , MUVy{Vy.p, Uy.p, Vy.dofs(), Uy.dofs()}
-    , Bx{Vx.dofs(), Ux.dofs()}
-    , By{Vy.dofs(), Uy.dofs()}
-    , Tx{Vx.dofs(), Ux.dofs()}
-    , Ty{Vy.dofs(), Uy.dofs()}
+    , Bx{Vx, Ux}
+    , By{Vy, Uy}
     , u{{Ux.dofs(), Uy.dofs()}}
     , u_prev{{Ux.dofs(), Uy.dofs()}}
     , u_buffer{{Ux.dofs(), Uy.dofs()}}
@@ -114,7 +110,7 @@ private:
         }
     }
 
-    void mass_matrix(lin::dense_matrix& M, const basis_data& bU, const basis_data& bV) {
+    void mass_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
                 for (int a = 0; a + bV.first_dof(e) <= bV.last_dof(e); ++a) {
@@ -131,7 +127,7 @@ private:
         }
     }
 
-    void diffusion_matrix(lin::dense_matrix& M, const basis_data& bU, const basis_data& bV,
+    void diffusion_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV,
                           double h, double diffusion) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
@@ -149,7 +145,7 @@ private:
         }
     }
 
-    void advection_matrix(lin::dense_matrix& M, const basis_data& bU, const basis_data& bV,
+    void advection_matrix(row_band_matrix& M, const basis_data& bU, const basis_data& bV,
                           double h, double advection) {
         for (element_id e = 0; e < bV.elements; ++e) {
             for (int q = 0; q < bV.quad_order; ++q) {
@@ -167,7 +163,7 @@ private:
         }
     }
 
-    void fix_dof(int k, const dimension& dim, lin::dense_matrix& K) {
+    void fix_dof(int k, const dimension& dim, lin::band_matrix& K) {
         int last = dim.dofs() - 1;
         for (int i = clamp(k - dim.p, 0, last); i <= clamp(k + dim.p, 0, last); ++i) {
             K(k, i) = 0;
@@ -175,7 +171,7 @@ private:
         K(k, k) = 1;
     }
 
-    void matrix(lin::dense_matrix& B, const basis_data& bU, const basis_data& bV, double h,
+    void matrix(row_band_matrix& B, const basis_data& bU, const basis_data& bV, double h,
                 double diffusion, double advection) {
         mass_matrix(B, bU, bV);
         diffusion_matrix(B, bU, bV, h, diffusion);
@@ -191,10 +187,8 @@ private:
         Ay.zero();
         MUx.zero();
         MUy.zero();
-        Kx_x.zero();
         Kx_y.zero();
         Ky_x.zero();
-        Ky_y.zero();
 
         // mass_matrix(MUVx, Ux.basis, x.basis);
         // mass_matrix(MUVy, Uy.basis, y.basis);
@@ -207,56 +201,41 @@ private:
         gram_matrix_1d(MUx, Ux.basis);
         gram_matrix_1d(MUy, Uy.basis);
 
+        // Kx_x = Bx' Ax^-1 Bx
+        Kx_x.factorize(Bx, Ax, {0, Ux.dofs() - 1});
+
+        // Ky_y = By' Ay^-1 By
+        Ky_y.factorize(By, Ay, {0, Uy.dofs() - 1});
+
         lin::factorize(Ax, Ax_ctx);
         lin::factorize(Ay, Ay_ctx);
 
-        // TODO: fill
-        // Kx_x = Bx' Ax^-1 Bx
-        // to_dense(Bx, Tx);
-        Tx = Bx;
-        solve_with_factorized(Ax, Tx, Ax_ctx);
-        multiply(Bx, Tx, Kx_x, "T");
-
         // Kx_y = MUVy' MVy^-1 MUVy
         // to_dense(MUy, Ty);
         // solve_with_factorized(Uy.M, Ty, Uy.ctx);
         // multiply(MUy, Ty, Kx_y, "T");
-        to_dense(MUy, Kx_y);
+        Kx_y = MUy;
 
         // Ky_x = MUVx' MVx^-1 MUVx
         // to_dense(MUx, Tx);
         // solve_with_factorized(Ux.M, Tx, Ux.ctx);
         // multiply(MUx, Tx, Ky_x, "T");
-        to_dense(MUx, Ky_x);
-
-        // Ky_y = By' Ay^-1 By
-        // to_dense(By, Ty);
-        Ty = By;
-        solve_with_factorized(Ay, Ty, Ay_ctx);
-        multiply(By, Ty, Ky_y, "T");
+        Ky_x = MUx;
 
         // lin::factorize(MUx, MUx_ctx);
         // lin::factorize(MUy, MUy_ctx);
 
         fix_dof(0, Uy, Kx_y);
-        fix_dof(0, Uy, Ky_y);
         fix_dof(Uy.dofs() - 1, Uy, Kx_y);
-        fix_dof(Uy.dofs() - 1, Uy, Ky_y);
 
         fix_dof(0, Ux, Ky_x);
-        fix_dof(0, Ux, Kx_x);
         fix_dof(Ux.dofs() - 1, Ux, Ky_x);
-        fix_dof(Ux.dofs() - 1, Ux, Kx_x);
 
-        Kx_x_nf = Kx_x;
         Kx_y_nf = Kx_y;
         Ky_x_nf = Ky_x;
-        Ky_y_nf = Ky_y;
 
-        lin::factorize(Kx_x, Kxx_ctx);
         lin::factorize(Kx_y, Kxy_ctx);
         lin::factorize(Ky_x, Kyx_ctx);
-        lin::factorize(Ky_y, Kyy_ctx);
     }
 
     void prepare_matrices() {
@@ -324,36 +303,27 @@ private:
         compute_projection(buf_x1, Uy.basis, [&](double /*t*/) { return 0; });
         lin::solve_with_factorized(MUy_loc, buf_x1, ctx_y);
 
+        lin::vector row_x{{Ux.dofs()}};
+        lin::vector row_y{{Uy.dofs()}};
+
+        apply(Kx_x, buf_y0, row_x);
         for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += buf_y0(j) * Kx_x_nf(i, j);
-            }
-            u(i, 0) = val;
+            u(i, 0) = row_x(i);
         }
 
+        apply(Kx_x, buf_y1, row_x);
         for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += buf_y1(j) * Kx_x_nf(i, j);
-            }
-            u(i, Uy.dofs() - 1) = val;
+            u(i, Uy.dofs() - 1) = row_x(i);
         }
 
+        apply(Kx_y_nf, buf_x0, row_y);
         for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += buf_x0(j) * Kx_y_nf(i, j);
-            }
-            u(0, i) = val;
+            u(0, i) = row_y(i);
         }
 
+        apply(Kx_y_nf, buf_x1, row_y);
         for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += buf_x1(j) * Kx_y_nf(i, j);
-            }
-            u(Ux.dofs() - 1, i) = val;
+            u(Ux.dofs() - 1, i) = row_y(i);
         }
 
         u(0, 0) = 1;
@@ -361,8 +331,8 @@ private:
         u(Ux.dofs() - 1, Uy.dofs() - 1) = 0;
         u(0, Uy.dofs() - 1) = 0;
 
-        // ads_solve(u, u_buffer, dim_data{Kx_x, Kxx_ctx}, dim_data{Kx_y, Kxy_ctx});
-        lin::solve_with_factorized(Kx_x, u, Kxx_ctx);
+        // ads_solve(u, u_buffer, Kx_x, dim_data{Kx_y, Kxy_ctx});
+        Kx_x(u);
         auto F = lin::cyclic_transpose(u, u_buffer.data());
         lin::solve_with_factorized(Kx_y, F, Kxy_ctx);
         lin::cyclic_transpose(F, u);
@@ -382,42 +352,30 @@ private:
         multiply(By, rhsx2_t, u_t, Ux.dofs(), "T");
         lin::cyclic_transpose(u_t, u);
 
+        apply(Ky_x_nf, buf_y0, row_x);
         for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += buf_y0(j) * Ky_x_nf(i, j);
-            }
-            u(i, 0) = val;
+            u(i, 0) = row_x(i);
         }
 
+        apply(Ky_x_nf, buf_y1, row_x);
         for (int i = 0; i < Ux.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Ux.dofs(); ++j) {
-                val += buf_y1(j) * Ky_x_nf(i, j);
-            }
-            u(i, Uy.dofs() - 1) = val;
+            u(i, Uy.dofs() - 1) = row_x(i);
         }
 
+        apply(Ky_y, buf_x0, row_y);
         for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += buf_x0(j) * Ky_y_nf(i, j);
-            }
-            u(0, i) = val;
+            u(0, i) = row_y(i);
         }
 
+        apply(Ky_y, buf_x1, row_y);
         for (int i = 0; i < Uy.dofs(); ++i) {
-            double val = 0;
-            for (int j = 0; j < Uy.dofs(); ++j) {
-                val += buf_x1(j) * Ky_y_nf(i, j);
-            }
-            u(Ux.dofs() - 1, i) = val;
+            u(Ux.dofs() - 1, i) = row_y(i);
         }
 
-        // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, dim_data{Ky_y, Kyy_ctx});
+        // ads_solve(u, u_buffer, dim_data{Ky_x, Kyx_ctx}, Ky_y);
         lin::solve_with_factorized(Ky_x, u, Kyx_ctx);
         auto F2 = lin::cyclic_transpose(u, u_buffer.data());
-        lin::solve_with_factorized(Ky_y, F2, Kyy_ctx);
+        Ky_y(F2);
         lin::cyclic_transpose(F2, u);
     }
 